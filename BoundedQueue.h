@@ -0,0 +1,90 @@
+#ifndef CHIP8_EMULATOR_C_BOUNDEDQUEUE_H
+#define CHIP8_EMULATOR_C_BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Emulator {
+
+    //Fixed size lock-free queue for any number of producers and consumers, after Dmitry Vyukov's bounded MPMC queue.
+    //Every cell carries a sequence number that tells whether it is free for the push or holds the value for the pop
+    //at a position, so pushing and popping is a compare and swap on the position and no locks are held. Values come
+    //out in the order their pushes claimed positions.
+    template<typename T>
+    class BoundedQueue {
+
+    private:
+        struct alignas(64) Cell {
+            std::atomic<uint64_t> sequence;
+            T value;
+        };
+
+        std::vector<Cell> cells;
+        uint64_t mask;
+        alignas(64) std::atomic<uint64_t> push_position;
+        alignas(64) std::atomic<uint64_t> pop_position;
+
+    public:
+        //Capacity is rounded up to a power of two
+        explicit BoundedQueue(size_t capacity) : push_position(0), pop_position(0) {
+            size_t size = 2;
+            while (size < capacity) size *= 2;
+            cells = std::vector<Cell>(size);
+            mask = size - 1;
+            for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        //False when the queue is full
+        bool TryPush(const T &value) {
+            uint64_t position = push_position.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = cells[position & mask];
+                uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<int64_t>(sequence - position);
+                if (difference == 0) {
+                    if (push_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = push_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //False when the queue is empty
+        bool TryPop(T *value) {
+            uint64_t position = pop_position.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = cells[position & mask];
+                uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<int64_t>(sequence - (position + 1));
+                if (difference == 0) {
+                    if (pop_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        *value = cell.value;
+                        cell.sequence.store(position + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = pop_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        size_t GetCapacity() const {
+            return cells.size();
+        }
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_BOUNDEDQUEUE_H
@@ -3,73 +3,458 @@
 #include "Chip8.h"
 #include <random>
 #include <algorithm>
-#include <memory>
+#include <type_traits>
+#include <cstring>
+#include <bit>
 
 namespace Emulator {
 
-    Chip8::Chip8() : memory(4096), v(16), stack(16), key_pressed(16), gfx(32, std::vector<bool>(64)), mt(new std::mt19937(std::random_device()())), dist(new std::uniform_real_distribution<double>(0.0, 255.0)){
-        PopulateOpCodeTables();
+    Chip8::Chip8() : Chip8(RandomSeed()) {}
+
+    static_assert(std::is_trivially_copyable<Chip8State>::value, "Chip8State is copied with memcpy");
+    static_assert(std::has_unique_object_representations<Chip8State>::value, "Chip8State is compared with memcmp");
+
+    namespace {
+#ifdef CHIP8_UNCHECKED_ADDRESSING
+        //Baseline for Benchmark only, to measure what the checks cost: indices aren't masked and range faults are
+        //never raised, so a ROM that reaches outside memory or the stack is undefined behavior
+        constexpr bool CHECKED = false;
+        constexpr int ADDRESS_MASK = -1;
+        constexpr int STACK_MASK = -1;
+#else
+        constexpr bool CHECKED = true;
+        constexpr int ADDRESS_MASK = 0x0FFF;
+        constexpr int STACK_MASK = 0x0F;
+#endif
+
+        constexpr uint64_t SplitMix64(uint64_t &seed) {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        //Odd multipliers for every memory byte and framebuffer row. A write adds its multiplier times the change of
+        //the value, so the sums are updated with one multiplication and never need a pass over the whole state
+        struct HashKeys {
+            std::array<uint64_t, 4096> memory{};
+            std::array<uint64_t, Framebuffer::HEIGHT> gfx{};
+
+            constexpr HashKeys() {
+                uint64_t seed = 0x4348495038ULL;
+                for (uint64_t &key : memory) key = SplitMix64(seed) | 1;
+                for (uint64_t &key : gfx) key = SplitMix64(seed) | 1;
+            }
+        };
+
+        constexpr HashKeys hash_keys;
+
+        uint64_t HashBytes(const uint64_t *keys, const uint8_t *bytes, int start, int length) {
+            uint64_t hash = 0;
+            for (int i = start; i < start + length; i++) hash += keys[i] * bytes[i];
+            return hash;
+        }
+
+        //Rows of 8 bytes are hashed and drawn as 64 bit words
+        static_assert(Framebuffer::BYTES_PER_ROW == sizeof(uint64_t), "A framebuffer row is one word");
+
+        uint64_t HashRows(const Framebuffer &gfx) {
+            uint64_t hash = 0;
+            for (int y = 0; y < Framebuffer::HEIGHT; y++) {
+                uint64_t row;
+                memcpy(&row, gfx.Row(y), sizeof(row));
+                hash += hash_keys.gfx[y] * row;
+            }
+            return hash;
+        }
+
+        //Shift of the byte at index within a row loaded as a word
+        constexpr int RowBytePosition(int index) {
+            return std::endian::native == std::endian::little ? 8 * index : 56 - 8 * index;
+        }
+
+        uint64_t Mix(uint64_t hash, uint64_t value) {
+            hash = (hash ^ value) * 0x9E3779B97F4A7C15ULL;
+            return hash ^ (hash >> 29);
+        }
+
+        uint64_t Load64(const void *bytes) {
+            uint64_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+
+        //Everything but the memory and gfx sums is small enough to mix in on every call
+        uint64_t CombineStateHash(const Chip8State &state, uint64_t memory_hash, uint64_t gfx_hash) {
+            uint64_t hash = Mix(memory_hash, gfx_hash);
+            for (size_t i = 0; i < state.v.size(); i += 8) hash = Mix(hash, Load64(&state.v[i]));
+            for (size_t i = 0; i < state.stack.size(); i += 4) hash = Mix(hash, Load64(&state.stack[i]));
+
+            const std::array<uint32_t, 4> &random = state.rng.GetState();
+            hash = Mix(hash, static_cast<uint64_t>(random[0]) << 32 | random[1]);
+            hash = Mix(hash, static_cast<uint64_t>(random[2]) << 32 | random[3]);
+
+            hash = Mix(hash, static_cast<uint64_t>(state.index_register) |
+                             static_cast<uint64_t>(state.program_counter) << 16 |
+                             static_cast<uint64_t>(state.stack_pointer) << 32 |
+                             static_cast<uint64_t>(state.delay_timer) << 40 |
+                             static_cast<uint64_t>(state.sound_timer) << 48 |
+                             static_cast<uint64_t>(state.waiting_for_key) << 56 |
+                             static_cast<uint64_t>(state.halted) << 57 |
+                             static_cast<uint64_t>(state.faults & 0x1F) << 58);
+            return SplitMix64(hash);
+        }
+    }
+
+    const std::array<Chip8::Handler, 16> Chip8::opcode_table = {
+            &Chip8::OpCodeZero, &Chip8::Jump, &Chip8::Call, &Chip8::RegisterAndConstantSE,
+            &Chip8::RegisterAndConstantSNE, &Chip8::TwoRegistersSE, &Chip8::LoadConstantIntoRegister,
+            &Chip8::AddConstantToRegister, &Chip8::OpCodeEight, &Chip8::TwoRegistersSNE,
+            &Chip8::SetRegisterIToConstant, &Chip8::JumpToConstantPlusV0, &Chip8::SetCpuRegisterRandom,
+            &Chip8::DisplaySprite, &Chip8::OpCodeE, &Chip8::OpCodeF};
+
+    const std::array<Chip8::Handler, 16> Chip8::opcode8_table = {
+            &Chip8::StoreRegisterYInX, &Chip8::ORRegisterXAndY, &Chip8::ANDRegisterXAndY,
+            &Chip8::XORRegisterXAndY, &Chip8::ADDRegisterXAndY, &Chip8::SUBRegisterXAndY,
+            &Chip8::SHRRegisterX, &Chip8::SUBNRegisterXAndY, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid,
+            &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid,
+            &Chip8::SHLRegisterX, &Chip8::OpCodeInvalid};
+
+    //Indexed by the third nibble, Fx6x and above don't exist
+    const std::array<Chip8::Handler, 16> Chip8::opcodeF_table = {
+            &Chip8::OpCodeFx0x, &Chip8::OpCodeFx1x, &Chip8::LoadFontLocationIntoIndexRegister,
+            &Chip8::StoreBCDInMemory, &Chip8::OpCodeInvalid, &Chip8::LoadRegistersIntoMemory,
+            &Chip8::LoadMemoryIntoRegisters, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid,
+            &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid,
+            &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid};
+
+    const std::array<Chip8::FusedHandler, Chip8::FUSED_PATTERNS> Chip8::fused_table = {
+            nullptr, &Chip8::FusedLoadDraw, &Chip8::FusedImmediates, &Chip8::FusedImmediateJump,
+            &Chip8::FusedAddSkip, &Chip8::FusedTimerPoll};
+
+    Chip8::Chip8(uint64_t seed) : Chip8State(), keys(0), halt_on_fault(false), fused_patterns_stale(true) {
+        rng.Seed(seed);
         LoadHexDigitSpriteIntoMemory();
+        RehashState();
+    }
+
+    Chip8::Chip8(std::string path) : Chip8(std::move(path), RandomSeed()) {}
 
-        program_counter = 0x200;
+    Chip8::Chip8(std::string path, uint64_t seed) : Chip8(seed) {
+        if (!LoadRomFile(path)) std::cerr << std::string("Can't find inputfile") << path << std::endl;
     }
 
-    Chip8::Chip8(std::string path) : Chip8() {
-        std::ifstream inputfile;
-        inputfile.open(path.c_str());
+    void Chip8::LoadRom(std::span<const uint8_t> rom) {
+        Xoshiro128 random = rng;
+        static_cast<Chip8State &>(*this) = Chip8State();
+        rng = random;
 
-        if (inputfile.is_open()) {
-            int counter = 0x200;
-            while (!inputfile.eof()) {
-                memory.at(counter) = inputfile.get();
-                counter++;
-            }
+        LoadHexDigitSpriteIntoMemory();
+        size_t length = std::min(rom.size(), memory.size() - 0x200);
+        std::copy_n(rom.begin(), length, memory.begin() + 0x200);
+        RehashState();
+        fused_patterns_stale = true;
+    }
 
-            inputfile.close();
-        } else std::cerr << std::string("Can't find inputfile") << path << std::endl;
+    bool Chip8::LoadRomFile(const std::string &path) {
+        std::ifstream inputfile(path, std::ios::binary);
+        if (!inputfile.is_open()) return false;
+
+        //Whatever doesn't fit behind 0x200 is ignored
+        std::array<uint8_t, 4096 - 0x200> rom;
+        inputfile.read(reinterpret_cast<char *>(rom.data()), rom.size());
+        LoadRom(std::span<const uint8_t>(rom.data(), inputfile.gcount()));
+        return true;
+    }
+
+    uint64_t Chip8::RandomSeed() {
+        std::random_device random_device;
+        return static_cast<uint64_t>(random_device()) << 32 | random_device();
     }
 
     void Chip8::EmulateCycle() {
-        opcode = memory[program_counter] << 8 | memory[program_counter + 1];
-        
+        if (halted) return;
+
+        //Fx0A would only fail again, skip the fetch and dispatch until a key shows up
+        if (waiting_for_key && keys.load(std::memory_order_relaxed) == 0) {
+            if (delay_timer > 0) delay_timer--;
+            return;
+        }
+
+        //Both bytes are masked into memory, fetching the second byte past 0xFFF is a fault
+        faults |= (CHECKED && program_counter + 1 > 0x0FFF) * FAULT_PC_RANGE;
+        opcode = memory[program_counter & ADDRESS_MASK] << 8 | memory[(program_counter + 1) & ADDRESS_MASK];
+
         //Call function on opcode_table where the index equals the first hex digit of the opcode
         (this->*opcode_table[(opcode & 0xF000) >> 12])();
 
         // TODO Fully implement timers
         if (delay_timer > 0) delay_timer--;
+
+        halted = halt_on_fault && faults != 0;
+    }
+
+    uint64_t Chip8::Run(uint64_t cycles) {
+        uint64_t skipped = 0;
+
+        if (fused_patterns_stale) {
+            fused_patterns.fill(FUSED_UNKNOWN);
+            fused_patterns_stale = false;
+        }
+
+        while (cycles > 0) {
+            //Halting, waiting for a key, a fault that halts after the next instruction and fetching across the end
+            //of memory are left to EmulateCycle(), the first two after trying to fast forward them
+            if (halted || waiting_for_key || (halt_on_fault && faults != 0) || program_counter > 0x0FFA) {
+                uint64_t idle = halted || waiting_for_key ? SkipIdleCycles(cycles) : 0;
+                if (idle > 0) {
+                    skipped += idle;
+                    cycles -= idle;
+                } else {
+                    EmulateCycle();
+                    cycles--;
+                }
+                continue;
+            }
+
+            //Idle loops are marked in the same table as the superinstructions, so the loop start is the only place
+            //SkipIdleCycles() is tried and every other instruction pays one lookup
+            uint8_t &pattern = fused_patterns[program_counter];
+            if (pattern == FUSED_UNKNOWN) pattern = DecodeFusedPattern(program_counter);
+            if (pattern == FUSED_IDLE_LOOP) {
+                uint64_t idle = SkipIdleCycles(cycles);
+                if (idle > 0) {
+                    skipped += idle;
+                    cycles -= idle;
+                    continue;
+                }
+            } else if (pattern != FUSED_NONE && cycles >= 3) {
+                //Superinstructions run up to 3 cycles at once
+                cycles -= (this->*fused_table[pattern])();
+                continue;
+            }
+
+            EmulateCycle();
+            cycles--;
+        }
+
+        counters.skipped_cycles += skipped;
+        return skipped;
+    }
+
+    Chip8::FusedPattern Chip8::DecodeFusedPattern(unsigned short address) const {
+        unsigned short first = memory[address] << 8 | memory[address + 1];
+        unsigned short second = memory[address + 2] << 8 | memory[address + 3];
+        unsigned short third = memory[address + 4] << 8 | memory[address + 5];
+
+        //The shapes SkipIdleCycles() knows: JP to itself, Ex9E or ExA1 then JP back and Fx07 3x.. then JP back
+        unsigned short jump_back = 0x1000 | address;
+        int x = (first & 0x0F00) >> 8;
+        if (first == jump_back) return FUSED_IDLE_LOOP;
+        if (second == jump_back && ((first & 0xF0FF) == 0xE09E || (first & 0xF0FF) == 0xE0A1)) return FUSED_IDLE_LOOP;
+        if ((first & 0xF0FF) == 0xF007 && (second & 0xFF00) == (0x3000 | x << 8) && third == jump_back) {
+            return FUSED_IDLE_LOOP;
+        }
+
+        bool immediate_first = (first & 0xE000) == 0x6000;
+        bool immediate_second = (second & 0xE000) == 0x6000;
+        bool skip_second = (second & 0xF000) == 0x3000 || (second & 0xF000) == 0x4000;
+
+        if ((first & 0xF0FF) == 0xF007 && (second & 0xF000) == 0x3000 && (third & 0xF000) == 0x1000) {
+            return FUSED_TIMER_POLL;
+        }
+        bool load_first = (first & 0xF000) == 0xA000 || (first & 0xF0FF) == 0xF029;
+        if (load_first && (second & 0xF000) == 0xD000) return FUSED_LOAD_DRAW;
+        if ((first & 0xF000) == 0x7000 && skip_second) return FUSED_ADD_SKIP;
+        if (immediate_first && immediate_second) return FUSED_IMMEDIATES;
+        if (immediate_first && (second & 0xF000) == 0x1000) return FUSED_IMMEDIATE_JUMP;
+        return FUSED_NONE;
+    }
+
+    void Chip8::InvalidateFusedPatterns(int address, int length) {
+        //A pattern is at most 6 bytes, so the ones starting up to 5 bytes before the write may cover it
+        for (int i = address - 5; i < address + length; i++) fused_patterns[i & 0x0FFF] = FUSED_UNKNOWN;
+    }
+
+    unsigned short Chip8::FetchOpcode() const {
+        return memory[program_counter] << 8 | memory[program_counter + 1];
+    }
+
+    void Chip8::CountDownDelayTimer() {
+        if (delay_timer > 0) delay_timer--;
+    }
+
+    //The superinstructions below do exactly what stepping the same instructions with EmulateCycle() does, including
+    //the opcode left behind and the delay timer count down after every instruction. Only the DXYN ending
+    //FusedLoadDraw() can fault and Run() steps while an earlier fault is about to halt, so halting only needs to be
+    //checked at the end.
+
+    int Chip8::FusedLoadDraw() { //ANNN or FX29, DXYN -> LD I, addr or LD F, Vx; DRW Vx, Vy, nibble
+        opcode = FetchOpcode();
+        index_register = (opcode & 0xF000) == 0xA000 ? opcode & 0x0FFF : v[(opcode & 0x0F00) >> 8] * 5;
+        program_counter += 2;
+        CountDownDelayTimer();
+
+        opcode = FetchOpcode();
+        DisplaySprite();
+        CountDownDelayTimer();
+
+        halted = halt_on_fault && faults != 0;
+        return 2;
+    }
+
+    int Chip8::FusedImmediates() { //6XNN or 7XNN, twice -> LD Vx, byte or ADD Vx, byte
+        for (int i = 0; i < 2; i++) {
+            opcode = FetchOpcode();
+            unsigned char &vx = v[(opcode & 0x0F00) >> 8];
+            vx = (opcode & 0xF000) == 0x6000 ? (opcode & 0x00FF) : vx + (opcode & 0x00FF);
+            program_counter += 2;
+            CountDownDelayTimer();
+        }
+
+        halted = halt_on_fault && faults != 0;
+        return 2;
+    }
+
+    int Chip8::FusedImmediateJump() { //6XNN or 7XNN, 1NNN -> LD Vx, byte or ADD Vx, byte; JP addr
+        opcode = FetchOpcode();
+        unsigned char &vx = v[(opcode & 0x0F00) >> 8];
+        vx = (opcode & 0xF000) == 0x6000 ? (opcode & 0x00FF) : vx + (opcode & 0x00FF);
+        program_counter += 2;
+        CountDownDelayTimer();
+
+        opcode = FetchOpcode();
+        program_counter = opcode & 0x0FFF;
+        CountDownDelayTimer();
+
+        halted = halt_on_fault && faults != 0;
+        return 2;
+    }
+
+    int Chip8::FusedAddSkip() { //7XNN 3XNN or 4XNN -> ADD Vx, byte; SE or SNE Vx, byte
+        opcode = FetchOpcode();
+        v[(opcode & 0x0F00) >> 8] += opcode & 0x00FF;
+        program_counter += 2;
+        CountDownDelayTimer();
+
+        opcode = FetchOpcode();
+        bool equal = v[(opcode & 0x0F00) >> 8] == (opcode & 0x00FF);
+        program_counter += equal == ((opcode & 0xF000) == 0x3000) ? 4 : 2;
+        CountDownDelayTimer();
+
+        halted = halt_on_fault && faults != 0;
+        return 2;
     }
 
-    void Chip8::PopulateOpCodeTables() {
-        opcode_table = {&Chip8::OpCodeZero, &Chip8::Jump, &Chip8::Call, &Chip8::RegisterAndConstantSE,
-                        &Chip8::RegisterAndConstantSNE, &Chip8::TwoRegistersSE, &Chip8::LoadConstantIntoRegister,
-                        &Chip8::AddConstantToRegister, &Chip8::OpCodeEight, &Chip8::TwoRegistersSNE,
-                        &Chip8::SetRegisterIToConstant, &Chip8::JumpToConstantPlusV0, &Chip8::SetCpuRegisterRandom,
-                        &Chip8::DisplaySprite, &Chip8::OpCodeE, &Chip8::OpCodeF};
+    int Chip8::FusedTimerPoll() { //FX07 3XNN 1NNN -> LD Vx, DT; SE Vx, byte; JP addr
+        opcode = FetchOpcode();
+        v[(opcode & 0x0F00) >> 8] = delay_timer;
+        program_counter += 2;
+        CountDownDelayTimer();
+
+        //A taken skip jumps over the JP
+        opcode = FetchOpcode();
+        bool equal = v[(opcode & 0x0F00) >> 8] == (opcode & 0x00FF);
+        program_counter += equal ? 4 : 2;
+        CountDownDelayTimer();
+        if (equal) {
+            halted = halt_on_fault && faults != 0;
+            return 2;
+        }
 
-        opcode8_table = {&Chip8::StoreRegisterYInX, &Chip8::ORRegisterXAndY, &Chip8::ANDRegisterXAndY,
-                         &Chip8::XORRegisterXAndY, &Chip8::ADDRegisterXAndY, &Chip8::SUBRegisterXAndY,
-                         &Chip8::SHRRegisterX, &Chip8::SUBNRegisterXAndY, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid,
-                         &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid, &Chip8::OpCodeInvalid,
-                         &Chip8::SHLRegisterX, &Chip8::OpCodeInvalid};
+        opcode = FetchOpcode();
+        program_counter = opcode & 0x0FFF;
+        CountDownDelayTimer();
 
-        opcodeF_table = {&Chip8::OpCodeFx0x, &Chip8::OpCodeFx1x, &Chip8::LoadFontLocationIntoIndexRegister, &Chip8::StoreBCDInMemory,
-                         &Chip8::OpCodeInvalid, &Chip8::LoadRegistersIntoMemory, &Chip8::LoadMemoryIntoRegisters};
+        halted = halt_on_fault && faults != 0;
+        return 3;
+    }
+
+    uint64_t Chip8::SkipIdleCycles(uint64_t max_cycles) {
+        //Nothing but the delay timer changes while halted, waiting in Fx0A or jumping to the same address
+        if (halted) return max_cycles;
+
+        auto count_down = [this](uint64_t cycles) {
+            delay_timer = cycles >= delay_timer ? 0 : delay_timer - cycles;
+        };
+
+        if (waiting_for_key && keys.load(std::memory_order_relaxed) == 0) {
+            count_down(max_cycles);
+            return max_cycles;
+        }
+
+        //The patterns are at most three instructions, near the end of memory they would fetch across the wrap
+        unsigned short pc = program_counter;
+        if (pc > 0x0FFA) return 0;
+
+        auto opcode_at = [this](unsigned short address) {
+            return static_cast<unsigned short>(memory[address] << 8 | memory[address + 1]);
+        };
+        unsigned short first = opcode_at(pc);
+        unsigned short jump_back = 0x1000 | pc;
+
+        if (first == jump_back) {
+            opcode = first;
+            count_down(max_cycles);
+            return max_cycles;
+        }
+
+        int x = (first & 0x0F00) >> 8;
+        unsigned short second = opcode_at(pc + 2);
+
+        //Ex9E / JP back waits for key Vx, ExA1 / JP back for its release, two cycles per pass
+        if (second == jump_back && ((first & 0xF0FF) == 0xE09E || (first & 0xF0FF) == 0xE0A1)) {
+            bool waiting = IsKeyPressed(v[x]) == ((first & 0x00FF) == 0x00A1);
+            uint64_t passes = waiting ? max_cycles / 2 : 0;
+            if (passes == 0) return 0;
+
+            opcode = second;
+            count_down(passes * 2);
+            return passes * 2;
+        }
+
+        //Fx07 / 3x00 / JP back polls the delay timer until it reads NN, three cycles per pass and the timer goes down
+        //on every cycle, so the value read in pass k is max(DT - 3k, 0)
+        if ((first & 0xF0FF) == 0xF007 && (second & 0xFF00) == (0x3000 | x << 8) &&
+            opcode_at(pc + 4) == jump_back) {
+            unsigned value = second & 0x00FF;
+            uint64_t passes = max_cycles / 3;
+
+            if (value == 0) passes = std::min<uint64_t>(passes, (delay_timer + 2) / 3);
+            else if (delay_timer >= value && (delay_timer - value) % 3 == 0) {
+                passes = std::min<uint64_t>(passes, (delay_timer - value) / 3);
+            } //Otherwise the timer steps over NN and the loop never ends
+            if (passes == 0) return 0;
+
+            uint64_t last_read = 3 * (passes - 1);
+            v[x] = last_read >= delay_timer ? 0 : delay_timer - last_read;
+            opcode = opcode_at(pc + 4);
+            count_down(passes * 3);
+            return passes * 3;
+        }
+
+        return 0;
+    }
+
+    void Chip8::CheckMemoryRange(int length) {
+        //Last byte of the access, no branch so the common in range case costs a compare and an or
+        faults |= (CHECKED && index_register + length - 1 > 0x0FFF) * FAULT_MEMORY_RANGE;
     }
 
     void Chip8::OpCodeInvalid() {
-        std::cerr << "Invalid opcode" << std::endl;
+        faults |= FAULT_INVALID_OPCODE;
     }
 
     void Chip8::OpCodeZero() {//Opcodes 0XXX
         if (opcode == 0x00E0) { //CLS
-            for (auto &i : gfx) {
-                for (auto &&j : i) {
-                    j = false;
-                }
-            }
+            gfx.Clear();
+            gfx_hash = 0;
         } else if (opcode == 0x00EE) { //RET
-            stack_pointer--;
-            program_counter = stack[stack_pointer];
+            //An empty stack leaves the stack pointer at 0 and returns to the bottom entry
+            bool underflow = CHECKED && stack_pointer == 0;
+            faults |= underflow * FAULT_STACK_UNDERFLOW;
+            stack_pointer = stack_pointer - 1 + underflow;
+            program_counter = stack[stack_pointer & STACK_MASK];
         }
         SetPCToNextInstruction();
     }
@@ -79,8 +464,11 @@ namespace Emulator {
     }
 
     void Chip8::Call() { //Opcode 2XXX -> CALL addr
-        stack[stack_pointer] = program_counter;
-        stack_pointer++;
+        //A full stack keeps the stack pointer at 16 and overwrites the bottom entry
+        bool overflow = CHECKED && stack_pointer >= 16;
+        faults |= overflow * FAULT_STACK_OVERFLOW;
+        stack[stack_pointer & STACK_MASK] = program_counter;
+        stack_pointer = stack_pointer + 1 - overflow;
         program_counter = opcode & 0x0FFF;
     }
 
@@ -178,50 +566,61 @@ namespace Emulator {
     }
 
     void Chip8::SetCpuRegisterRandom() { //Opcode CXXX -> RND Vx, byte
-        v[(opcode & 0x0F00) >> 8] =
-                static_cast<unsigned char>((0x00FF & opcode)) & static_cast<unsigned char>(dist->operator()(*mt));
+        unsigned char random_byte = random_source ? random_source() : rng.NextByte();
+        v[(opcode & 0x0F00) >> 8] = static_cast<unsigned char>(0x00FF & opcode) & random_byte;
         SetPCToNextInstruction();
     }
 
     void Chip8::DisplaySprite() { //Opcode DXXX -> DRW Vx, Vy, nibble
         int number_of_bytes = opcode & 0x000F;
-        int x = v[(opcode & 0x0F00) >> 8];
+        int x = v[(opcode & 0x0F00) >> 8] & (Framebuffer::WIDTH - 1);
         int y = v[(opcode & 0x00F0) >> 4];
 
-        std::vector<int> bitmask = {128, 64, 32, 16, 8, 4, 2, 1};
-        std::vector<int> x_pos(8);
+        //A sprite row covers at most two framebuffer bytes, the second one wraps around horizontally
+        int left_byte = x >> 3;
+        int right_byte = (left_byte + 1) & (Framebuffer::BYTES_PER_ROW - 1);
+        int shift = x & 7;
+        bool collision = false;
 
-        //Init overflow register as 0
-        v[15] = 0;
+        CheckMemoryRange(number_of_bytes);
 
-        //For horizontal display wrap around
-        for (int i = 0; i < 8; i++) {
-            if(x+i < 64) x_pos[i] = x+i;
-            else x_pos[i] = x+i-64;
-        }
+        //Rows are XORed as whole words, byte k of a row is byte k of the word in memory
+        int left_position = RowBytePosition(left_byte);
+        int right_position = RowBytePosition(right_byte);
 
+        uint64_t hash_change = 0;
         for (int i = 0; i < number_of_bytes; ++i) {
-            unsigned char row_of_pixels = memory[index_register + i];
-
-            if(y+i >= 32) y = -i; //For vertical display wrap around
-
-            for (int j = 0; j < 8; ++j) {
-                if(v[15] != 1 && (row_of_pixels & bitmask[j]) > 0 && gfx[y+i][x_pos[j]]) v[15] = 1;
-                gfx[y+i][x_pos[j]] = ((row_of_pixels & bitmask[j]) > 0) ^ gfx[y+i][x_pos[j]];
-            }
+            unsigned char row_of_pixels = memory[(index_register + i) & ADDRESS_MASK];
+            int row_index = (y + i) & (Framebuffer::HEIGHT - 1); //For vertical display wrap around
+
+            uint8_t left = row_of_pixels >> shift;
+            uint8_t right = shift == 0 ? 0 : static_cast<uint8_t>(row_of_pixels << (8 - shift));
+            uint64_t sprite = static_cast<uint64_t>(left) << left_position | static_cast<uint64_t>(right) << right_position;
+
+            uint64_t row;
+            memcpy(&row, gfx.Row(row_index), sizeof(row));
+            collision |= (row & sprite) != 0;
+            hash_change += hash_keys.gfx[row_index] * ((row ^ sprite) - row);
+            row ^= sprite;
+            memcpy(gfx.Row(row_index), &row, sizeof(row));
         }
+        gfx_hash += hash_change;
+
+        v[15] = collision;
+        counters.sprites++;
+        counters.collisions += v[15];
 
         SetPCToNextInstruction();
     }
 
     void Chip8::OpCodeE() { //Opcode EXXX -> Skip next instruction depending on key state
         if ((opcode & 0x00FF) == 0x009E) { //qq1r4q1q1raqOpcode EX9E -> SKP Vx
-            if (key_pressed[v[(opcode & 0x0F00) >> 8]]) SetPCToSkipNextInstruction();
+            if (IsKeyPressed(v[(opcode & 0x0F00) >> 8])) SetPCToSkipNextInstruction();
             else SetPCToNextInstruction();
         } else if ((opcode & 0x00FF) == 0x00A1) { //Opcode EXA1 -> SKNP Vx
-            if (!key_pressed[v[(opcode & 0x0F00) >> 8]]) SetPCToSkipNextInstruction();
+            if (!IsKeyPressed(v[(opcode & 0x0F00) >> 8])) SetPCToSkipNextInstruction();
             else SetPCToNextInstruction();
-        }
+        } else OpCodeInvalid();
     }
 
     void Chip8::OpCodeF() { //Opcode FXXX
@@ -233,14 +632,15 @@ namespace Emulator {
             v[(opcode & 0x0F00) >> 8] = delay_timer;
             SetPCToNextInstruction();
         } else if ((opcode & 0x000F) == 0xA) { //LD Vx, K
-            for(int i = 0; i < 16; i++){
-                if(key_pressed[i]){
-                    v[(opcode & 0x0F00) >> 8] = i;
-                    SetPCToNextInstruction();
-                    break;
-                }
+            uint16_t pressed = keys.load(std::memory_order_relaxed);
+            waiting_for_key = pressed == 0;
+            if (!waiting_for_key) {
+                int key = 0;
+                while (!((pressed >> key) & 1)) key++; //Lowest pressed key wins
+                v[(opcode & 0x0F00) >> 8] = key;
+                SetPCToNextInstruction();
             }
-        }
+        } else OpCodeInvalid();
     }
 
     void Chip8::OpCodeFx1x() {
@@ -250,7 +650,7 @@ namespace Emulator {
             sound_timer = v[(opcode & 0x0F00) >> 8];
         } else if ((opcode & 0x000F) == 0xE) { //ADD I, Vx
             index_register += v[(opcode & 0x0F00) >> 8];
-        }
+        } else OpCodeInvalid();
         SetPCToNextInstruction();
     }
 
@@ -261,22 +661,29 @@ namespace Emulator {
 
     void Chip8::StoreBCDInMemory() { //Opcode Fx33 -> LD B, Vx
         unsigned char number = v[(opcode & 0x0F00) >> 8];
-        memory[index_register] = number/100;
-        memory[index_register+1] = (number/10) % 10;
-        memory[index_register+2] = (number % 100) % 10;
+        CheckMemoryRange(3);
+        memory_hash += StoreMemory(index_register, number/100) +
+                       StoreMemory(index_register+1, (number/10) % 10) +
+                       StoreMemory(index_register+2, (number % 100) % 10);
+        InvalidateFusedPatterns(index_register, 3);
         SetPCToNextInstruction();
     }
 
     void Chip8::LoadRegistersIntoMemory() { //Opcode Fx55 -> LD [I], Vx
+        CheckMemoryRange(((opcode & 0x0F00) >> 8) + 1);
+        uint64_t hash_change = 0;
         for(int i = 0; i <= ((opcode & 0x0F00) >> 8); i++){
-            memory[index_register+i] = v[i];
+            hash_change += StoreMemory(index_register+i, v[i]);
         }
+        memory_hash += hash_change;
+        InvalidateFusedPatterns(index_register, ((opcode & 0x0F00) >> 8) + 1);
         SetPCToNextInstruction();
     }
 
     void Chip8::LoadMemoryIntoRegisters() { //Opcode Fx65 -> LD Vx, [I]
+        CheckMemoryRange(((opcode & 0x0F00) >> 8) + 1);
         for(int i = 0; i <= ((opcode & 0x0F00) >> 8); i++){
-            v[i] = memory[index_register+i];
+            v[i] = memory[(index_register+i) & ADDRESS_MASK];
         }
         SetPCToNextInstruction();
     }
@@ -290,134 +697,76 @@ namespace Emulator {
     }
 
     void Chip8::LoadHexDigitSpriteIntoMemory() {
-
-        //Zero
-        memory[0] = 0xF0;
-        memory[1] = 0x90;
-        memory[2] = 0x90;
-        memory[3] = 0x90;
-        memory[4] = 0xF0;
-
-        //One
-        memory[5] = 0x20;
-        memory[6] = 0x60;
-        memory[7] = 0x20;
-        memory[8] = 0x20;
-        memory[9] = 0x70;
-
-        //Two
-        memory[10] = 0xF0;
-        memory[11] = 0x10;
-        memory[12] = 0xF0;
-        memory[13] = 0x80;
-        memory[14] = 0xF0;
-
-        //Three
-        memory[15] = 0xF0;
-        memory[16] = 0x10;
-        memory[17] = 0xF0;
-        memory[18] = 0x10;
-        memory[19] = 0xF0;
-
-        //Four
-        memory[20] = 0x90;
-        memory[21] = 0x90;
-        memory[22] = 0xF0;
-        memory[23] = 0x10;
-        memory[24] = 0x10;
-
-        //Five
-        memory[25] = 0xF0;
-        memory[26] = 0x80;
-        memory[27] = 0xF0;
-        memory[28] = 0x10;
-        memory[29] = 0xF0;
-
-        //Six
-        memory[30] = 0xF0;
-        memory[31] = 0x80;
-        memory[32] = 0xF0;
-        memory[33] = 0x90;
-        memory[34] = 0xF0;
-
-        //Seven
-        memory[35] = 0xF0;
-        memory[36] = 0x10;
-        memory[37] = 0x20;
-        memory[38] = 0x40;
-        memory[39] = 0x40;
-
-        //Eight
-        memory[40] = 0xF0;
-        memory[41] = 0x90;
-        memory[42] = 0xF0;
-        memory[43] = 0x90;
-        memory[44] = 0xF0;
-
-        //Nine
-        memory[45] = 0xF0;
-        memory[46] = 0x90;
-        memory[47] = 0xF0;
-        memory[48] = 0x10;
-        memory[49] = 0xF0;
-
-        //A
-        memory[50] = 0xF0;
-        memory[51] = 0x90;
-        memory[52] = 0xF0;
-        memory[53] = 0x90;
-        memory[54] = 0x90;
-
-        //B
-        memory[55] = 0xE0;
-        memory[56] = 0x90;
-        memory[57] = 0xE0;
-        memory[58] = 0x90;
-        memory[59] = 0xE0;
-
-        //C
-        memory[60] = 0xF0;
-        memory[61] = 0x80;
-        memory[62] = 0x80;
-        memory[63] = 0x80;
-        memory[64] = 0xF0;
-
-        //D
-        memory[65] = 0xE0;
-        memory[66] = 0x90;
-        memory[67] = 0x90;
-        memory[68] = 0x90;
-        memory[69] = 0xE0;
-
-        //E
-        memory[70] = 0xF0;
-        memory[71] = 0x80;
-        memory[72] = 0xF0;
-        memory[73] = 0x80;
-        memory[74] = 0xF0;
-
-        //F
-        memory[75] = 0xF0;
-        memory[76] = 0x80;
-        memory[77] = 0xF0;
-        memory[78] = 0x80;
-        memory[79] = 0x80;
+        //Sprites for 0-F, 5 bytes each at the start of memory
+        static const unsigned char font[80] = {
+                0xF0, 0x90, 0x90, 0x90, 0xF0, //Zero
+                0x20, 0x60, 0x20, 0x20, 0x70, //One
+                0xF0, 0x10, 0xF0, 0x80, 0xF0, //Two
+                0xF0, 0x10, 0xF0, 0x10, 0xF0, //Three
+                0x90, 0x90, 0xF0, 0x10, 0x10, //Four
+                0xF0, 0x80, 0xF0, 0x10, 0xF0, //Five
+                0xF0, 0x80, 0xF0, 0x90, 0xF0, //Six
+                0xF0, 0x10, 0x20, 0x40, 0x40, //Seven
+                0xF0, 0x90, 0xF0, 0x90, 0xF0, //Eight
+                0xF0, 0x90, 0xF0, 0x10, 0xF0, //Nine
+                0xF0, 0x90, 0xF0, 0x90, 0x90, //A
+                0xE0, 0x90, 0xE0, 0x90, 0xE0, //B
+                0xF0, 0x80, 0x80, 0x80, 0xF0, //C
+                0xE0, 0x90, 0x90, 0x90, 0xE0, //D
+                0xF0, 0x80, 0xF0, 0x80, 0xF0, //E
+                0xF0, 0x80, 0xF0, 0x80, 0x80, //F
+        };
+        std::copy(std::begin(font), std::end(font), memory.begin());
     }
 
     void Chip8::SetCpuRegister(int index, unsigned char value) {
-        v[index] = value;
+        v[index & 0x0F] = value;
     }
 
     unsigned char Chip8::GetCpuRegister(int i) {
-        return v[i];
+        return v[i & 0x0F];
     }
 
     unsigned short Chip8::GetStack(int i) {
-        return stack[i];
+        return stack[i & 0x0F];
+    }
+
+    uint64_t Chip8::StoreMemory(int address, unsigned char value) {
+        address &= ADDRESS_MASK;
+        uint64_t hash_change = hash_keys.memory[address] * (uint64_t(value) - memory[address]);
+        memory[address] = value;
+        return hash_change;
+    }
+
+    void Chip8::RehashState() {
+        memory_hash = HashBytes(hash_keys.memory.data(), memory.data(), 0, static_cast<int>(memory.size()));
+        gfx_hash = HashRows(gfx);
     }
 
     void Chip8::WriteToMemory(int index, unsigned char value) {
-        memory[index] = value;
+        memory_hash += StoreMemory(index, value);
+        InvalidateFusedPatterns(index, 1);
+    }
+
+    void Chip8::WriteMemory(int address, std::span<const uint8_t> data) {
+        //At most two copies, up to the end of memory and the rest from 0x000, longer data overwrites itself
+        size_t start = address & 0x0FFF;
+        if (data.size() > memory.size()) {
+            start = (start + data.size() - memory.size()) & 0x0FFF;
+            data = data.last(memory.size());
+        }
+
+        int first = static_cast<int>(std::min(data.size(), memory.size() - start));
+        int rest = static_cast<int>(data.size()) - first;
+        memory_hash -= HashBytes(hash_keys.memory.data(), memory.data(), static_cast<int>(start), first) +
+                       HashBytes(hash_keys.memory.data(), memory.data(), 0, rest);
+        std::copy_n(data.begin(), first, memory.begin() + start);
+        std::copy_n(data.begin() + first, rest, memory.begin());
+        memory_hash += HashBytes(hash_keys.memory.data(), memory.data(), static_cast<int>(start), first) +
+                       HashBytes(hash_keys.memory.data(), memory.data(), 0, rest);
+
+        if (data.size() > 64) fused_patterns_stale = true;
+        else InvalidateFusedPatterns(static_cast<int>(start), static_cast<int>(data.size()));
     }
 
     unsigned short Chip8::GetIndexRegister() const {
@@ -460,11 +809,98 @@ namespace Emulator {
         Chip8::sound_timer = sound_timer;
     }
 
-    const std::vector<std::vector<bool>> &Chip8::GetGfx() const {
+    const Framebuffer &Chip8::GetGfx() const {
         return gfx;
     }
 
     unsigned char Chip8::GetMemory(int index) {
-        return memory[index];
+        return memory[index & 0x0FFF];
+    }
+
+    const Chip8Counters &Chip8::GetCounters() const {
+        return counters;
+    }
+
+    void Chip8::ResetCounters() {
+        counters = Chip8Counters();
+    }
+
+    void Chip8::SeedRandom(uint64_t seed) {
+        rng.Seed(seed);
+    }
+
+    void Chip8::SetRandomSource(RandomSource random_source) {
+        Chip8::random_source = std::move(random_source);
+    }
+
+    const std::array<uint32_t, 4> &Chip8::GetRandomState() const {
+        return rng.GetState();
+    }
+
+    void Chip8::SetRandomState(const std::array<uint32_t, 4> &state) {
+        rng.SetState(state);
+    }
+
+    void Chip8::SetKeyPressed(int key, bool pressed) {
+        uint16_t bit = 1u << (key & 0xF);
+        if (pressed) keys.fetch_or(bit, std::memory_order_relaxed);
+        else keys.fetch_and(static_cast<uint16_t>(~bit), std::memory_order_relaxed);
+    }
+
+    bool Chip8::IsKeyPressed(int key) const {
+        return (keys.load(std::memory_order_relaxed) >> (key & 0xF)) & 1;
+    }
+
+    uint16_t Chip8::GetKeyState() const {
+        return keys.load(std::memory_order_relaxed);
+    }
+
+    void Chip8::SetKeyState(uint16_t keys) {
+        Chip8::keys.store(keys, std::memory_order_relaxed);
+    }
+
+    bool Chip8::IsWaitingForKey() const {
+        return waiting_for_key;
+    }
+
+    uint8_t Chip8::GetFaults() const {
+        return faults;
+    }
+
+    void Chip8::ClearFaults() {
+        faults = 0;
+        halted = false;
+    }
+
+    void Chip8::SetHaltOnFault(bool halt_on_fault) {
+        Chip8::halt_on_fault = halt_on_fault;
+    }
+
+    bool Chip8::IsHalted() const {
+        return halted;
+    }
+
+    const Chip8State &Chip8::GetState() const {
+        return *this;
+    }
+
+    void Chip8::SetState(const Chip8State &state) {
+        //Run ahead and rollback restore a state of the same program every frame, comparing the memory is cheaper
+        //than decoding every address it runs again. Machines that never Run() have nothing to keep
+        if (!fused_patterns_stale && memcmp(memory.data(), state.memory.data(), memory.size()) != 0) {
+            fused_patterns_stale = true;
+        }
+        static_cast<Chip8State &>(*this) = state;
+    }
+
+    uint64_t Chip8::StateHash() const {
+        return CombineStateHash(*this, memory_hash, gfx_hash);
+    }
+
+    uint64_t Chip8::HashState(const Chip8State &state) {
+        return CombineStateHash(state,
+                                HashBytes(hash_keys.memory.data(), state.memory.data(), 0,
+                                          static_cast<int>(state.memory.size())),
+                                HashRows(state.gfx));
     }
 }
\ No newline at end of file
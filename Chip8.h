@@ -3,38 +3,121 @@
 
 #include <string>
 #include <vector>
-#include <random>
-#include <memory>
+#include <array>
+#include <cstdint>
+#include <atomic>
+#include <span>
+#include "Framebuffer.h"
+#include "Random.h"
 
 namespace Emulator {
 
-    class Chip8 {
+    //Fault flags, they stay set until ClearFaults() is called
+    const uint8_t FAULT_MEMORY_RANGE = 1; //A memory access went past 0xFFF and wrapped around to 0x000
+    const uint8_t FAULT_PC_RANGE = 2; //An instruction was fetched from past the end of memory
+    const uint8_t FAULT_STACK_OVERFLOW = 4; //CALL with all 16 stack levels in use
+    const uint8_t FAULT_STACK_UNDERFLOW = 8; //RET with an empty stack
+    const uint8_t FAULT_INVALID_OPCODE = 16; //An opcode that isn't an instruction, it does nothing
 
-    private:
-        std::unique_ptr<std::mt19937> mt;
-        std::unique_ptr<std::uniform_real_distribution<double>> dist;
+    //Everything that changes while a program runs. It is trivially copyable, so a whole machine is saved, restored or
+    //reset with a single memcpy
+    struct Chip8State {
+        Xoshiro128 rng;
+
+        //Sums of a fixed random multiplier per memory byte or framebuffer row times its value, updated by every write
+        uint64_t memory_hash = 0;
+        uint64_t gfx_hash = 0;
+
+        Framebuffer gfx{}; //64*32 Pixel screen
+        std::array<unsigned char, 4096> memory{}; //4096 bytes of memory, every index is masked with 0xFFF
+        std::array<unsigned char, 16> v{}; //CPU registers named V0 to VE, last register is the carry flag
+        std::array<unsigned short, 16> stack{}; //16 Stacklevels, indexed with stack_pointer & 0xF
 
-        std::vector<void (Chip8::*)()> opcode_table;
-        std::vector<void (Chip8::*)()> opcode8_table;
-        std::vector<void (Chip8::*)()> opcodeF_table;
+        unsigned short opcode = 0;
 
-        std::vector<std::vector<bool>> gfx; //64*32 Pixel screen
-        std::vector<unsigned char> memory; //4096 bits of memory
-        std::vector<unsigned char> v; //CPU registers named V0 to VE, last register is the carry flag
-        std::vector<unsigned short> stack; //16 Stacklevels
+        unsigned short index_register = 0;
+        unsigned short program_counter = 0x200;
+        unsigned char stack_pointer = 0;
 
-        unsigned short opcode;
+        unsigned char delay_timer = 0;
+        unsigned char sound_timer = 0;
 
-        unsigned short index_register;
-        unsigned short program_counter;
-        unsigned char stack_pointer;
+        bool waiting_for_key = false; //Set while Fx0A blocks execution until a key is pressed
 
-        unsigned char delay_timer;
-        unsigned char sound_timer;
+        uint8_t faults = 0;
+        bool halted = false;
+
+        //The hashes align the struct to 8 bytes, fill the tail so there is no padding that could differ between
+        //equal states
+        uint8_t unused[4]{};
+    };
 
-        void PopulateOpCodeTables();
+    //Event counts for metrics. They aren't part of Chip8State, so restoring a state doesn't rewind them
+    struct Chip8Counters {
+        uint64_t sprites = 0; //DRW instructions
+        uint64_t collisions = 0; //DRW instructions that erased a pixel
+        uint64_t skipped_cycles = 0; //Cycles fast forwarded by Run()
+    };
+
+    class Chip8 : private Chip8State {
+
+    private:
+        using Handler = void (Chip8::*)();
+        using FusedHandler = int (Chip8::*)(); //Returns the number of instructions it ran
+
+        //Superinstructions Run() executes with a single dispatch, picked from opcode pair counts of the conformance
+        //corpus (Chip8Conformance --pairs). Each one runs 2 or 3 instructions that don't write memory, the DXYN of
+        //FUSED_LOAD_DRAW writes the framebuffer and is the only one that can fault.
+        enum FusedPattern : uint8_t {
+            FUSED_NONE, //Stepped with EmulateCycle(), has no handler
+            FUSED_LOAD_DRAW, //ANNN DXYN or FX29 DXYN
+            FUSED_IMMEDIATES, //6XNN or 7XNN twice
+            FUSED_IMMEDIATE_JUMP, //6XNN 1NNN or 7XNN 1NNN
+            FUSED_ADD_SKIP, //7XNN 3XNN or 7XNN 4XNN
+            FUSED_TIMER_POLL, //FX07 3XNN 1NNN
+            FUSED_PATTERNS,
+            FUSED_IDLE_LOOP = 0xFE, //One of the loops SkipIdleCycles() fast forwards, stepped when it can't
+            FUSED_UNKNOWN = 0xFF //Not decoded since the last write to the memory it covers
+        };
+
+        static const std::array<Handler, 16> opcode_table;
+        static const std::array<Handler, 16> opcode8_table;
+        static const std::array<Handler, 16> opcodeF_table;
+        static const std::array<FusedHandler, FUSED_PATTERNS> fused_table;
+
+        RandomSource random_source;
+
+        std::atomic<uint16_t> keys; //One bit per key of the hex keypad, may be written from an input thread
+        bool halt_on_fault;
+        Chip8Counters counters;
+
+        //Fused pattern starting at every address, decoded lazily by Run(). Memory writes reset the addresses whose
+        //pattern could cover them, new states and ROMs reset the whole table before the next Run()
+        std::array<uint8_t, 4096> fused_patterns;
+        bool fused_patterns_stale;
+
+        static uint64_t RandomSeed();
+
+        void CheckMemoryRange(int length);
+        uint64_t SkipIdleCycles(uint64_t max_cycles);
         void LoadHexDigitSpriteIntoMemory();
 
+        //Returns the change of memory_hash, callers add it up so the sum stays in a register
+        uint64_t StoreMemory(int address, unsigned char value);
+        void RehashState();
+
+        unsigned short FetchOpcode() const;
+        void CountDownDelayTimer();
+        void InvalidateFusedPatterns(int address, int length);
+        FusedPattern DecodeFusedPattern(unsigned short address) const;
+
+        //Superinstructions
+        int FusedLoadDraw();
+        int FusedImmediates();
+        int FusedImmediateJump();
+        int FusedAddSkip();
+        int FusedTimerPoll();
+
         //Functions for the opcodes
         void OpCodeInvalid();
         void OpCodeZero();
@@ -76,14 +159,37 @@ namespace Emulator {
         void LoadMemoryIntoRegisters();
 
     public:
-        std::vector<bool> key_pressed;
-
         Chip8();
+        explicit Chip8(uint64_t seed);
         explicit Chip8(std::string path);
+        Chip8(std::string path, uint64_t seed);
+
+        //Replaces the running program, the machine is reset to its power on state with the ROM at 0x200.
+        //The random state, the keys and the settings are kept.
+        void LoadRom(std::span<const uint8_t> rom);
+        bool LoadRomFile(const std::string &path);
 
         void EmulateCycle();
 
-        const std::vector<std::vector<bool>> &GetGfx() const;
+        //Same as calling EmulateCycle() cycles times, but loops that only wait (a jump to itself, polling the delay
+        //timer with Fx07/3x00 or a key with Ex9E/ExA1, and Fx0A without a key) are fast forwarded in one step.
+        //Common instruction pairs and triples run as superinstructions with a single dispatch.
+        //The key state is assumed not to change during the call. Returns the number of fast forwarded cycles.
+        uint64_t Run(uint64_t cycles);
+
+        void SetKeyPressed(int key, bool pressed);
+        bool IsKeyPressed(int key) const;
+        uint16_t GetKeyState() const;
+        void SetKeyState(uint16_t keys);
+        bool IsWaitingForKey() const;
+
+        uint8_t GetFaults() const;
+        void ClearFaults();
+        //Wrapping is the default, with halt on fault the emulator stops at the end of the faulting instruction
+        void SetHaltOnFault(bool halt_on_fault);
+        bool IsHalted() const;
+
+        const Framebuffer &GetGfx() const;
         unsigned short GetIndexRegister() const;
         void SetIndexRegister(unsigned short index_register);
         unsigned short GetProgramCounter() const;
@@ -98,7 +204,28 @@ namespace Emulator {
         unsigned char GetCpuRegister(int i);
         unsigned short GetStack(int i);
         void WriteToMemory(int index, unsigned char value);
+        //Copies data to memory starting at address, wrapping around at 0xFFF like every other access
+        void WriteMemory(int address, std::span<const uint8_t> data);
         unsigned char GetMemory(int index);
+
+        const Chip8Counters &GetCounters() const;
+        void ResetCounters();
+
+        void SeedRandom(uint64_t seed);
+        void SetRandomSource(RandomSource random_source);
+        const std::array<uint32_t, 4> &GetRandomState() const;
+        void SetRandomState(const std::array<uint32_t, 4> &state);
+
+        //The key state and the fault and random source settings aren't part of the machine state
+        const Chip8State &GetState() const;
+        void SetState(const Chip8State &state);
+
+        //Hash of the whole machine state except the last opcode, equal states have equal hashes. Memory and the
+        //framebuffer are hashed incrementally as they are written, so this only mixes in the registers, stack,
+        //timers and random state. The multipliers are fixed, hashes can be compared across runs.
+        uint64_t StateHash() const;
+        //The same hash computed from scratch, for states that aren't loaded into a machine
+        static uint64_t HashState(const Chip8State &state);
     };
 }
 
@@ -0,0 +1,48 @@
+#include "Chip8Pool.h"
+
+namespace Emulator {
+
+    Chip8Pool::Chip8Pool(size_t capacity, const std::vector<uint8_t> &rom, uint64_t seed) :
+            slots(new Slot[capacity]), capacity(capacity) {
+        Chip8 image(seed);
+        image.LoadRom(rom);
+        golden = image.GetState();
+
+        //Handed out from the back, so the first Acquire() gets the first slot
+        free_list.reserve(capacity);
+        for (size_t i = capacity; i > 0; i--) free_list.push_back(&slots[i - 1].chip8);
+    }
+
+    Chip8 *Chip8Pool::Acquire() {
+        if (free_list.empty()) return nullptr;
+
+        Chip8 *chip8 = free_list.back();
+        free_list.pop_back();
+        Reset(chip8);
+        return chip8;
+    }
+
+    void Chip8Pool::Release(Chip8 *chip8) {
+        free_list.push_back(chip8);
+    }
+
+    void Chip8Pool::Reset(Chip8 *chip8) const {
+        chip8->SetState(golden);
+        chip8->SetKeyState(0);
+        chip8->SetHaltOnFault(false);
+        chip8->SetRandomSource(nullptr);
+        chip8->ResetCounters();
+    }
+
+    size_t Chip8Pool::GetCapacity() const {
+        return capacity;
+    }
+
+    size_t Chip8Pool::GetAvailable() const {
+        return free_list.size();
+    }
+
+    size_t Chip8Pool::BytesPerInstance() {
+        return sizeof(Slot);
+    }
+}
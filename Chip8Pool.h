@@ -0,0 +1,47 @@
+#ifndef CHIP8_EMULATOR_C_CHIP8POOL_H
+#define CHIP8_EMULATOR_C_CHIP8POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    //Fixed arena of machines for fuzzing and batch jobs that go through millions of short runs.
+    //All machines are constructed once, each on its own cache lines, and handing one out only copies the golden
+    //image (font and ROM) into it and clearing the keys and settings. Not thread safe, use one pool per thread.
+    class Chip8Pool {
+
+    private:
+        struct alignas(64) Slot {
+            Chip8 chip8;
+
+            Slot() : chip8(0) {}
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        std::vector<Chip8 *> free_list;
+        size_t capacity;
+        Chip8State golden;
+
+    public:
+        //The ROM is loaded at 0x200, seed sets the random state every machine starts with
+        Chip8Pool(size_t capacity, const std::vector<uint8_t> &rom, uint64_t seed = 0);
+
+        //Returns a machine reset to the golden image, nullptr when all are in use
+        Chip8 *Acquire();
+        //Hands the machine back, it stays valid memory but must not be used anymore
+        void Release(Chip8 *chip8);
+
+        //Resets a machine that is in use to the golden image without giving it back
+        void Reset(Chip8 *chip8) const;
+
+        size_t GetCapacity() const;
+        size_t GetAvailable() const;
+        static size_t BytesPerInstance();
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_CHIP8POOL_H
@@ -0,0 +1,62 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include "Chip8Pool.h"
+
+TEST_CASE("Pool hands out aligned machines loaded with the golden image") {
+    //LD V0, 0x42 then RND V1, 0xFF
+    Emulator::Chip8Pool pool(2, {0x60, 0x42, 0xC1, 0xFF}, 5);
+    REQUIRE(Emulator::Chip8Pool::BytesPerInstance() % 64 == 0);
+
+    Emulator::Chip8 *first = pool.Acquire();
+    Emulator::Chip8 *second = pool.Acquire();
+    REQUIRE(first != nullptr);
+    REQUIRE(second != nullptr);
+    REQUIRE(pool.Acquire() == nullptr);
+    REQUIRE(pool.GetAvailable() == 0);
+
+    REQUIRE(reinterpret_cast<uintptr_t>(first) % 64 == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(second) % 64 == 0);
+    REQUIRE(first->GetMemory(0) == 0xF0); //Font
+    REQUIRE(first->GetMemory(0x201) == 0x42);
+    REQUIRE(first->GetProgramCounter() == 0x200);
+
+    //Every machine starts from the same random state
+    first->EmulateCycle();
+    first->EmulateCycle();
+    second->EmulateCycle();
+    second->EmulateCycle();
+    REQUIRE(first->GetCpuRegister(1) == second->GetCpuRegister(1));
+}
+
+TEST_CASE("Released machines are reset when they are handed out again") {
+    Emulator::Chip8Pool pool(1, {0x60, 0x42});
+
+    Emulator::Chip8 *chip8 = pool.Acquire();
+    chip8->EmulateCycle();
+    chip8->WriteToMemory(0x300, 0x99);
+    chip8->SetKeyPressed(3, true);
+    chip8->SetHaltOnFault(true);
+    REQUIRE(chip8->GetCpuRegister(0) == 0x42);
+    pool.Release(chip8);
+
+    Emulator::Chip8 *again = pool.Acquire();
+    REQUIRE(again == chip8);
+    REQUIRE(again->GetCpuRegister(0) == 0);
+    REQUIRE(again->GetMemory(0x300) == 0);
+    REQUIRE(again->GetProgramCounter() == 0x200);
+    REQUIRE(again->GetKeyState() == 0);
+}
+
+TEST_CASE("Machine state can be saved and restored") {
+    Emulator::Chip8 chip8(3);
+    chip8.WriteToMemory(0x200, 0x60);
+    chip8.WriteToMemory(0x201, 0x07);
+    Emulator::Chip8State saved = chip8.GetState();
+
+    chip8.EmulateCycle();
+    REQUIRE(chip8.GetCpuRegister(0) == 7);
+
+    chip8.SetState(saved);
+    REQUIRE(chip8.GetCpuRegister(0) == 0);
+    REQUIRE(chip8.GetProgramCounter() == 0x200);
+}
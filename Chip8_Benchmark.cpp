@@ -0,0 +1,716 @@
+//
+// Micro benchmarks for the emulator, pass a name to run only the benchmarks containing it
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Chip8.h"
+#include "Chip8Pool.h"
+#include "Explorer.h"
+#include "FrameDelta.h"
+#include "Netplay.h"
+#include "VideoExport.h"
+#include "Scaler.h"
+#include "RunAhead.h"
+#include "Scheduler.h"
+#include "VectorEnv.h"
+#include "VisitedSet.h"
+#include "SessionServer.h"
+#include "SharedDisplayWriter.h"
+#include "Trace.h"
+
+namespace {
+
+    struct Program {
+        const char *name;
+        std::vector<unsigned short> opcodes; //Loaded at 0x200
+        std::vector<std::pair<int, std::vector<unsigned short>>> subroutines; //Extra code at other addresses
+    };
+
+    const std::vector<Program> PROGRAMS = {
+            {"alu", {0x6005, 0x7101, 0x8014, 0x8125, 0x8306, 0x4000, 0x6000, 0x1202}, {}},
+            {"sprites", {0xA000, 0x6000, 0x6100, 0xD015, 0x7008, 0x7104, 0x1206}, {}},
+            {"memory", {0xA300, 0xF333, 0xF755, 0xF765, 0x1200}, {}},
+            {"calls", {0x2300, 0x1200}, {{0x300, {0x00EE}}}},
+            {"random", {0xC0FF, 0xC1FF, 0xC20F, 0x1200}, {}},
+    };
+
+    const uint64_t CYCLES = 20000000;
+
+    void WriteOpcodes(Emulator::Chip8 &chip8, int address, const std::vector<unsigned short> &opcodes) {
+        for (unsigned short opcode : opcodes) {
+            chip8.WriteToMemory(address++, opcode >> 8);
+            chip8.WriteToMemory(address++, opcode & 0xFF);
+        }
+    }
+
+    void LoadProgram(Emulator::Chip8 &chip8, const Program &program) {
+        WriteOpcodes(chip8, 0x200, program.opcodes);
+        for (const auto &subroutine : program.subroutines) WriteOpcodes(chip8, subroutine.first, subroutine.second);
+    }
+
+    template<typename Function>
+    double NanosecondsPer(uint64_t iterations, Function function) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    }
+
+    uint64_t ThreadCpuNanoseconds() {
+        timespec time = {};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+
+    //Against a build configured with -DCHIP8_UNCHECKED_ADDRESSING=ON this shows what masking and range faults cost
+    void BenchmarkInterpreter() {
+#ifdef CHIP8_UNCHECKED_ADDRESSING
+        const char *addressing = "unchecked";
+#else
+        const char *addressing = "checked";
+#endif
+        for (const Program &program : PROGRAMS) {
+            Emulator::Chip8 chip8(1);
+            LoadProgram(chip8, program);
+
+            double ns = NanosecondsPer(CYCLES, [&]() {
+                for (uint64_t i = 0; i < CYCLES; i++) chip8.EmulateCycle();
+            });
+
+            printf("interpreter/%-10s %8.2f ns/instruction %8.1f MIPS, %s addressing\n", program.name, ns, 1000.0 / ns,
+                   addressing);
+        }
+    }
+
+    //Tracing is meant to stay under 3x the cost of EmulateCycle(), the flush thread compresses on the side
+    void BenchmarkTrace() {
+        const uint64_t TRACE_CYCLES = CYCLES / 10;
+        const char *path = "benchmark_trace.bin";
+
+        for (const Program &program : PROGRAMS) {
+            Emulator::Chip8 stepped(1), traced(1);
+            LoadProgram(stepped, program);
+            LoadProgram(traced, program);
+
+            double step_ns = NanosecondsPer(TRACE_CYCLES, [&]() {
+                for (uint64_t i = 0; i < TRACE_CYCLES; i++) stepped.EmulateCycle();
+            });
+            double trace_ns, thread_ns;
+            {
+                Emulator::TraceRecorder recorder(path);
+                Emulator::Tracer tracer(recorder);
+                uint64_t cpu_start = ThreadCpuNanoseconds();
+                trace_ns = NanosecondsPer(TRACE_CYCLES, [&]() {
+                    for (uint64_t i = 0; i < TRACE_CYCLES; i++) tracer.Step(traced);
+                });
+                thread_ns = (ThreadCpuNanoseconds() - cpu_start) / double(TRACE_CYCLES);
+            }
+
+            //With a core to spare only the emulator thread's own time slows it down, on a single core the
+            //compression is paid in the wall time as well
+            printf("trace/%-8s EmulateCycle %6.2f ns/instruction, Tracer::Step %6.2f ns/instruction %.2fx, "
+                   "%6.2f ns/instruction on its thread %.2fx\n", program.name, step_ns, trace_ns, trace_ns / step_ns,
+                   thread_ns, thread_ns / step_ns);
+        }
+        remove(path);
+    }
+
+    void BenchmarkScaler() {
+        const uint64_t FRAMES = 2000;
+
+        //Draw the sprite program for a while so the frame has a mix of lit and unlit bytes
+        Emulator::Chip8 chip8(1);
+        LoadProgram(chip8, PROGRAMS[1]);
+        for (int i = 0; i < 1000; i++) chip8.EmulateCycle();
+
+        for (int scale : {4, 16}) {
+            for (uint8_t persistence : {0, 192}) {
+                Emulator::Scaler scaler(scale);
+                scaler.SetScanlines(true);
+                scaler.SetPersistence(persistence);
+
+                double ns = NanosecondsPer(FRAMES, [&]() {
+                    for (uint64_t i = 0; i < FRAMES; i++) scaler.Scale(chip8.GetGfx());
+                });
+
+                printf("scaler/x%-2d persistence %-3d %8.3f ms/frame\n", scale, persistence, ns / 1e6);
+            }
+        }
+    }
+
+    //Screens that behave like games for the frame delta benchmark: a sprite moved with erase and redraw, and a line
+    //of digits redrawn after a clear every pass
+    const std::vector<Program> DISPLAY_PROGRAMS = {
+            {"ball", {0x6A00, 0x6B00, 0xA220, 0xDAB1, 0x6C03, 0xFC15, 0xFC07, 0x3C00, 0x120C, 0xDAB1, 0x7A01,
+                      0x7B01, 0x1206}, {{0x220, {0xC000}}}},
+            {"digits", {0x00E0, 0x6000, 0x8230, 0xF029, 0xD245, 0x7206, 0x7001, 0x300A, 0x1206, 0x7301, 0x1200}, {}},
+            {"sprites", PROGRAMS[1].opcodes, {}},
+            {"alu", PROGRAMS[0].opcodes, {}},
+    };
+
+    void BenchmarkFrameDelta() {
+        const int FRAMES = 20000;
+        const int CYCLES_PER_FRAME = 16;
+
+        for (const Program &program : DISPLAY_PROGRAMS) {
+            Emulator::Chip8 chip8(1);
+            LoadProgram(chip8, program);
+
+            std::vector<Emulator::Framebuffer> frames(FRAMES + 1);
+            frames[0].Clear();
+            for (int frame = 1; frame <= FRAMES; frame++) {
+                for (int cycle = 0; cycle < CYCLES_PER_FRAME; cycle++) chip8.EmulateCycle();
+                frames[frame] = chip8.GetGfx();
+            }
+
+            std::vector<uint8_t> delta;
+            size_t bytes = 0;
+            int empty = 0;
+            double ns = NanosecondsPer(FRAMES, [&]() {
+                for (int frame = 1; frame <= FRAMES; frame++) {
+                    delta.clear();
+                    Emulator::EncodeFrameDelta(frames[frame - 1], frames[frame], &delta);
+                    bytes += delta.size();
+                    empty += delta.empty();
+                }
+            });
+
+            printf("delta/%-8s %6.1f bytes/frame %5.1f%% unchanged %6.1f ns/frame\n", program.name,
+                   bytes / double(FRAMES), empty * 100.0 / FRAMES, ns);
+        }
+    }
+
+    void BenchmarkPool() {
+        const int INSTANCES = 1000000;
+        std::vector<uint8_t> rom;
+        for (unsigned short opcode : PROGRAMS[1].opcodes) {
+            rom.push_back(opcode >> 8);
+            rom.push_back(opcode & 0xFF);
+        }
+
+        //Each instance runs a few instructions so the work isn't optimized away
+        auto use = [](Emulator::Chip8 &chip8) {
+            for (int i = 0; i < 4; i++) chip8.EmulateCycle();
+            return chip8.GetIndexRegister();
+        };
+
+        unsigned sink = 0;
+        double heap = NanosecondsPer(INSTANCES / 10, [&]() {
+            for (int i = 0; i < INSTANCES / 10; i++) {
+                std::unique_ptr<Emulator::Chip8> chip8(new Emulator::Chip8());
+                chip8->LoadRom(rom);
+                sink += use(*chip8);
+            }
+        });
+
+        Emulator::Chip8Pool pool(64, rom);
+        double pooled = NanosecondsPer(INSTANCES, [&]() {
+            for (int i = 0; i < INSTANCES; i++) {
+                Emulator::Chip8 *chip8 = pool.Acquire();
+                sink += use(*chip8);
+                pool.Release(chip8);
+            }
+        });
+
+        printf("pool/new      %10.0f instances/s %6zu bytes/instance\n", 1e9 / heap, sizeof(Emulator::Chip8));
+        printf("pool/acquire  %10.0f instances/s %6zu bytes/instance (%u)\n", 1e9 / pooled,
+               Emulator::Chip8Pool::BytesPerInstance(), sink & 1);
+    }
+
+    //Programs that wait: a jump to itself, polling the delay timer and waiting for a key that is never pressed
+    const std::vector<Program> IDLE_PROGRAMS = {
+            {"jump", {0x1200}, {}},
+            {"timer", {0x60FF, 0xF015, 0xF107, 0x3100, 0x1204, 0x1200}, {}},
+            {"key", {0x6005, 0xE09E, 0x1202}, {}},
+    };
+
+    void BenchmarkIdle() {
+        const uint64_t IDLE_CYCLES = 100000000;
+
+        for (const Program &program : IDLE_PROGRAMS) {
+            Emulator::Chip8 stepped(1), fast(1);
+            LoadProgram(stepped, program);
+            LoadProgram(fast, program);
+
+            double step_ns = NanosecondsPer(1, [&]() {
+                for (uint64_t i = 0; i < IDLE_CYCLES; i++) stepped.EmulateCycle();
+            });
+            uint64_t skipped = 0;
+            double run_ns = NanosecondsPer(1, [&]() { skipped = fast.Run(IDLE_CYCLES); });
+
+            printf("idle/%-6s %llu cycles: EmulateCycle %8.1f ms, Run %8.3f us, %llu skipped\n", program.name,
+                   static_cast<unsigned long long>(IDLE_CYCLES), step_ns / 1e6, run_ns / 1e3,
+                   static_cast<unsigned long long>(skipped));
+        }
+    }
+
+    //A frame loop like the ones of real games: a row of sprites, counters and a score digit
+    const Program GAME_PROGRAM = {"game", {0x6A00, 0x6B00, 0xA000, 0xDAB5, 0x7A08, 0x3A40, 0x1204, 0x7B05, 0xF029,
+                                           0xD005, 0x7001, 0x1200}, {}};
+
+    void BenchmarkFusion() {
+        std::vector<Program> programs = PROGRAMS;
+        programs.push_back(GAME_PROGRAM);
+
+        for (const Program &program : programs) {
+            Emulator::Chip8 stepped(1), fused(1);
+            LoadProgram(stepped, program);
+            LoadProgram(fused, program);
+
+            //The two differ by a nanosecond or so, the best of a few alternating rounds keeps the noise out
+            double step_ns = 1e9, run_ns = 1e9;
+            for (int round = 0; round < 5; round++) {
+                step_ns = std::min(step_ns, NanosecondsPer(CYCLES / 5, [&]() {
+                    for (uint64_t i = 0; i < CYCLES / 5; i++) stepped.EmulateCycle();
+                }));
+                run_ns = std::min(run_ns, NanosecondsPer(CYCLES / 5, [&]() { fused.Run(CYCLES / 5); }));
+            }
+
+            printf("fusion/%-8s EmulateCycle %6.2f ns/instruction, Run %6.2f ns/instruction\n", program.name, step_ns,
+                   run_ns);
+        }
+    }
+
+    Emulator::Task YieldLoop(Emulator::Scheduler &scheduler, int switches) {
+        for (int i = 0; i < switches; i++) co_await scheduler.Yield();
+    }
+
+    void BenchmarkScheduler() {
+        const int TASKS = 1000;
+        const int SWITCHES = 10000;
+
+        Emulator::Scheduler scheduler;
+        for (int i = 0; i < TASKS; i++) scheduler.Spawn(YieldLoop(scheduler, SWITCHES));
+        //Yielding tasks stay ready, so this runs every task to its end
+        double switch_ns = NanosecondsPer(uint64_t(TASKS) * (SWITCHES + 1), [&]() { scheduler.RunReady(); });
+        printf("scheduler/switch  %8.2f ns per suspend and resume\n", switch_ns);
+
+        //Sessions that mostly wait for a key sleep on their event, the others run a tick of cycles each time
+        const int SESSIONS = 10000;
+        const int TICKS = 60;
+        const uint8_t waiting[] = {0xF0, 0x0A, 0x12, 0x00};
+        const uint8_t running[] = {0x70, 0x01, 0x12, 0x00};
+
+        for (const uint8_t *rom : {waiting, running}) {
+            Emulator::Scheduler sessions;
+            Emulator::Event keys(sessions);
+            std::vector<std::unique_ptr<Emulator::Chip8>> machines;
+            for (int i = 0; i < SESSIONS; i++) {
+                machines.emplace_back(new Emulator::Chip8(1));
+                machines.back()->LoadRom(std::span<const uint8_t>(rom, 4));
+                sessions.Spawn(Emulator::RunChip8Task(sessions, *machines.back(), keys, {}));
+            }
+            sessions.RunReady();
+            sessions.Tick();
+
+            double tick_ns = NanosecondsPer(TICKS, [&]() {
+                for (int i = 0; i < TICKS; i++) sessions.Tick();
+            });
+            printf("scheduler/%-7s %d sessions: %8.1f us per tick, %6.1f ns per session\n",
+                   rom == waiting ? "waiting" : "running", SESSIONS, tick_ns / 1e3, tick_ns / SESSIONS);
+        }
+    }
+
+    void BenchmarkEnv() {
+        const int ENVS = 256;
+        const int STEPS = 2000;
+        std::vector<uint8_t> rom;
+        for (unsigned short opcode : GAME_PROGRAM.opcodes) {
+            rom.push_back(opcode >> 8);
+            rom.push_back(opcode & 0xFF);
+        }
+
+        Emulator::VectorEnvOptions options;
+        options.rewards.push_back({0x300, 3, true, 1});
+        options.max_steps = 500;
+        std::vector<uint16_t> actions(ENVS);
+        std::vector<float> rewards(ENVS);
+        std::vector<uint8_t> dones(ENVS);
+
+        //One step at a time through the single machine interface, copying the frame out pixel by pixel
+        std::vector<std::unique_ptr<Emulator::Chip8>> machines;
+        for (int i = 0; i < ENVS; i++) {
+            machines.emplace_back(new Emulator::Chip8(i));
+            machines.back()->LoadRom(rom);
+        }
+        std::vector<uint8_t> frame(Emulator::Framebuffer::WIDTH * Emulator::Framebuffer::HEIGHT);
+        double stepped = NanosecondsPer(uint64_t(ENVS) * STEPS / 10, [&]() {
+            for (int step = 0; step < STEPS / 10; step++) {
+                for (int i = 0; i < ENVS; i++) {
+                    Emulator::Chip8 &chip8 = *machines[i];
+                    for (int key = 0; key < 16; key++) chip8.SetKeyPressed(key, (step + i) % 16 == key);
+                    for (int cycle = 0; cycle < options.frame_skip * options.cycles_per_frame; cycle++) {
+                        chip8.EmulateCycle();
+                    }
+                    for (int y = 0; y < Emulator::Framebuffer::HEIGHT; y++) {
+                        for (int x = 0; x < Emulator::Framebuffer::WIDTH; x++) {
+                            frame[y * Emulator::Framebuffer::WIDTH + x] = chip8.GetGfx().GetPixel(x, y);
+                        }
+                    }
+                }
+            }
+        });
+        printf("env/single    %10.0f steps/s %6.1f ns/step\n", 1e9 / stepped, stepped);
+
+        for (Emulator::ObservationFormat format : {Emulator::OBSERVATION_PACKED, Emulator::OBSERVATION_BYTES}) {
+            options.observation = format;
+            Emulator::VectorEnv env(ENVS, rom, options);
+            std::vector<uint8_t> observations(ENVS * env.ObservationSize());
+            env.Reset(observations);
+
+            double ns = NanosecondsPer(uint64_t(ENVS) * STEPS, [&]() {
+                for (int step = 0; step < STEPS; step++) {
+                    for (int i = 0; i < ENVS; i++) actions[i] = 1 << ((step + i) % 16);
+                    env.Step(actions, observations, rewards, dones);
+                }
+            });
+            printf("env/%-9s %10.0f steps/s %6.1f ns/step\n", format == Emulator::OBSERVATION_PACKED ? "packed" : "bytes",
+                   1e9 / ns, ns);
+        }
+    }
+
+    void BenchmarkHash() {
+        const int STEPS = 1000000;
+        Emulator::Chip8 chip8(1);
+        LoadProgram(chip8, GAME_PROGRAM);
+
+        //Hash after every instruction like a search that checks each state
+        uint64_t sink = 0;
+        double incremental = NanosecondsPer(STEPS, [&]() {
+            for (int i = 0; i < STEPS; i++) {
+                chip8.EmulateCycle();
+                sink += chip8.StateHash();
+            }
+        });
+        double full = NanosecondsPer(STEPS / 10, [&]() {
+            for (int i = 0; i < STEPS / 10; i++) {
+                chip8.EmulateCycle();
+                sink += Emulator::Chip8::HashState(chip8.GetState());
+            }
+        });
+        printf("hash/incremental %8.1f ns/state\n", incremental);
+        printf("hash/full        %8.1f ns/state\n", full);
+
+        Emulator::VisitedSet visited(STEPS);
+        double insert = NanosecondsPer(STEPS, [&]() {
+            for (int i = 0; i < STEPS; i++) sink += visited.Insert(i * 0x9E3779B97F4A7C15ULL);
+        });
+        printf("hash/visited     %8.1f ns/insert (%llu)\n", insert, static_cast<unsigned long long>(sink & 1));
+    }
+
+    //Run ahead and rollback restore a state and run a frame or a few from it, over and over
+    void BenchmarkRestore() {
+        const int FRAMES = 200000;
+        const int CYCLES_PER_FRAME = 17; //1000 cycles per second at 60 frames per second
+
+        //The game loops over 12 instructions, real games run through a lot more code in a few frames
+        Program straight = {"straight", {}, {}};
+        for (int i = 0; i < 80; i++) straight.opcodes.insert(straight.opcodes.end(), {0x7001, 0x8010, 0xA000});
+        straight.opcodes.push_back(0x1200);
+
+        for (const Program &program : {GAME_PROGRAM, straight}) {
+            for (int frames : {1, 8}) {
+                Emulator::Chip8 source(1), stepped(1), fused(1);
+                LoadProgram(source, program);
+                source.Run(1000);
+                const Emulator::Chip8State state = source.GetState();
+
+                double step_ns = NanosecondsPer(FRAMES, [&]() {
+                    for (int frame = 0; frame < FRAMES; frame++) {
+                        stepped.SetState(state);
+                        for (int i = 0; i < frames * CYCLES_PER_FRAME; i++) stepped.EmulateCycle();
+                    }
+                });
+                double run_ns = NanosecondsPer(FRAMES, [&]() {
+                    for (int frame = 0; frame < FRAMES; frame++) {
+                        fused.SetState(state);
+                        fused.Run(frames * CYCLES_PER_FRAME);
+                    }
+                });
+
+                printf("restore/%-8s %d frames SetState and EmulateCycle %6.2f us, SetState and Run %6.2f us\n",
+                       program.name, frames, step_ns / 1e3, run_ns / 1e3);
+            }
+        }
+    }
+
+    void BenchmarkRunAhead() {
+        const int FRAMES = 20000;
+
+        //Extra CPU time per presented frame, to weigh against the frames of latency it hides
+        for (int blend : {0, 2}) {
+            for (int frames : {0, 1, 2, 4, 8}) {
+                Emulator::Chip8 chip8(1);
+                LoadProgram(chip8, GAME_PROGRAM);
+                Emulator::FramePipeline pipeline(1000, 60, blend);
+                Emulator::RunAhead run_ahead(frames);
+
+                unsigned sink = 0;
+                double ns = NanosecondsPer(FRAMES, [&]() {
+                    for (int frame = 0; frame < FRAMES; frame++) {
+                        do chip8.EmulateCycle();
+                        while (!pipeline.Cycle(chip8.GetGfx()));
+                        sink += run_ahead.Frame(chip8, pipeline).pixels[0];
+                    }
+                });
+                printf("runahead/blend %d frames %d %8.2f us/frame (%u)\n", blend, frames, ns / 1e3, sink & 1);
+            }
+        }
+    }
+
+    void BenchmarkNetplay() {
+        const uint32_t FRAMES = 6000;
+        const Emulator::LinkConditions conditions[] = {{1, 0, 0.0, 1}, {3, 1, 0.05, 2}, {6, 2, 0.1, 3}};
+
+        //Both players change their keys every 10 frames, how often that rolls back depends on the link
+        for (const Emulator::LinkConditions &link_conditions : conditions) {
+            Emulator::LoopbackLink link(link_conditions);
+            Emulator::Chip8 chip8[2] = {Emulator::Chip8(1), Emulator::Chip8(1)};
+            LoadProgram(chip8[0], GAME_PROGRAM);
+            LoadProgram(chip8[1], GAME_PROGRAM);
+            Emulator::NetplaySession sessions[2] = {{chip8[0], link.GetEnd(0)}, {chip8[1], link.GetEnd(1)}};
+
+            while (sessions[0].GetFrame() < FRAMES || sessions[1].GetFrame() < FRAMES) {
+                for (int side = 0; side < 2; side++) {
+                    Emulator::Xoshiro128 rng(sessions[side].GetFrame() / 10 * 2 + side);
+                    if (sessions[side].GetFrame() < FRAMES) sessions[side].AdvanceFrame(uint16_t(rng.Next()));
+                }
+                link.Tick();
+            }
+
+            const Emulator::NetplayStats &stats = sessions[0].GetStats();
+            double frame_ns = double(stats.resimulate_nanoseconds) / std::max<uint64_t>(stats.resimulated_frames, 1);
+            printf("netplay/latency %d loss %2.0f%% %5.1f rollbacks per 100 frames, %4.1f frames deep (max %llu), "
+                   "%5.2f us/frame, 8 frames %6.1f us = %.2f%% of a frame, %llu stalls\n", link_conditions.latency,
+                   link_conditions.loss * 100, stats.rollbacks * 100.0 / stats.frames,
+                   double(stats.resimulated_frames) / std::max<uint64_t>(stats.rollbacks, 1),
+                   static_cast<unsigned long long>(stats.max_rollback), frame_ns / 1e3, 8 * frame_ns / 1e3,
+                   8 * frame_ns / 1e9 * 60 * 100, static_cast<unsigned long long>(stats.stalls));
+        }
+    }
+
+    void BenchmarkExport() {
+        const uint64_t FRAMES = 2000;
+        const std::pair<const char *, Emulator::ExportFormat> formats[] = {
+                {"y4m", Emulator::ExportFormat::Y4m}, {"gif", Emulator::ExportFormat::Gif},
+                {"apng", Emulator::ExportFormat::Apng}};
+
+        //Encoding is the slow stage, more workers help until the emulator or the writer can't keep up
+        for (const auto &format : formats) {
+            for (int workers : {1, 2, 4}) {
+                Emulator::Chip8 chip8(1);
+                LoadProgram(chip8, GAME_PROGRAM);
+                Emulator::ExportOptions options;
+                options.format = format.second;
+                options.workers = workers;
+                Emulator::ExportStats stats;
+                Emulator::ExportVideo(chip8, nullptr, FRAMES, "/dev/null", options, &stats);
+
+                auto rate = [&](uint64_t ns) { return stats.frames * 1e9 / std::max<uint64_t>(ns, 1); };
+                printf("export/%-4s %d workers %7.0f frames/s: emulate %9.0f, encode %6.0f per worker, "
+                       "write %9.0f, %5.1f KB/frame\n", format.first, workers, rate(stats.wall_nanoseconds),
+                       rate(stats.emulate_nanoseconds), rate(stats.encode_nanoseconds), rate(stats.write_nanoseconds),
+                       stats.bytes / 1024.0 / stats.frames);
+            }
+        }
+    }
+
+    void BenchmarkSharedDisplay() {
+        const uint64_t FRAMES = 1000000;
+        std::string name = "/chip8_benchmark_" + std::to_string(getpid());
+        Emulator::Chip8 chip8(1);
+        LoadProgram(chip8, GAME_PROGRAM);
+        chip8.Run(1000);
+
+        //Readers spinning on the segment only cost the writer the cache line transfers, it never waits for them
+        for (int readers : {0, 1, 3}) {
+            Emulator::SharedDisplayWriter writer;
+            if (!writer.Open(name)) return;
+            std::atomic<bool> stop(false);
+            std::vector<uint64_t> reads(readers), retries(readers);
+            std::vector<std::thread> threads;
+            for (int i = 0; i < readers; i++) {
+                threads.emplace_back([&, i]() {
+                    Emulator::SharedDisplayReader reader;
+                    reader.Open(name);
+                    Emulator::SharedDisplayFrame frame;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        if (reader.Read(&frame, 1)) reads[i]++;
+                        else retries[i]++;
+                    }
+                });
+            }
+
+            double publish_ns = NanosecondsPer(FRAMES, [&]() {
+                for (uint64_t cycle = 0; cycle < FRAMES; cycle++) writer.Publish(chip8, cycle);
+            });
+            stop = true;
+            for (std::thread &thread : threads) thread.join();
+
+            uint64_t total_reads = 0, total_retries = 0;
+            for (int i = 0; i < readers; i++) {
+                total_reads += reads[i];
+                total_retries += retries[i];
+            }
+            printf("shm/%d readers publish %6.1f ns/frame, %llu reads, %.2f%% retried\n", readers, publish_ns,
+                   static_cast<unsigned long long>(total_reads),
+                   total_retries * 100.0 / std::max<uint64_t>(total_reads + total_retries, 1));
+        }
+
+        //An uncontended read, what a monitor polling at the display rate pays
+        Emulator::SharedDisplayWriter writer;
+        Emulator::SharedDisplayReader reader;
+        if (!writer.Open(name) || !reader.Open(name)) return;
+        writer.Publish(chip8, 0);
+        Emulator::SharedDisplayFrame frame;
+        uint64_t sink = 0;
+        double read_ns = NanosecondsPer(FRAMES, [&]() {
+            for (uint64_t i = 0; i < FRAMES; i++) {
+                reader.Read(&frame);
+                sink += frame.program_counter;
+            }
+        });
+        printf("shm/read %6.1f ns (%llu)\n", read_ns, static_cast<unsigned long long>(sink & 1));
+    }
+
+    void BenchmarkExplore() {
+        const uint64_t FRAMES = 2000000;
+
+        //The game loop draws a new screen almost every frame, so this includes making checkpoints
+        std::vector<uint8_t> rom;
+        for (unsigned short opcode : GAME_PROGRAM.opcodes) {
+            rom.push_back(opcode >> 8);
+            rom.push_back(opcode & 0xFF);
+        }
+
+        int cores = std::max<int>(std::thread::hardware_concurrency(), 1);
+        for (int threads : {1, cores}) {
+            Emulator::ExplorerOptions options;
+            options.threads = threads;
+            options.frames = FRAMES;
+            options.seed = 1;
+            Emulator::Explorer explorer(rom, options);
+            explorer.Explore();
+
+            Emulator::ExplorerStats stats = explorer.GetStats();
+            double seconds = stats.nanoseconds / 1e9;
+            printf("explore/%d threads %6.1f M frames/min, %6.1f ns/frame, %llu checkpoints, %llu screens\n",
+                   threads, stats.frames / seconds * 60 / 1e6, stats.nanoseconds / double(stats.frames),
+                   static_cast<unsigned long long>(stats.checkpoints), static_cast<unsigned long long>(stats.screens));
+            if (cores == 1) break;
+        }
+    }
+
+    void BenchmarkReload() {
+        const int RELOADS = 10000;
+        const char *path = "benchmark_reload.ch8";
+
+        //A ROM of the largest size
+        std::vector<char> rom(4096 - 0x200, 0x12);
+        FILE *file = fopen(path, "wb");
+        fwrite(rom.data(), 1, rom.size(), file);
+        fclose(file);
+        Emulator::Chip8 chip8(1);
+
+        double file_ns = NanosecondsPer(RELOADS, [&]() {
+            for (int i = 0; i < RELOADS; i++) chip8.LoadRomFile(path);
+        });
+        double memory_ns = NanosecondsPer(RELOADS, [&]() {
+            for (int i = 0; i < RELOADS; i++) {
+                chip8.LoadRom(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(rom.data()), rom.size()));
+            }
+        });
+
+        printf("reload/file   %8.2f us\nreload/memory %8.2f us\n", file_ns / 1e3, memory_ns / 1e3);
+        remove(path);
+    }
+
+    void BenchmarkServer() {
+        const int SESSIONS = 2000;
+        const int SECONDS = 3;
+
+        //One worker, the clients are drained from this thread so only the worker CPU time is measured
+        Emulator::SessionServer server(1);
+        std::vector<int> clients;
+
+        std::string load = "L";
+        load.push_back(static_cast<char>(PROGRAMS[1].opcodes.size() * 2));
+        load.push_back(0);
+        for (unsigned short opcode : PROGRAMS[1].opcodes) {
+            load.push_back(static_cast<char>(opcode >> 8));
+            load.push_back(static_cast<char>(opcode & 0xFF));
+        }
+
+        for (int i = 0; i < SESSIONS; i++) {
+            int sockets[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) break;
+            server.AddClient(sockets[1]);
+            send(sockets[0], load.data(), load.size(), 0);
+            clients.push_back(sockets[0]);
+        }
+
+        uint64_t bytes = 0;
+        uint64_t cpu_start = server.GetWorkerCpuNanoseconds();
+        auto end = std::chrono::steady_clock::now() + std::chrono::seconds(SECONDS);
+        while (std::chrono::steady_clock::now() < end) {
+            char buffer[4096];
+            for (int client : clients) {
+                ssize_t received;
+                while ((received = recv(client, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) bytes += received;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        double cpu = (server.GetWorkerCpuNanoseconds() - cpu_start) / 1e9 / SECONDS;
+        uint64_t frames = 0;
+        for (const auto &session : server.GetStats()) frames += session.frames;
+
+        printf("server/%d sessions %5.1f%% of a core, %.0f sessions per core, %.0f frames/s, %.0f bytes/frame\n",
+               static_cast<int>(clients.size()), cpu * 100, clients.size() / cpu, frames / double(SECONDS),
+               bytes / double(frames));
+
+        for (int client : clients) close(client);
+    }
+
+    const std::vector<std::pair<const char *, void (*)()>> BENCHMARKS = {
+            {"interpreter", BenchmarkInterpreter},
+            {"trace", BenchmarkTrace},
+            {"scaler", BenchmarkScaler},
+            {"delta", BenchmarkFrameDelta},
+            {"pool", BenchmarkPool},
+            {"idle", BenchmarkIdle},
+            {"fusion", BenchmarkFusion},
+            {"scheduler", BenchmarkScheduler},
+            {"env", BenchmarkEnv},
+            {"hash", BenchmarkHash},
+            {"restore", BenchmarkRestore},
+            {"runahead", BenchmarkRunAhead},
+            {"netplay", BenchmarkNetplay},
+            {"export", BenchmarkExport},
+            {"shm", BenchmarkSharedDisplay},
+            {"explore", BenchmarkExplore},
+            {"reload", BenchmarkReload},
+            {"server", BenchmarkServer},
+    };
+}
+
+int main(int argc, char const *argv[]) {
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    for (const auto &benchmark : BENCHMARKS) {
+        if (strstr(benchmark.first, filter) != nullptr) benchmark.second();
+    }
+
+    return 0;
+}
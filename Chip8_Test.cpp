@@ -5,6 +5,7 @@
 #define CATCH_CONFIG_MAIN
 
 #include <catch2/catch.hpp>
+#include <cstring>
 #include "Chip8.h"
 
 TEST_CASE("Return from subroutine") {
@@ -373,7 +374,7 @@ TEST_CASE("Skip instruction if key is pressed") {
     parenttest.WriteToMemory(0x200, 0xE5);
     parenttest.WriteToMemory(0x201, 0x9E);
 
-    parenttest.key_pressed[parenttest.GetCpuRegister(5)] = true;
+    parenttest.SetKeyPressed(parenttest.GetCpuRegister(5), true);
     parenttest.EmulateCycle();
 
     REQUIRE(0x204 == parenttest.GetProgramCounter());
@@ -382,7 +383,7 @@ TEST_CASE("Skip instruction if key is pressed") {
     parenttest2.WriteToMemory(0x200, 0xE5);
     parenttest2.WriteToMemory(0x201, 0x9E);
 
-    parenttest2.key_pressed[parenttest.GetCpuRegister(5)] = false;
+    parenttest2.SetKeyPressed(parenttest.GetCpuRegister(5), false);
     parenttest2.EmulateCycle();
 
     REQUIRE(0x202 == parenttest2.GetProgramCounter());
@@ -393,7 +394,7 @@ TEST_CASE("Skip instruction if key is not pressed") {
     parenttest.WriteToMemory(0x200, 0xE5);
     parenttest.WriteToMemory(0x201, 0xA1);
 
-    parenttest.key_pressed[parenttest.GetCpuRegister(5)] = false;
+    parenttest.SetKeyPressed(parenttest.GetCpuRegister(5), false);
     parenttest.EmulateCycle();
 
     REQUIRE(0x204 == parenttest.GetProgramCounter());
@@ -402,7 +403,7 @@ TEST_CASE("Skip instruction if key is not pressed") {
     parenttest2.WriteToMemory(0x200, 0xE5);
     parenttest2.WriteToMemory(0x201, 0xA1);
 
-    parenttest2.key_pressed[parenttest.GetCpuRegister(5)] = true;
+    parenttest2.SetKeyPressed(parenttest.GetCpuRegister(5), true);
     parenttest2.EmulateCycle();
 
     REQUIRE(0x202 == parenttest2.GetProgramCounter());
@@ -427,13 +428,31 @@ TEST_CASE("Set PC to next instruction if any key is pressed, save that key in re
     parenttest.EmulateCycle();
 
     REQUIRE(parenttest.GetProgramCounter() == 0x200);
+    REQUIRE(parenttest.IsWaitingForKey());
 
-    parenttest.key_pressed[5] = true;
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetProgramCounter() == 0x200);
+
+    parenttest.SetKeyPressed(5, true);
 
     parenttest.EmulateCycle();
 
     REQUIRE(parenttest.GetProgramCounter() == 0x202);
     REQUIRE(parenttest.GetCpuRegister(3) == 5);
+    REQUIRE(!parenttest.IsWaitingForKey());
+}
+
+TEST_CASE("Key state is packed into one bit per key") {
+    Emulator::Chip8 parenttest;
+    parenttest.SetKeyPressed(0, true);
+    parenttest.SetKeyPressed(0xF, true);
+    parenttest.SetKeyPressed(3, true);
+    parenttest.SetKeyPressed(3, false);
+
+    REQUIRE(parenttest.GetKeyState() == 0x8001);
+    REQUIRE(parenttest.IsKeyPressed(0xF));
+    REQUIRE(!parenttest.IsKeyPressed(3));
 }
 
 TEST_CASE("Load register into delay timer") {
@@ -526,4 +545,504 @@ TEST_CASE("Store memory in CPU registers") {
     REQUIRE(parenttest.GetCpuRegister(0) == 234);
     REQUIRE(parenttest.GetCpuRegister(1) == 2);
     REQUIRE(parenttest.GetCpuRegister(2) == 35);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Random register is reproducible for the same seed") {
+    Emulator::Chip8 parenttest(1234);
+    Emulator::Chip8 parenttest2(1234);
+
+    for (int i = 0; i < 16; i++) {
+        parenttest.WriteToMemory(0x200 + 2 * i, 0xC0 + i);
+        parenttest.WriteToMemory(0x201 + 2 * i, 0xFF);
+        parenttest2.WriteToMemory(0x200 + 2 * i, 0xC0 + i);
+        parenttest2.WriteToMemory(0x201 + 2 * i, 0xFF);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        parenttest.EmulateCycle();
+        parenttest2.EmulateCycle();
+        REQUIRE(parenttest.GetCpuRegister(i) == parenttest2.GetCpuRegister(i));
+    }
+
+    REQUIRE(parenttest.GetRandomState() == parenttest2.GetRandomState());
+}
+
+TEST_CASE("Random register is masked with the constant and can reach 255") {
+    Emulator::Chip8 parenttest(42);
+    parenttest.WriteToMemory(0x200, 0xC1);
+    parenttest.WriteToMemory(0x201, 0x0F);
+
+    parenttest.EmulateCycle();
+
+    REQUIRE((parenttest.GetCpuRegister(1) & 0xF0) == 0);
+
+    //RND V1, 0xFF / JP 0x200 on the seeded generator, every byte value should come up about equally often
+    Emulator::Chip8 parenttest2(42);
+    const uint8_t rom[] = {0xC1, 0xFF, 0x12, 0x00};
+    parenttest2.LoadRom(rom);
+
+    const int DRAWS = 256 * 64;
+    int counts[256] = {};
+    int first_255 = -1;
+    for (int draw = 0; draw < DRAWS; draw++) {
+        parenttest2.EmulateCycle();
+        parenttest2.EmulateCycle();
+        unsigned char value = parenttest2.GetCpuRegister(1);
+        counts[value]++;
+        if (value == 255 && first_255 < 0) first_255 = draw;
+    }
+
+    //Missing 255 for 2048 draws happens with a chance of e^-8
+    REQUIRE(first_255 >= 0);
+    REQUIRE(first_255 < 2048);
+    for (int count : counts) {
+        REQUIRE(count > 32);
+        REQUIRE(count < 96);
+    }
+}
+
+TEST_CASE("Restoring the random state repeats the random sequence") {
+    Emulator::Chip8 parenttest(7);
+    parenttest.WriteToMemory(0x200, 0xC1);
+    parenttest.WriteToMemory(0x201, 0xFF);
+
+    auto saved_state = parenttest.GetRandomState();
+    parenttest.EmulateCycle();
+    unsigned char first = parenttest.GetCpuRegister(1);
+
+    parenttest.SetRandomState(saved_state);
+    parenttest.SetProgramCounter(0x200);
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetCpuRegister(1) == first);
+}
+
+TEST_CASE("Return with an empty stack is reported as a fault") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0x00);
+    parenttest.WriteToMemory(0x201, 0xEE);
+
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetStackPointer() == 0);
+    REQUIRE(parenttest.GetFaults() == Emulator::FAULT_STACK_UNDERFLOW);
+}
+
+TEST_CASE("Call with a full stack is reported as a fault") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0x22);
+    parenttest.WriteToMemory(0x201, 0x00);
+
+    for (int i = 0; i < 17; i++) parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetStackPointer() == 16);
+    REQUIRE(parenttest.GetFaults() == Emulator::FAULT_STACK_OVERFLOW);
+}
+
+TEST_CASE("Memory accesses past the end wrap around and are reported as a fault") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0xF2);
+    parenttest.WriteToMemory(0x201, 0x55);
+
+    parenttest.SetIndexRegister(0xFFF);
+    parenttest.SetCpuRegister(0, 1);
+    parenttest.SetCpuRegister(1, 2);
+    parenttest.SetCpuRegister(2, 3);
+
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetMemory(0xFFF) == 1);
+    REQUIRE(parenttest.GetMemory(0x000) == 2);
+    REQUIRE(parenttest.GetMemory(0x001) == 3);
+    REQUIRE(parenttest.GetFaults() == Emulator::FAULT_MEMORY_RANGE);
+
+    parenttest.ClearFaults();
+    REQUIRE(parenttest.GetFaults() == 0);
+}
+
+TEST_CASE("Opcodes that aren't instructions are reported as a fault") {
+    //8xy8, Ex00, F001 and Fx4x don't exist, 8xyE is SHL
+    const unsigned short invalid[] = {0x8128, 0xE100, 0xF001, 0xF140, 0xF11F};
+    for (unsigned short opcode : invalid) {
+        Emulator::Chip8 parenttest;
+        parenttest.WriteToMemory(0x200, opcode >> 8);
+        parenttest.WriteToMemory(0x201, opcode & 0xFF);
+
+        parenttest.EmulateCycle();
+
+        REQUIRE(parenttest.GetFaults() == Emulator::FAULT_INVALID_OPCODE);
+    }
+
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0x81);
+    parenttest.WriteToMemory(0x201, 0x2E);
+    parenttest.EmulateCycle();
+    REQUIRE(parenttest.GetFaults() == 0);
+}
+
+TEST_CASE("Halt on fault stops execution after the faulting instruction") {
+    Emulator::Chip8 parenttest;
+    parenttest.SetHaltOnFault(true);
+    parenttest.WriteToMemory(0x200, 0x1F);
+    parenttest.WriteToMemory(0x201, 0xFF);
+
+    parenttest.EmulateCycle();
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.IsHalted());
+    REQUIRE(parenttest.GetFaults() == Emulator::FAULT_PC_RANGE);
+    REQUIRE(parenttest.GetProgramCounter() == 0x1001); //Fetched 0x00F0 from 0xFFF and 0x000, a no-op
+}
+
+TEST_CASE("Sprites wrap around both edges of the display") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0xD0);
+    parenttest.WriteToMemory(0x201, 0x11);
+
+    parenttest.SetCpuRegister(0, 200); //200 & 63 = 8
+    parenttest.SetCpuRegister(1, 40); //40 & 31 = 8
+    parenttest.SetIndexRegister(0); //Top row of the font sprite for 0 is 0xF0
+
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetGfx().GetPixel(8, 8));
+    REQUIRE(parenttest.GetGfx().GetPixel(11, 8));
+    REQUIRE(!parenttest.GetGfx().GetPixel(12, 8));
+}
+
+TEST_CASE("Draw sprite across a byte boundary and detect collisions") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0xD0);
+    parenttest.WriteToMemory(0x201, 0x11);
+    parenttest.WriteToMemory(0x202, 0xD0);
+    parenttest.WriteToMemory(0x203, 0x11);
+    parenttest.WriteToMemory(0x300, 0b10000001);
+
+    parenttest.SetCpuRegister(0, 61);
+    parenttest.SetCpuRegister(1, 3);
+    parenttest.SetIndexRegister(0x300);
+
+    parenttest.EmulateCycle();
+
+    REQUIRE(parenttest.GetGfx().GetPixel(61, 3));
+    REQUIRE(parenttest.GetGfx().GetPixel(4, 3)); //61 + 7 wraps to 4
+    REQUIRE(!parenttest.GetGfx().GetPixel(62, 3));
+    REQUIRE(parenttest.GetCpuRegister(15) == 0);
+
+    parenttest.EmulateCycle();
+
+    REQUIRE(!parenttest.GetGfx().GetPixel(61, 3));
+    REQUIRE(!parenttest.GetGfx().GetPixel(4, 3));
+    REQUIRE(parenttest.GetCpuRegister(15) == 1);
+}
+
+namespace {
+    //Runs the same program with Run() and with single cycles and requires identical machines after every chunk
+    void RequireRunMatchesCycles(const std::vector<unsigned short> &program, unsigned char delay, uint16_t keys) {
+        Emulator::Chip8 fast(9), slow(9);
+        for (Emulator::Chip8 *chip8 : {&fast, &slow}) {
+            for (size_t i = 0; i < program.size(); i++) {
+                chip8->WriteToMemory(0x200 + 2 * i, program[i] >> 8);
+                chip8->WriteToMemory(0x201 + 2 * i, program[i] & 0xFF);
+            }
+            chip8->SetDelayTimer(delay);
+            chip8->SetKeyState(keys);
+        }
+
+        for (uint64_t chunk : {1, 2, 5, 7, 64, 1000}) {
+            fast.Run(chunk);
+            for (uint64_t i = 0; i < chunk; i++) slow.EmulateCycle();
+            REQUIRE(memcmp(&fast.GetState(), &slow.GetState(), sizeof(Emulator::Chip8State)) == 0);
+        }
+    }
+}
+
+TEST_CASE("Run fast forwards a jump to itself") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0x12);
+    parenttest.WriteToMemory(0x201, 0x00);
+    parenttest.SetDelayTimer(100);
+
+    //The loop is recognized before its first pass
+    REQUIRE(parenttest.Run(1000000000) == 1000000000);
+    REQUIRE(parenttest.GetProgramCounter() == 0x200);
+    REQUIRE(parenttest.GetDelayTimer() == 0);
+
+    RequireRunMatchesCycles({0x6005, 0x1202}, 40, 0);
+}
+
+TEST_CASE("Run fast forwards delay timer polling loops") {
+    //LD V3, DT / SE V3, 0 / JP back, then LD V4, 1 / JP to itself
+    RequireRunMatchesCycles({0xF307, 0x3300, 0x1200, 0x6401, 0x1208}, 200, 0);
+    RequireRunMatchesCycles({0xF307, 0x3300, 0x1200, 0x6401, 0x1208}, 1, 0);
+    RequireRunMatchesCycles({0xF307, 0x3300, 0x1200, 0x6401, 0x1208}, 0, 0);
+
+    //Waiting for a value the timer may step over
+    RequireRunMatchesCycles({0xF307, 0x3314, 0x1200, 0x6401, 0x1208}, 200, 0);
+    RequireRunMatchesCycles({0xF307, 0x3314, 0x1200, 0x6401, 0x1208}, 203, 0);
+
+    Emulator::Chip8 parenttest;
+    const unsigned short program[] = {0xF307, 0x3300, 0x1200, 0x6401, 0x1208};
+    for (int i = 0; i < 5; i++) {
+        parenttest.WriteToMemory(0x200 + 2 * i, program[i] >> 8);
+        parenttest.WriteToMemory(0x201 + 2 * i, program[i] & 0xFF);
+    }
+    parenttest.SetDelayTimer(255);
+    //The last pass that reads 0 and LD V4 run normally
+    REQUIRE(parenttest.Run(10000) == 10000 - 3 - 1);
+    REQUIRE(parenttest.GetCpuRegister(4) == 1);
+}
+
+TEST_CASE("Run fast forwards key polling loops and Fx0A") {
+    //SKP V0 / JP back waits for key 5, SKNP V0 / JP back for its release
+    RequireRunMatchesCycles({0x6005, 0xE09E, 0x1202, 0x6101, 0x1208}, 30, 0);
+    RequireRunMatchesCycles({0x6005, 0xE09E, 0x1202, 0x6101, 0x1208}, 30, 1 << 5);
+    RequireRunMatchesCycles({0x6005, 0xE0A1, 0x1202, 0x6101, 0x1208}, 30, 1 << 5);
+    RequireRunMatchesCycles({0x6005, 0xE0A1, 0x1202, 0x6101, 0x1208}, 30, 0);
+
+    //LD V2, K
+    RequireRunMatchesCycles({0xF20A, 0x1202}, 30, 0);
+    RequireRunMatchesCycles({0xF20A, 0x1202}, 30, 1 << 9);
+}
+
+TEST_CASE("Unknown FXXX opcodes don't crash") {
+    Emulator::Chip8 parenttest;
+    parenttest.WriteToMemory(0x200, 0xF0);
+    parenttest.WriteToMemory(0x201, 0x90);
+
+    parenttest.EmulateCycle();
+    REQUIRE(parenttest.GetProgramCounter() == 0x200);
+}
+
+TEST_CASE("Write memory copies whole ranges and wraps around") {
+    Emulator::Chip8 parenttest;
+    const uint8_t patch[] = {1, 2, 3, 4};
+
+    parenttest.WriteMemory(0x300, patch);
+    REQUIRE(parenttest.GetMemory(0x300) == 1);
+    REQUIRE(parenttest.GetMemory(0x303) == 4);
+
+    parenttest.WriteMemory(0xFFE, patch);
+    REQUIRE(parenttest.GetMemory(0xFFE) == 1);
+    REQUIRE(parenttest.GetMemory(0xFFF) == 2);
+    REQUIRE(parenttest.GetMemory(0x000) == 3);
+    REQUIRE(parenttest.GetMemory(0x001) == 4);
+}
+
+TEST_CASE("Loading a ROM resets the running machine") {
+    Emulator::Chip8 parenttest(4);
+    const uint8_t first[] = {0x60, 0x11, 0x12, 0x02};
+    const uint8_t second[] = {0x61, 0x22};
+
+    parenttest.LoadRom(first);
+    parenttest.SetKeyPressed(2, true);
+    parenttest.EmulateCycle();
+    parenttest.EmulateCycle();
+    REQUIRE(parenttest.GetCpuRegister(0) == 0x11);
+
+    parenttest.LoadRom(second);
+    REQUIRE(parenttest.GetProgramCounter() == 0x200);
+    REQUIRE(parenttest.GetCpuRegister(0) == 0);
+    REQUIRE(parenttest.GetMemory(0x202) == 0); //Nothing of the old program is left
+    REQUIRE(parenttest.GetMemory(0) == 0xF0); //Font
+    REQUIRE(parenttest.IsKeyPressed(2));
+
+    parenttest.EmulateCycle();
+    REQUIRE(parenttest.GetCpuRegister(1) == 0x22);
+
+    REQUIRE_FALSE(parenttest.LoadRomFile("does_not_exist.ch8"));
+}
+
+TEST_CASE("Superinstructions leave the same machine as single cycles") {
+    //LD I / DRW, twice so the second one collides, then JP back
+    RequireRunMatchesCycles({0xA000, 0xD015, 0xA000, 0xD015, 0x7001, 0x1200}, 50, 0);
+    //LD F / DRW
+    RequireRunMatchesCycles({0x6003, 0xF029, 0xD005, 0x7001, 0x1202}, 50, 0);
+    //LD and ADD chains, ADD / JP
+    RequireRunMatchesCycles({0x6005, 0x61FF, 0x7101, 0x7005, 0x6203, 0x1202}, 50, 0);
+    RequireRunMatchesCycles({0x6005, 0x7101, 0x1202}, 50, 0);
+    //A counting loop, ADD / SE / JP back and ADD / SNE / JP back
+    RequireRunMatchesCycles({0x7001, 0x3010, 0x1200, 0x7101, 0x4120, 0x1206, 0x1206}, 50, 0);
+    //Timer polls whose jump doesn't go back to the poll, so they aren't fast forwarded
+    RequireRunMatchesCycles({0xF307, 0x3300, 0x1208, 0x1200, 0x7401, 0x1200}, 90, 0);
+    RequireRunMatchesCycles({0xF307, 0x3305, 0x1208, 0x1200, 0x7401, 0x1200}, 90, 0);
+
+    //Random programs made of the fused instructions and ones that break the patterns up
+    const unsigned short templates[] = {0xA000, 0xD000, 0x6000, 0x7000, 0x3000, 0x4000, 0xF007, 0x8004, 0xF015,
+                                        0xF029, 0x1200};
+    Emulator::Xoshiro128 random;
+    random.Seed(3);
+    for (int program = 0; program < 200; program++) {
+        std::vector<unsigned short> opcodes;
+        for (int i = 0; i < 24; i++) {
+            unsigned short opcode = templates[random.NextByte() % 11];
+            unsigned short operands = random.NextByte() << 8 | random.NextByte();
+            if ((opcode & 0xF000) == 0xA000) operands &= 0x004F; //Font sprites
+            else if ((opcode & 0xF000) == 0xD000) operands &= 0x0FF7;
+            else if ((opcode & 0xF000) == 0xF000) operands &= 0x0F00;
+            else if ((opcode & 0xF000) == 0x8000) operands &= 0x0FF0;
+            else if ((opcode & 0xF000) == 0x1000) operands &= 0x002E; //Jumps stay in the program
+            else operands &= 0x0FFF;
+            opcodes.push_back(opcode | operands);
+        }
+        opcodes.push_back(0x1200 | (random.NextByte() & 0x1E));
+        RequireRunMatchesCycles(opcodes, random.NextByte(), 0);
+    }
+}
+
+TEST_CASE("Superinstructions see code that was changed after they were decoded") {
+    Emulator::Chip8 parenttest(1);
+    //LD V0, 1 / ADD V0, 1 / JP back is fused into one superinstruction and a jump
+    const uint8_t rom[] = {0x60, 0x01, 0x70, 0x01, 0x12, 0x00};
+    parenttest.LoadRom(rom);
+    parenttest.Run(3);
+    REQUIRE(parenttest.GetCpuRegister(0) == 2);
+
+    //ADD V0, 1 becomes LD I, 0x300 through the memory API
+    parenttest.WriteToMemory(0x202, 0xA3);
+    parenttest.WriteToMemory(0x203, 0x00);
+    parenttest.Run(3);
+    REQUIRE(parenttest.GetCpuRegister(0) == 1);
+    REQUIRE(parenttest.GetIndexRegister() == 0x300);
+
+    //And through the program itself: LD V0, 0xA5 / LD I, 0x202 / LD [I], V0 turns ADD V5, 1 of the fused
+    //LD V5, 0 / ADD V5, 1 into LD I, 0x501
+    const uint8_t self_modifying[] = {0x65, 0x00, 0x75, 0x01, 0x12, 0x06, 0x60, 0xA5, 0xA2, 0x02, 0xF0, 0x55,
+                                      0x12, 0x00};
+    parenttest.LoadRom(self_modifying);
+    parenttest.Run(3); //LD V5, 0 / ADD V5, 1 / JP 0x206
+    REQUIRE(parenttest.GetCpuRegister(5) == 1);
+    parenttest.Run(7); //LD V0 / LD I / LD [I] / JP 0x200 / LD V5, 0 / LD I, 0x501 / JP 0x206
+    REQUIRE(parenttest.GetCpuRegister(5) == 0);
+    REQUIRE(parenttest.GetIndexRegister() == 0x501);
+
+    //States replace all of memory, LD I / DRW must not be used for the saved program
+    Emulator::Chip8State state = parenttest.GetState();
+    const uint8_t draw[] = {0xA0, 0x00, 0xD0, 0x05, 0x12, 0x00};
+    parenttest.LoadRom(draw);
+    parenttest.Run(3);
+    parenttest.SetState(state);
+    parenttest.SetProgramCounter(0x200);
+    parenttest.Run(3);
+    REQUIRE(parenttest.GetCpuRegister(5) == 0);
+    REQUIRE(parenttest.GetIndexRegister() == 0x501);
+
+    //Restoring the same memory over and over keeps what was decoded and still runs like single cycles
+    Emulator::Chip8 stepped(1);
+    state = parenttest.GetState();
+    for (int i = 0; i < 3; i++) {
+        parenttest.SetState(state);
+        stepped.SetState(state);
+        parenttest.Run(20);
+        for (int cycle = 0; cycle < 20; cycle++) stepped.EmulateCycle();
+        REQUIRE(memcmp(&parenttest.GetState(), &stepped.GetState(), sizeof(Emulator::Chip8State)) == 0);
+    }
+}
+
+TEST_CASE("Superinstructions stop on faults like single cycles") {
+    Emulator::Chip8 fast(1), slow(1);
+    //LD I, 0xFFE / DRW V0, V0, 5 reads past the end of memory
+    const uint8_t rom[] = {0xAF, 0xFE, 0xD0, 0x05, 0x60, 0x01, 0x61, 0x01};
+    for (Emulator::Chip8 *chip8 : {&fast, &slow}) {
+        chip8->LoadRom(rom);
+        chip8->SetHaltOnFault(true);
+    }
+
+    fast.Run(10);
+    for (int i = 0; i < 10; i++) slow.EmulateCycle();
+    REQUIRE(fast.IsHalted());
+    REQUIRE(memcmp(&fast.GetState(), &slow.GetState(), sizeof(Emulator::Chip8State)) == 0);
+}
+
+TEST_CASE("Superinstructions halt on a fault from before halting was turned on like single cycles") {
+    Emulator::Chip8 fast(1), slow(1);
+    //LD I, 0xFFF / LD V1, [I] faults with halting off, then LD I, 0x20C / DRW V0, V0, 5 could run fused
+    const uint8_t rom[] = {0xAF, 0xFF, 0xF1, 0x65, 0xA2, 0x0C, 0xD0, 0x05, 0x12, 0x08, 0x00, 0x00,
+                           0xF0, 0x90, 0x90, 0x90, 0xF0};
+    for (Emulator::Chip8 *chip8 : {&fast, &slow}) {
+        chip8->LoadRom(rom);
+        chip8->EmulateCycle();
+        chip8->EmulateCycle();
+        REQUIRE(chip8->GetFaults() == Emulator::FAULT_MEMORY_RANGE);
+        chip8->SetHaltOnFault(true);
+    }
+
+    //Stepping halts after LD I, before the DRW
+    fast.Run(10);
+    for (int i = 0; i < 10; i++) slow.EmulateCycle();
+    REQUIRE(fast.IsHalted());
+    REQUIRE(fast.GetProgramCounter() == 0x206);
+    REQUIRE(memcmp(&fast.GetState(), &slow.GetState(), sizeof(Emulator::Chip8State)) == 0);
+}
+
+TEST_CASE("State hashes follow every write incrementally") {
+    Emulator::Chip8 parenttest(4);
+    const uint8_t rom[] = {0x60, 0x01, 0x12, 0x00};
+    parenttest.LoadRom(rom);
+    REQUIRE(parenttest.StateHash() == Emulator::Chip8::HashState(parenttest.GetState()));
+
+    //Equal machines hash equally, any difference changes the hash
+    Emulator::Chip8 other(4);
+    other.LoadRom(rom);
+    REQUIRE(other.StateHash() == parenttest.StateHash());
+
+    uint64_t hash = parenttest.StateHash();
+    parenttest.WriteToMemory(0x800, 1);
+    REQUIRE(parenttest.StateHash() != hash);
+    parenttest.WriteToMemory(0x800, 0);
+    REQUIRE(parenttest.StateHash() == hash);
+
+    parenttest.SetCpuRegister(3, 1);
+    REQUIRE(parenttest.StateHash() != hash);
+    parenttest.SetCpuRegister(3, 0);
+    parenttest.SetDelayTimer(1);
+    REQUIRE(parenttest.StateHash() != hash);
+    parenttest.SetDelayTimer(0);
+    REQUIRE(parenttest.StateHash() == hash);
+
+    //The same values at swapped addresses are a different state
+    const uint8_t ab[] = {0xAA, 0xBB};
+    const uint8_t ba[] = {0xBB, 0xAA};
+    parenttest.WriteMemory(0x900, ab);
+    other.WriteMemory(0x900, ba);
+    REQUIRE(parenttest.StateHash() != other.StateHash());
+    REQUIRE(parenttest.StateHash() == Emulator::Chip8::HashState(parenttest.GetState()));
+
+    //Restoring a state restores its hash
+    Emulator::Chip8State state = parenttest.GetState();
+    parenttest.LoadRom(rom);
+    REQUIRE(parenttest.StateHash() == hash);
+    parenttest.SetState(state);
+    REQUIRE(parenttest.StateHash() == Emulator::Chip8::HashState(state));
+}
+
+TEST_CASE("State hashes match a full rehash after random programs") {
+    //Everything that writes memory or the display: BCD, register stores, sprites, CLS and self modifying code
+    const unsigned short templates[] = {0xA000, 0xD000, 0x6000, 0x7000, 0xF033, 0xF055, 0xF065, 0x00E0, 0xC000,
+                                        0x8004, 0xF01E, 0x2200, 0x00EE, 0x1200};
+    Emulator::Xoshiro128 random;
+    random.Seed(5);
+    for (int program = 0; program < 200; program++) {
+        Emulator::Chip8 fast(program), slow(program);
+        std::vector<uint8_t> rom;
+        for (int i = 0; i < 32; i++) {
+            unsigned short opcode = templates[random.NextByte() % 14];
+            unsigned short operands = random.NextByte() << 8 | random.NextByte();
+            if ((opcode & 0xF000) == 0xF000 || opcode == 0x00E0 || opcode == 0x00EE) operands = 0x0F00 & operands;
+            else if ((opcode & 0xF000) == 0x1000 || (opcode & 0xF000) == 0x2000) operands &= 0x003E;
+            else operands &= 0x0FFF;
+            if (opcode == 0x00E0 || opcode == 0x00EE) operands = 0;
+            rom.push_back((opcode | operands) >> 8);
+            rom.push_back((opcode | operands) & 0xFF);
+        }
+        fast.LoadRom(rom);
+        slow.LoadRom(rom);
+
+        for (uint64_t chunk : {1, 3, 10, 100, 1000}) {
+            fast.Run(chunk);
+            for (uint64_t i = 0; i < chunk; i++) slow.EmulateCycle();
+            REQUIRE(fast.StateHash() == Emulator::Chip8::HashState(fast.GetState()));
+            REQUIRE(slow.StateHash() == fast.StateHash());
+        }
+    }
+}
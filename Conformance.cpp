@@ -0,0 +1,231 @@
+#include "Conformance.h"
+#include "Instruction.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace Emulator {
+
+    namespace {
+        struct BuiltinRom {
+            const char *name;
+            std::vector<std::pair<int, std::vector<unsigned short>>> code; //Opcodes by start address
+        };
+
+        const std::vector<BuiltinRom> BUILTIN_ROMS = {
+                //Arithmetic with carries and borrows, the results are left in V0-VE
+                {"alu", {{0x200, {0x60FF, 0x6102, 0x8014, 0x82F0, 0x6305, 0x6407, 0x8345, 0x85F0, 0x6605, 0x6707,
+                                  0x8677, 0x88F0, 0x6981, 0x8906, 0x8AF0, 0x6B81, 0x8B0E, 0x8CF0, 0x6DF0, 0x6E0F,
+                                  0x8DE1, 0x6EF0, 0x8DE2, 0x6E3C, 0x8DE3, 0x1232}}}},
+                //Sprites from the font drawn across the screen edges, XOR erased and collided
+                {"sprites", {{0x200, {0x6000, 0x613C, 0x621C, 0xF029, 0xD125, 0x7001, 0x7106, 0x7203, 0x300A,
+                                      0x1206, 0xF029, 0xD125, 0x8F30, 0x1218}}}},
+                //BCD and register store and load through I
+                {"memory", {{0x200, {0x6A7B, 0xA400, 0xFA33, 0xF265, 0x6511, 0x6622, 0xA410, 0xF655, 0xA410,
+                                     0xF71E, 0xF665, 0x1216}}}},
+                //Nested calls and returns, then a stack overflow
+                {"calls", {{0x200, {0x2300, 0x7001, 0x2300, 0x7001, 0x2310, 0x120A}},
+                                  {0x300, {0x2308, 0x00EE, 0x0000, 0x0000, 0x7101, 0x00EE}},
+                                  {0x310, {0x7201, 0x2310}}}},
+                //Seeded random numbers with masks
+                {"random", {{0x200, {0xC0FF, 0xC10F, 0xC2F0, 0xC3AA, 0x8014, 0x1200}}}},
+                //Delay timer countdown with a jump table through BNNN
+                {"timers", {{0x200, {0x6020, 0xF015, 0xF107, 0x3100, 0x1204, 0x6002, 0xB300, 0x1210}},
+                                   {0x300, {0x0000, 0x6AAA, 0x7B01, 0x1302}}}},
+                //Idle loops: polling the delay timer, waiting for a key that isn't pressed and a jump to itself
+                {"idle", {{0x200, {0x60C8, 0xF015, 0xF107, 0x3100, 0x1204, 0x6205, 0xE2A1, 0x120C, 0xF229,
+                                   0xD005, 0x1214}}}},
+        };
+
+        //FNV-1a, only used to keep the golden files short
+        uint64_t HashBytes(const uint8_t *data, size_t length) {
+            uint64_t hash = 0xCBF29CE484222325ULL;
+            for (size_t i = 0; i < length; i++) {
+                hash ^= data[i];
+                hash *= 0x100000001B3ULL;
+            }
+            return hash;
+        }
+
+        bool ReadFile(const std::string &path, std::string *contents) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) return false;
+            contents->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        std::string FirstDifference(const std::string &expected, const std::string &actual) {
+            std::istringstream expected_lines(expected), actual_lines(actual);
+            std::string expected_line, actual_line;
+            while (true) {
+                bool more_expected = static_cast<bool>(std::getline(expected_lines, expected_line));
+                bool more_actual = static_cast<bool>(std::getline(actual_lines, actual_line));
+                if (!more_expected && !more_actual) return "";
+                if (!more_expected) expected_line.clear();
+                if (!more_actual) actual_line.clear();
+                if (expected_line != actual_line) return "expected \"" + expected_line + "\" got \"" + actual_line + "\"";
+            }
+        }
+
+        ConformanceResult RunRom(const ConformanceRom &rom, uint64_t cycles, bool update) {
+            //Existing golden files say how long they ran, the cycle count only applies to new ones
+            std::string expected;
+            bool have_golden = !update && ReadFile(rom.golden_path, &expected);
+            unsigned long long golden_cycles;
+            if (have_golden && sscanf(expected.c_str(), "cycles %llu", &golden_cycles) == 1) cycles = golden_cycles;
+
+            Chip8 chip8(1);
+            chip8.LoadRom(rom.data);
+
+            auto start = std::chrono::steady_clock::now();
+            uint64_t skipped = chip8.Run(cycles);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            ConformanceResult result = {rom.name, ConformanceStatus::Pass, "", cycles,
+                                        cycles / std::max(seconds, 1e-9), skipped};
+            std::string snapshot = ConformanceSnapshot(chip8, cycles);
+
+            if (update) {
+                std::ofstream golden(rom.golden_path, std::ios::binary);
+                golden << snapshot;
+                result.status = golden.good() ? ConformanceStatus::Updated : ConformanceStatus::Fail;
+                if (!golden.good()) result.detail = "can't write " + rom.golden_path;
+            } else if (!have_golden) {
+                result.status = ConformanceStatus::Missing;
+                result.detail = "no golden file " + rom.golden_path;
+            } else if (expected != snapshot) {
+                result.status = ConformanceStatus::Fail;
+                result.detail = FirstDifference(expected, snapshot);
+            }
+            return result;
+        }
+    }
+
+    std::string ConformanceSnapshot(const Chip8 &chip8, uint64_t cycles) {
+        const Chip8State &state = chip8.GetState();
+        char line[128];
+        std::string snapshot;
+
+        snprintf(line, sizeof(line), "cycles %llu\n", static_cast<unsigned long long>(cycles));
+        snapshot += line;
+        snprintf(line, sizeof(line), "framebuffer %016llx\n",
+                 static_cast<unsigned long long>(HashBytes(state.gfx.pixels.data(), Framebuffer::SIZE)));
+        snapshot += line;
+        snprintf(line, sizeof(line), "memory %016llx\n",
+                 static_cast<unsigned long long>(HashBytes(state.memory.data(), state.memory.size())));
+        snapshot += line;
+        for (int i = 0; i < 16; i++) {
+            snprintf(line, sizeof(line), "v%X %02x\n", i, state.v[i]);
+            snapshot += line;
+        }
+        snprintf(line, sizeof(line), "i %03x\npc %03x\nsp %x\ndt %02x\nst %02x\nfaults %x\n", state.index_register,
+                 state.program_counter, state.stack_pointer, state.delay_timer, state.sound_timer, state.faults);
+        snapshot += line;
+
+        return snapshot;
+    }
+
+    std::vector<ConformanceRom> BuiltinConformanceRoms(const std::string &directory) {
+        std::vector<ConformanceRom> roms;
+        for (const BuiltinRom &builtin : BUILTIN_ROMS) {
+            ConformanceRom rom;
+            rom.name = std::string("builtin-") + builtin.name;
+            rom.golden_path = (std::filesystem::path(directory) / (rom.name + ".golden")).string();
+
+            for (const auto &block : builtin.code) {
+                size_t offset = block.first - 0x200;
+                if (rom.data.size() < offset + block.second.size() * 2) {
+                    rom.data.resize(offset + block.second.size() * 2);
+                }
+                for (unsigned short opcode : block.second) {
+                    rom.data[offset++] = opcode >> 8;
+                    rom.data[offset++] = opcode & 0xFF;
+                }
+            }
+            roms.push_back(rom);
+        }
+        return roms;
+    }
+
+    std::vector<ConformanceRom> LoadConformanceRoms(const std::string &directory) {
+        std::vector<ConformanceRom> roms;
+        std::error_code error;
+
+        for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+            if (entry.path().extension() != ".ch8") continue;
+
+            ConformanceRom rom;
+            rom.name = entry.path().stem().string();
+            rom.golden_path = std::filesystem::path(entry.path()).replace_extension(".golden").string();
+
+            std::string data;
+            if (!ReadFile(entry.path().string(), &data)) continue;
+            rom.data.assign(data.begin(), data.end());
+            roms.push_back(rom);
+        }
+
+        std::sort(roms.begin(), roms.end(), [](const ConformanceRom &a, const ConformanceRom &b) {
+            return a.name < b.name;
+        });
+        return roms;
+    }
+
+    std::vector<ConformanceResult> RunConformance(const std::vector<ConformanceRom> &roms, uint64_t cycles, int jobs,
+                                                  bool update) {
+        std::vector<ConformanceResult> results(roms.size());
+        std::atomic<size_t> next(0);
+
+        //Every thread takes the next ROM that nobody has started yet
+        auto work = [&]() {
+            for (size_t i = next++; i < roms.size(); i = next++) results[i] = RunRom(roms[i], cycles, update);
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < std::max(jobs, 1); i++) threads.emplace_back(work);
+        work();
+        for (auto &thread : threads) thread.join();
+
+        return results;
+    }
+
+    std::vector<OpcodePairCount> CountOpcodePairs(const std::vector<ConformanceRom> &roms, uint64_t cycles) {
+        //Counted per opcode pair first, so the shapes are only formatted once for every distinct pair
+        std::map<std::pair<std::string, std::string>, uint64_t> pairs;
+        std::map<uint32_t, uint64_t> counts;
+
+        for (const ConformanceRom &rom : roms) {
+            Chip8 chip8(1);
+            chip8.LoadRom(rom.data);
+
+            unsigned short previous_pc = 0xFFFF;
+            unsigned short previous_opcode = 0;
+            for (uint64_t cycle = 0; cycle < cycles && !chip8.IsHalted(); cycle++) {
+                unsigned short pc = chip8.GetProgramCounter();
+                unsigned short opcode = chip8.GetMemory(pc) << 8 | chip8.GetMemory(pc + 1);
+                if (pc == previous_pc + 2) counts[uint32_t(previous_opcode) << 16 | opcode]++;
+
+                chip8.EmulateCycle();
+                previous_pc = pc;
+                previous_opcode = opcode;
+            }
+        }
+
+        for (const auto &count : counts) {
+            pairs[{OpcodeShape(count.first >> 16), OpcodeShape(count.first & 0xFFFF)}] += count.second;
+        }
+
+        std::vector<OpcodePairCount> sorted;
+        for (const auto &pair : pairs) sorted.push_back({pair.first.first, pair.first.second, pair.second});
+        std::stable_sort(sorted.begin(), sorted.end(), [](const OpcodePairCount &a, const OpcodePairCount &b) {
+            return a.count > b.count;
+        });
+        return sorted;
+    }
+}
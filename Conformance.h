@@ -0,0 +1,57 @@
+#ifndef CHIP8_EMULATOR_C_CONFORMANCE_H
+#define CHIP8_EMULATOR_C_CONFORMANCE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    struct ConformanceRom {
+        std::string name;
+        std::vector<uint8_t> data; //Loaded at 0x200
+        std::string golden_path;
+    };
+
+    enum class ConformanceStatus {
+        Pass, Fail, Missing, Updated
+    };
+
+    struct ConformanceResult {
+        std::string name;
+        ConformanceStatus status;
+        std::string detail; //First line that differs from the golden file
+        uint64_t cycles;
+        double instructions_per_second;
+        uint64_t skipped_cycles; //Cycles of idle loops that were fast forwarded
+    };
+
+    struct OpcodePairCount {
+        std::string first; //Shapes as returned by OpcodeShape()
+        std::string second;
+        uint64_t count;
+    };
+
+    //Text snapshot of the end state that is stored in the golden files: cycle count, a hash of the framebuffer and
+    //all registers, one item per line so a mismatch points at what changed
+    std::string ConformanceSnapshot(const Chip8 &chip8, uint64_t cycles);
+
+    //Synthetic programs covering the instruction groups, their golden files are <directory>/builtin-<name>.golden
+    std::vector<ConformanceRom> BuiltinConformanceRoms(const std::string &directory);
+
+    //Every *.ch8 file in directory, the golden file of a.ch8 is a.golden
+    std::vector<ConformanceRom> LoadConformanceRoms(const std::string &directory);
+
+    //Runs every ROM on jobs threads with all machines seeded with 1 and compares the end state with its golden file.
+    //Existing golden files are run for the cycles they were recorded with, cycles applies to new ones.
+    //With update the golden files are written instead of compared.
+    std::vector<ConformanceResult> RunConformance(const std::vector<ConformanceRom> &roms, uint64_t cycles, int jobs,
+                                                  bool update);
+
+    //Steps every ROM for cycles cycles and counts how often an instruction is directly followed by the one after it
+    //in memory, grouped by shape and sorted by count. These pairs are the candidates for superinstructions.
+    std::vector<OpcodePairCount> CountOpcodePairs(const std::vector<ConformanceRom> &roms, uint64_t cycles);
+}
+
+#endif //CHIP8_EMULATOR_C_CONFORMANCE_H
@@ -0,0 +1,210 @@
+#include "Debugger.h"
+
+namespace Emulator {
+
+    Debugger::Debugger(Chip8 &chip8) : chip8(chip8), breakpoints(), read_watchpoints(), write_watchpoints(),
+                                       breakpoint_count(0), watchpoint_count(0), condition_count(0),
+                                       stop_reason(StopReason::None), stop_address(0) {}
+
+    bool Debugger::Test(const Bitmap &bitmap, unsigned short address) {
+        address &= 0x0FFF;
+        return (bitmap[address >> 6] >> (address & 63)) & 1;
+    }
+
+    int Debugger::Set(Bitmap &bitmap, unsigned short address, bool value) {
+        address &= 0x0FFF;
+        uint64_t bit = uint64_t(1) << (address & 63);
+        bool was_set = (bitmap[address >> 6] & bit) != 0;
+
+        if (value) bitmap[address >> 6] |= bit;
+        else bitmap[address >> 6] &= ~bit;
+
+        return int(value) - int(was_set); //Change of the number of set bits
+    }
+
+    void Debugger::AddBreakpoint(unsigned short address) {
+        breakpoint_count += Set(breakpoints, address, true);
+    }
+
+    void Debugger::RemoveBreakpoint(unsigned short address) {
+        breakpoint_count += Set(breakpoints, address, false);
+    }
+
+    bool Debugger::HasBreakpoint(unsigned short address) const {
+        return Test(breakpoints, address);
+    }
+
+    void Debugger::AddWatchpoint(unsigned short address, unsigned short length, WatchType type) {
+        for (int i = 0; i < length; i++) {
+            if (static_cast<int>(type) & static_cast<int>(WatchType::Read))
+                watchpoint_count += Set(read_watchpoints, address + i, true);
+            if (static_cast<int>(type) & static_cast<int>(WatchType::Write))
+                watchpoint_count += Set(write_watchpoints, address + i, true);
+        }
+    }
+
+    void Debugger::RemoveWatchpoint(unsigned short address, unsigned short length, WatchType type) {
+        for (int i = 0; i < length; i++) {
+            if (static_cast<int>(type) & static_cast<int>(WatchType::Read))
+                watchpoint_count += Set(read_watchpoints, address + i, false);
+            if (static_cast<int>(type) & static_cast<int>(WatchType::Write))
+                watchpoint_count += Set(write_watchpoints, address + i, false);
+        }
+    }
+
+    int Debugger::AddRegisterCondition(RegisterCondition condition) {
+        conditions.push_back(condition);
+        condition_enabled.push_back(true);
+        condition_was_true.push_back(false);
+        condition_count++;
+        return static_cast<int>(conditions.size()) - 1;
+    }
+
+    void Debugger::RemoveRegisterCondition(int id) {
+        //Only disable it so the ids of the other conditions stay valid
+        if (id >= 0 && id < static_cast<int>(conditions.size()) && condition_enabled[id]) {
+            condition_enabled[id] = false;
+            condition_count--;
+        }
+    }
+
+    void Debugger::ClearAll() {
+        breakpoints.fill(0);
+        read_watchpoints.fill(0);
+        write_watchpoints.fill(0);
+        breakpoint_count = 0;
+        watchpoint_count = 0;
+        conditions.clear();
+        condition_enabled.clear();
+        condition_was_true.clear();
+        condition_count = 0;
+    }
+
+    unsigned short Debugger::ReadRegister(int reg) {
+        if (reg < 16) return chip8.GetCpuRegister(reg);
+        if (reg == REGISTER_I) return chip8.GetIndexRegister();
+        if (reg == REGISTER_DT) return chip8.GetDelayTimer();
+        if (reg == REGISTER_ST) return chip8.GetSoundTimer();
+        return chip8.GetStackPointer();
+    }
+
+    bool Debugger::CheckWatchpoints() {
+        unsigned short pc = chip8.GetProgramCounter();
+        unsigned short opcode = chip8.GetMemory(pc & 0x0FFF) << 8 | chip8.GetMemory((pc + 1) & 0x0FFF);
+        MemoryAccess access = MemoryAccessOf(opcode, chip8.GetIndexRegister());
+
+        for (int i = 0; i < access.read_length; i++) {
+            if (Test(read_watchpoints, access.read_address + i)) {
+                stop_reason = StopReason::ReadWatchpoint;
+                stop_address = (access.read_address + i) & 0x0FFF;
+                return true;
+            }
+        }
+        for (int i = 0; i < access.write_length; i++) {
+            if (Test(write_watchpoints, access.write_address + i)) {
+                stop_reason = StopReason::WriteWatchpoint;
+                stop_address = (access.write_address + i) & 0x0FFF;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Debugger::CheckConditions() {
+        bool stop = false;
+
+        for (size_t i = 0; i < conditions.size(); i++) {
+            if (!condition_enabled[i]) continue;
+
+            unsigned short value = ReadRegister(conditions[i].reg);
+            bool is_true = false;
+
+            switch (conditions[i].comparison) {
+                case Comparison::Equal: is_true = value == conditions[i].value; break;
+                case Comparison::NotEqual: is_true = value != conditions[i].value; break;
+                case Comparison::Less: is_true = value < conditions[i].value; break;
+                case Comparison::Greater: is_true = value > conditions[i].value; break;
+            }
+
+            if (is_true && !condition_was_true[i]) stop = true;
+            condition_was_true[i] = is_true;
+        }
+
+        if (stop) stop_reason = StopReason::RegisterCondition;
+        return stop;
+    }
+
+    StopReason Debugger::Run(uint64_t max_cycles, bool stop_on_return, unsigned short return_address,
+                             unsigned char return_stack_pointer) {
+        stop_reason = StopReason::None;
+
+        //Nothing to check, so run the plain interpreter loop
+        if (breakpoint_count == 0 && watchpoint_count == 0 && condition_count == 0 && !stop_on_return) {
+            for (uint64_t i = 0; i < max_cycles; i++) chip8.EmulateCycle();
+            return stop_reason = StopReason::CycleLimit;
+        }
+
+        for (uint64_t i = 0; i < max_cycles; i++) {
+            if (ExecuteChecked()) return stop_reason;
+
+            unsigned short pc = chip8.GetProgramCounter();
+            if (stop_on_return && pc == return_address && chip8.GetStackPointer() == return_stack_pointer)
+                return stop_reason = StopReason::Step;
+            if (breakpoint_count > 0 && Test(breakpoints, pc)) return stop_reason = StopReason::Breakpoint;
+        }
+
+        return stop_reason = StopReason::CycleLimit;
+    }
+
+    bool Debugger::ExecuteChecked() {
+        //The access is decoded before the instruction changes I, but like in gdb the stop is reported after it
+        //ran, so resuming goes on with the next instruction instead of hitting the same watchpoint again
+        bool watched = watchpoint_count > 0 && CheckWatchpoints();
+        StopReason watch_reason = stop_reason;
+
+        chip8.EmulateCycle();
+
+        //Conditions are evaluated either way so they notice the change from false to true only once
+        bool condition = condition_count > 0 && CheckConditions();
+        if (watched) stop_reason = watch_reason;
+        return watched || condition;
+    }
+
+    StopReason Debugger::Step() {
+        stop_reason = StopReason::None;
+        if (ExecuteChecked()) return stop_reason;
+        return stop_reason = StopReason::Step;
+    }
+
+    StopReason Debugger::StepOver(uint64_t max_cycles) {
+        unsigned short pc = chip8.GetProgramCounter();
+        bool is_call = (chip8.GetMemory(pc & 0x0FFF) & 0xF0) == 0x20;
+
+        if (!is_call) return Step();
+        return Run(max_cycles, true, pc + 2, chip8.GetStackPointer());
+    }
+
+    StopReason Debugger::Continue(uint64_t max_cycles) {
+        return Run(max_cycles, false, 0, 0);
+    }
+
+    StopReason Debugger::GetStopReason() const {
+        return stop_reason;
+    }
+
+    unsigned short Debugger::GetStopAddress() const {
+        return stop_address;
+    }
+
+    std::vector<unsigned short> Debugger::GetCallStack() {
+        std::vector<unsigned short> call_stack;
+        for (int i = 0; i < chip8.GetStackPointer() && i < 16; i++) {
+            call_stack.push_back(chip8.GetStack(i));
+        }
+        return call_stack;
+    }
+
+    Chip8 &Debugger::GetChip8() {
+        return chip8;
+    }
+}
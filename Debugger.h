@@ -0,0 +1,100 @@
+#ifndef CHIP8_EMULATOR_C_DEBUGGER_H
+#define CHIP8_EMULATOR_C_DEBUGGER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Chip8.h"
+#include "Instruction.h"
+
+namespace Emulator {
+
+    enum class StopReason {
+        None, Step, Breakpoint, ReadWatchpoint, WriteWatchpoint, RegisterCondition, CycleLimit
+    };
+
+    enum class WatchType {
+        Read = 1, Write = 2, Access = 3
+    };
+
+    enum class Comparison {
+        Equal, NotEqual, Less, Greater
+    };
+
+    //Register numbers for conditions, 0 to 15 are V0 to VF
+    const int REGISTER_I = 16;
+    const int REGISTER_DT = 17;
+    const int REGISTER_ST = 18;
+    const int REGISTER_SP = 19;
+
+    struct RegisterCondition {
+        int reg;
+        Comparison comparison;
+        unsigned short value;
+    };
+
+    class Debugger {
+
+    private:
+        using Bitmap = std::array<uint64_t, 4096 / 64>; //One bit per address of the 4 KiB RAM
+
+        Chip8 &chip8;
+
+        Bitmap breakpoints;
+        Bitmap read_watchpoints;
+        Bitmap write_watchpoints;
+        int breakpoint_count;
+        int watchpoint_count;
+
+        std::vector<RegisterCondition> conditions;
+        std::vector<bool> condition_enabled;
+        std::vector<bool> condition_was_true;
+        int condition_count;
+
+        StopReason stop_reason;
+        unsigned short stop_address; //Address that triggered the last watchpoint
+
+        static bool Test(const Bitmap &bitmap, unsigned short address);
+        static int Set(Bitmap &bitmap, unsigned short address, bool value);
+
+        unsigned short ReadRegister(int reg);
+        bool CheckWatchpoints();
+        bool CheckConditions();
+        //Runs one instruction, true when a watchpoint or condition stopped it and stop_reason says which
+        bool ExecuteChecked();
+        StopReason Run(uint64_t max_cycles, bool stop_on_return, unsigned short return_address,
+                       unsigned char return_stack_pointer);
+
+    public:
+        explicit Debugger(Chip8 &chip8);
+
+        void AddBreakpoint(unsigned short address);
+        void RemoveBreakpoint(unsigned short address);
+        bool HasBreakpoint(unsigned short address) const;
+
+        void AddWatchpoint(unsigned short address, unsigned short length, WatchType type);
+        void RemoveWatchpoint(unsigned short address, unsigned short length, WatchType type);
+
+        //Conditions stop execution when they change from false to true, returns an id for RemoveRegisterCondition
+        int AddRegisterCondition(RegisterCondition condition);
+        void RemoveRegisterCondition(int id);
+
+        void ClearAll();
+
+        //Execute exactly one instruction, a watchpoint it hits is reported after the access
+        StopReason Step();
+        //Like Step, but runs a 2NNN call until the subroutine returns
+        StopReason StepOver(uint64_t max_cycles = UINT64_MAX);
+        StopReason Continue(uint64_t max_cycles = UINT64_MAX);
+
+        StopReason GetStopReason() const;
+        unsigned short GetStopAddress() const;
+
+        //Addresses of the active 2NNN calls, outermost first
+        std::vector<unsigned short> GetCallStack();
+
+        Chip8 &GetChip8();
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_DEBUGGER_H
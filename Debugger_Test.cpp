@@ -0,0 +1,174 @@
+#include <catch2/catch.hpp>
+#include "Debugger.h"
+#include "GdbStub.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    void WriteOpcode(Emulator::Chip8 &chip8, int address, unsigned short opcode) {
+        chip8.WriteToMemory(address, opcode >> 8);
+        chip8.WriteToMemory(address + 1, opcode & 0xFF);
+    }
+}
+
+TEST_CASE("Debugger stops at a breakpoint") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    WriteOpcode(chip8, 0x200, 0x6001);
+    WriteOpcode(chip8, 0x202, 0x6102);
+    WriteOpcode(chip8, 0x204, 0x1200);
+
+    debugger.AddBreakpoint(0x204);
+
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::Breakpoint);
+    REQUIRE(chip8.GetProgramCounter() == 0x204);
+    REQUIRE(chip8.GetCpuRegister(1) == 2);
+
+    debugger.RemoveBreakpoint(0x204);
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::CycleLimit);
+}
+
+TEST_CASE("Debugger stops after a watched memory write") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    WriteOpcode(chip8, 0x200, 0xA300);
+    WriteOpcode(chip8, 0x202, 0x6207);
+    WriteOpcode(chip8, 0x204, 0xF255);
+    WriteOpcode(chip8, 0x206, 0x1200);
+
+    debugger.AddWatchpoint(0x302, 1, Emulator::WatchType::Write);
+
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::WriteWatchpoint);
+    REQUIRE(chip8.GetProgramCounter() == 0x206);
+    REQUIRE(chip8.GetMemory(0x302) == 7);
+    REQUIRE(debugger.GetStopAddress() == 0x302);
+
+    //Resuming runs on instead of stopping at the same write again, the loop comes back to it
+    REQUIRE(debugger.Step() == Emulator::StopReason::Step);
+    REQUIRE(chip8.GetProgramCounter() == 0x200);
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::WriteWatchpoint);
+    REQUIRE(chip8.GetProgramCounter() == 0x206);
+}
+
+TEST_CASE("Debugger resumes past a watched memory read") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    WriteOpcode(chip8, 0x200, 0xA300);
+    WriteOpcode(chip8, 0x202, 0xF065);
+    WriteOpcode(chip8, 0x204, 0x6101);
+    WriteOpcode(chip8, 0x206, 0x1206);
+    chip8.WriteToMemory(0x300, 9);
+
+    debugger.AddWatchpoint(0x300, 1, Emulator::WatchType::Read);
+
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::ReadWatchpoint);
+    REQUIRE(chip8.GetProgramCounter() == 0x204);
+    REQUIRE(chip8.GetCpuRegister(0) == 9);
+    REQUIRE(debugger.GetStopAddress() == 0x300);
+
+    REQUIRE(debugger.Step() == Emulator::StopReason::Step);
+    REQUIRE(chip8.GetCpuRegister(1) == 1);
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::CycleLimit);
+}
+
+TEST_CASE("Debugger stops when a register condition becomes true") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    WriteOpcode(chip8, 0x200, 0x7301);
+    WriteOpcode(chip8, 0x202, 0x1200);
+
+    debugger.AddRegisterCondition({3, Emulator::Comparison::Equal, 5});
+
+    REQUIRE(debugger.Continue(100) == Emulator::StopReason::RegisterCondition);
+    REQUIRE(chip8.GetCpuRegister(3) == 5);
+}
+
+TEST_CASE("Debugger steps over a subroutine call and shows the call stack") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    WriteOpcode(chip8, 0x200, 0x2300);
+    WriteOpcode(chip8, 0x202, 0x1202);
+    WriteOpcode(chip8, 0x300, 0x2400);
+    WriteOpcode(chip8, 0x302, 0x00EE);
+    WriteOpcode(chip8, 0x400, 0x6507);
+    WriteOpcode(chip8, 0x402, 0x00EE);
+
+    REQUIRE(debugger.StepOver() == Emulator::StopReason::Step);
+    REQUIRE(chip8.GetProgramCounter() == 0x202);
+    REQUIRE(chip8.GetCpuRegister(5) == 7);
+
+    chip8.SetProgramCounter(0x200);
+    debugger.Step();
+    debugger.Step();
+    REQUIRE(debugger.GetCallStack() == std::vector<unsigned short>{0x200, 0x300});
+}
+
+TEST_CASE("GDB stub answers register, memory and breakpoint packets") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    Emulator::GdbStub stub(debugger);
+    WriteOpcode(chip8, 0x200, 0x6A42);
+    WriteOpcode(chip8, 0x202, 0x1202);
+
+    REQUIRE(stub.HandlePacket("m200,2") == "6a42");
+    REQUIRE(stub.HandlePacket("s") == "S05");
+    REQUIRE(stub.HandlePacket("pa") == "42");
+    REQUIRE(stub.HandlePacket("p11") == "0202");
+
+    REQUIRE(stub.HandlePacket("M300,2:abcd") == "OK");
+    REQUIRE(chip8.GetMemory(0x301) == 0xCD);
+
+    REQUIRE(stub.HandlePacket("Z0,202,2") == "OK");
+    REQUIRE(stub.HandlePacket("c") == "S05");
+    REQUIRE(stub.HandlePacket("g").size() == 46);
+}
+
+TEST_CASE("GDB stub nacks bad checksums and keeps packets sent while the target runs") {
+    Emulator::Chip8 chip8;
+    Emulator::Debugger debugger(chip8);
+    Emulator::GdbStub stub(debugger);
+    WriteOpcode(chip8, 0x200, 0x1200);
+
+    const std::string socket_path = "gdb_stub_test.sock";
+    unlink(socket_path.c_str());
+    std::thread server([&]() { stub.Serve(socket_path); });
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    for (int attempt = 0; attempt < 200; attempt++) {
+        if (connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    auto send_text = [&](const std::string &text) { send(client, text.data(), text.size(), 0); };
+    auto receive_text = [&](size_t length) {
+        std::string text(length, '\0');
+        return recv(client, text.data(), length, MSG_WAITALL) == static_cast<ssize_t>(length) ? text : "";
+    };
+
+    send_text("$m200,2#00");
+    REQUIRE(receive_text(1) == "-");
+    send_text("$m200,2#5d");
+    REQUIRE(receive_text(1) == "+");
+    REQUIRE(receive_text(8) == "$1200#c3");
+
+    //The ? packet arrives while c runs the jump to itself, the interrupt after it stops the run
+    send_text("$c#63");
+    REQUIRE(receive_text(1) == "+");
+    send_text("$?#3f\x03");
+    REQUIRE(receive_text(7) == "$S02#b5");
+    REQUIRE(receive_text(1) == "+");
+    REQUIRE(receive_text(7) == "$S05#b8");
+
+    send_text("$D#44");
+    REQUIRE(receive_text(1) == "+");
+    REQUIRE(receive_text(6) == "$OK#9a");
+    close(client);
+    server.join();
+}
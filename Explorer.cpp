@@ -0,0 +1,280 @@
+#include "Explorer.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <thread>
+
+namespace Emulator {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        //The framebuffer hash is a sum of products, its low bits alone pick VisitedSet slots poorly
+        uint64_t Mix(uint64_t hash) {
+            hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+            return hash ^ (hash >> 31);
+        }
+
+        void Mark(std::array<uint64_t, 64> &bits, int address) {
+            address &= 0x0FFF;
+            bits[address >> 6] |= 1ULL << (address & 63);
+        }
+
+        //Mostly single keys, which is what games wait for, some releases and now and then a random chord
+        uint16_t RandomKeys(Xoshiro128 &rng, uint16_t held) {
+            uint32_t choice = rng.Next() % 8;
+            if (choice < 2) return 0;
+            if (choice < 6) return 1u << (rng.Next() % 16);
+            if (choice == 6) return held ^ (1u << (rng.Next() % 16));
+            return static_cast<uint16_t>(rng.Next());
+        }
+
+        //Keys of every frame of a run. Either the keys that led to the checkpoint again with a few holds changed,
+        //or new holds of 1 to 16 frames each starting from the keys held at the checkpoint
+        void MakeInput(Xoshiro128 &rng, uint16_t keys, const std::vector<uint16_t> &base, uint64_t frames,
+                       std::vector<uint16_t> *input) {
+            input->resize(frames);
+            if (!base.empty() && rng.Next() % 2) {
+                for (uint64_t frame = 0; frame < frames; frame++) (*input)[frame] = base[frame % base.size()];
+                for (int change = 1 + rng.Next() % 4; change > 0; change--) {
+                    uint64_t start = rng.Next() % frames;
+                    uint64_t end = std::min<uint64_t>(start + 1 + rng.Next() % 16, frames);
+                    std::fill(input->begin() + start, input->begin() + end, RandomKeys(rng, (*input)[start]));
+                }
+                return;
+            }
+
+            uint64_t next_change = 0;
+            for (uint64_t frame = 0; frame < frames; frame++) {
+                if (frame == next_change) {
+                    keys = RandomKeys(rng, keys);
+                    next_change = frame + 1 + rng.Next() % 16;
+                }
+                (*input)[frame] = keys;
+            }
+        }
+    }
+
+    Explorer::Explorer(std::span<const uint8_t> rom, ExplorerOptions explorer_options)
+            : options(explorer_options), executed(), data(), screens(explorer_options.screen_capacity),
+              frames_left(0), rom_size(std::min<size_t>(rom.size(), 4096 - 0x200)) {
+        options.threads = std::max(options.threads, 1);
+        options.cycles_per_frame = std::max(options.cycles_per_frame, 1);
+        options.max_run_frames = std::max(options.max_run_frames, 1);
+
+        Chip8 chip8(options.seed);
+        chip8.LoadRom(rom);
+        checkpoints.push_back({chip8.GetState(), 0, -1, 0, {}});
+        screens.Insert(Mix(chip8.GetState().gfx_hash));
+    }
+
+    void Explorer::Explore() {
+        auto start = Clock::now();
+        Clock::time_point deadline = Clock::time_point::max();
+        if (options.seconds > 0) {
+            deadline = start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(options.seconds));
+        }
+        frames_left = options.frames;
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < options.threads; i++) threads.emplace_back([this, i, deadline]() { Work(i, deadline); });
+        Work(0, deadline);
+        for (auto &thread : threads) thread.join();
+
+        stats.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void Explorer::Work(int index, Clock::time_point deadline) {
+        //Another call to Explore() continues with other choices than the last one
+        Xoshiro128 rng;
+        {
+            std::lock_guard<std::mutex> lock(checkpoints_mutex);
+            rng.Seed(Mix(options.seed + (stats.runs << 8) + index));
+        }
+
+        Chip8 chip8(options.seed);
+        const Chip8State &state = chip8.GetState();
+        std::array<uint64_t, WORDS> local_executed{}, local_data{}; //Everything this thread saw
+        std::array<uint64_t, WORDS> known_executed{}, known_data{}; //Already in the shared bitmaps
+        std::vector<uint32_t> reported; //Findings this thread already handed in, they repeat a lot
+        std::vector<uint16_t> base, input;
+        uint64_t frames = 0, cycles = 0, runs = 0;
+
+        while (Clock::now() < deadline) {
+            uint64_t length = 1 + rng.Next() % options.max_run_frames;
+            uint64_t left = frames_left.load(std::memory_order_relaxed);
+            do {
+                length = std::min(length, left);
+            } while (left > 0 && !frames_left.compare_exchange_weak(left, left - length, std::memory_order_relaxed));
+            if (length == 0) break;
+
+            int64_t parent;
+            uint16_t keys;
+            uint64_t cycle;
+            {
+                std::lock_guard<std::mutex> lock(checkpoints_mutex);
+                parent = rng.Next() % checkpoints.size();
+                const Checkpoint &checkpoint = checkpoints[parent];
+                chip8.SetState(checkpoint.state);
+                keys = checkpoint.keys;
+                cycle = checkpoint.cycle;
+                base = checkpoint.input;
+            }
+            MakeInput(rng, keys, base, length, &input);
+            runs++;
+
+            size_t since_parent = 0; //First frame of input after the parent checkpoint
+            uint64_t screen = state.gfx_hash;
+            bool stuck = false;
+            uint64_t frame = 0;
+            for (; frame < length && !stuck; frame++) {
+                chip8.SetKeyState(input[frame]);
+                for (int i = 0; i < options.cycles_per_frame; i++) {
+                    uint16_t pc = state.program_counter & 0x0FFF;
+                    uint16_t opcode = state.memory[pc] << 8 | state.memory[(pc + 1) & 0x0FFF];
+                    Mark(local_executed, pc);
+                    if ((opcode & 0xF000) == 0xD000) {
+                        for (int row = 0; row < (opcode & 0x000F); row++) Mark(local_data, state.index_register + row);
+                    } else if ((opcode & 0xF0FF) == 0xF065) {
+                        for (int byte = 0; byte <= (opcode & 0x0F00) >> 8; byte++) {
+                            Mark(local_data, state.index_register + byte);
+                        }
+                    }
+
+                    chip8.EmulateCycle();
+
+                    uint8_t faults = state.faults;
+                    if (faults == 0) continue;
+                    chip8.ClearFaults();
+                    for (uint8_t fault = 1; fault != 0 && fault <= faults; fault <<= 1) {
+                        uint32_t key = uint32_t(fault) << 16 | pc;
+                        if (!(faults & fault) || std::find(reported.begin(), reported.end(), key) != reported.end()) {
+                            continue;
+                        }
+                        reported.push_back(key);
+                        AddFinding(fault, pc, opcode, parent,
+                                   std::span<const uint16_t>(input.data() + since_parent, frame + 1 - since_parent),
+                                   cycle + i);
+                    }
+                    //An invalid opcode does nothing, those that don't even move the PC run into themselves forever
+                    stuck = (faults & FAULT_INVALID_OPCODE) && state.program_counter == pc;
+                    if (stuck) break;
+                }
+                cycle += options.cycles_per_frame;
+
+                bool new_code = false;
+                for (size_t i = 0; i < WORDS; i++) {
+                    uint64_t fresh = local_executed[i] & ~known_executed[i];
+                    if (fresh) {
+                        uint64_t before = executed[i].fetch_or(fresh, std::memory_order_relaxed);
+                        known_executed[i] |= before | fresh;
+                        new_code |= (fresh & ~before) != 0;
+                    }
+                    fresh = local_data[i] & ~known_data[i];
+                    if (fresh) known_data[i] |= data[i].fetch_or(fresh, std::memory_order_relaxed) | fresh;
+                }
+
+                bool new_screen = false;
+                if (state.gfx_hash != screen) {
+                    screen = state.gfx_hash;
+                    new_screen = screens.Insert(Mix(screen)) == VISIT_NEW;
+                }
+
+                //Later checkpoints of this run branch off the new one
+                if ((new_code || new_screen) && !stuck) {
+                    int64_t added = AddCheckpoint(state, input[frame], parent, cycle,
+                                                  std::vector<uint16_t>(input.begin() + since_parent,
+                                                                        input.begin() + frame + 1), new_code);
+                    if (added >= 0) {
+                        parent = added;
+                        since_parent = frame + 1;
+                    }
+                }
+            }
+
+            frames += frame;
+            cycles += frame * options.cycles_per_frame;
+            //Frames a stuck run didn't play go back to the budget
+            if (frame < length) frames_left.fetch_add(length - frame, std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock(checkpoints_mutex);
+        stats.frames += frames;
+        stats.cycles += cycles;
+        stats.runs += runs;
+    }
+
+    int64_t Explorer::AddCheckpoint(const Chip8State &state, uint16_t keys, int64_t parent, uint64_t cycle,
+                                    std::vector<uint16_t> input, bool new_code) {
+        std::lock_guard<std::mutex> lock(checkpoints_mutex);
+        if (!new_code && checkpoints.size() >= options.max_checkpoints) return -1;
+        checkpoints.push_back({state, keys, parent, cycle, std::move(input)});
+        return static_cast<int64_t>(checkpoints.size()) - 1;
+    }
+
+    void Explorer::AddFinding(uint8_t fault, uint16_t address, uint16_t opcode, int64_t parent,
+                              std::span<const uint16_t> input, uint64_t cycle) {
+        std::lock_guard<std::mutex> lock(checkpoints_mutex);
+        uint32_t key = uint32_t(fault) << 16 | address;
+        if (findings.count(key)) return;
+
+        //The keys of every checkpoint from power on to the parent and then those of the run
+        std::vector<int64_t> chain;
+        for (int64_t checkpoint = parent; checkpoint >= 0; checkpoint = checkpoints[checkpoint].parent) {
+            chain.push_back(checkpoint);
+        }
+        ExplorerFinding finding = {fault, address, opcode, InputLog(options.seed), cycle};
+        uint64_t frame_cycle = 0;
+        for (auto checkpoint = chain.rbegin(); checkpoint != chain.rend(); ++checkpoint) {
+            for (uint16_t keys : checkpoints[*checkpoint].input) {
+                finding.input.Record(frame_cycle, keys);
+                frame_cycle += options.cycles_per_frame;
+            }
+        }
+        for (uint16_t keys : input) {
+            finding.input.Record(frame_cycle, keys);
+            frame_cycle += options.cycles_per_frame;
+        }
+        findings.emplace(key, std::move(finding));
+    }
+
+    std::vector<ExplorerFinding> Explorer::GetFindings() const {
+        std::lock_guard<std::mutex> lock(checkpoints_mutex);
+        std::vector<ExplorerFinding> result;
+        for (const auto &finding : findings) result.push_back(finding.second);
+        return result;
+    }
+
+    bool Explorer::IsExecuted(uint16_t address) const {
+        address &= 0x0FFF;
+        return (executed[address >> 6].load(std::memory_order_relaxed) >> (address & 63)) & 1;
+    }
+
+    bool Explorer::IsData(uint16_t address) const {
+        address &= 0x0FFF;
+        return (data[address >> 6].load(std::memory_order_relaxed) >> (address & 63)) & 1;
+    }
+
+    std::vector<std::pair<uint16_t, uint16_t>> Explorer::GetUnreached() const {
+        std::vector<std::pair<uint16_t, uint16_t>> ranges;
+        for (uint16_t address = 0x200; address < 0x200 + rom_size; address++) {
+            //The second byte of an instruction counts as reached with the first
+            if (IsExecuted(address) || IsExecuted(address - 1) || IsData(address)) continue;
+            if (!ranges.empty() && ranges.back().second == address - 1) ranges.back().second = address;
+            else ranges.emplace_back(address, address);
+        }
+        return ranges;
+    }
+
+    ExplorerStats Explorer::GetStats() const {
+        std::lock_guard<std::mutex> lock(checkpoints_mutex);
+        ExplorerStats result = stats;
+        result.checkpoints = checkpoints.size();
+        result.screens = screens.GetSize();
+        result.executed = 0;
+        for (const auto &word : executed) result.executed += std::popcount(word.load(std::memory_order_relaxed));
+        return result;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef CHIP8_EMULATOR_C_EXPLORER_H
+#define CHIP8_EMULATOR_C_EXPLORER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "Chip8.h"
+#include "InputLog.h"
+#include "VisitedSet.h"
+
+namespace Emulator {
+
+    struct ExplorerOptions {
+        int threads = 1;
+        int cycles_per_frame = 16; //The keys can change once per frame
+        int max_run_frames = 256; //A run plays between 1 and this many frames from a checkpoint
+        uint64_t frames = 1000000; //Budget of every Explore() call over all threads
+        double seconds = 0; //Stops earlier once this much time passed, 0 never does
+        uint64_t seed = 0; //Power on seed of every machine, the reproducers replay on it
+        size_t max_checkpoints = 4096; //Past this only new code makes checkpoints, not new screens
+        size_t screen_capacity = 1 << 20; //Distinct framebuffers that are told apart
+    };
+
+    //The first time a fault happened at an address
+    struct ExplorerFinding {
+        uint8_t fault; //One of the FAULT_ flags
+        uint16_t address; //Of the instruction that caused it
+        uint16_t opcode;
+        InputLog input; //Keys from power on up to the instruction, replays with options.seed
+        uint64_t cycle; //The instruction runs as this cycle of the replay, counted from 0
+    };
+
+    struct ExplorerStats {
+        uint64_t frames = 0;
+        uint64_t cycles = 0;
+        uint64_t runs = 0;
+        uint64_t checkpoints = 0;
+        uint64_t screens = 0; //Distinct framebuffers seen
+        uint64_t executed = 0; //Distinct instruction addresses
+        uint64_t nanoseconds = 0; //Wall time of all Explore() calls
+    };
+
+    //Looks for code a ROM only reaches with the right keys and for the faults along the way, instead of someone
+    //playing it by hand. Every thread restores a saved state, plays mutated key sequences on it and keeps the states
+    //after frames that ran an instruction nobody ran before or drew a screen nobody saw before as new checkpoints to
+    //branch from. Coverage is shared between the threads as bitmaps of atomics, the checkpoints behind a mutex that
+    //is only taken once per run.
+    class Explorer {
+
+    private:
+        static constexpr size_t WORDS = 4096 / 64;
+
+        struct Checkpoint {
+            Chip8State state;
+            uint16_t keys; //Held when the state was saved
+            int64_t parent; //-1 for power on
+            uint64_t cycle; //Since power on
+            std::vector<uint16_t> input; //Keys of every frame from the parent to here
+        };
+
+        ExplorerOptions options;
+        std::deque<Checkpoint> checkpoints; //Never shrinks, so indices stay valid
+        mutable std::mutex checkpoints_mutex;
+        std::map<uint32_t, ExplorerFinding> findings; //By fault << 16 | address, taken with checkpoints_mutex
+        std::array<std::atomic<uint64_t>, WORDS> executed; //Addresses instructions were fetched from
+        std::array<std::atomic<uint64_t>, WORDS> data; //Bytes read by DRW and Fx65
+        VisitedSet screens;
+        std::atomic<uint64_t> frames_left;
+        ExplorerStats stats;
+        size_t rom_size;
+
+        void Work(int index, std::chrono::steady_clock::time_point deadline);
+        //-1 when the corpus is full and the state ran no new code
+        int64_t AddCheckpoint(const Chip8State &state, uint16_t keys, int64_t parent, uint64_t cycle,
+                              std::vector<uint16_t> input, bool new_code);
+        void AddFinding(uint8_t fault, uint16_t address, uint16_t opcode, int64_t parent,
+                        std::span<const uint16_t> input, uint64_t cycle);
+
+    public:
+        Explorer(std::span<const uint8_t> rom, ExplorerOptions options = {});
+
+        //Spends options.frames frames or options.seconds, whichever ends first. Calling it again goes on from
+        //where the last call stopped
+        void Explore();
+
+        //Sorted by fault and address
+        std::vector<ExplorerFinding> GetFindings() const;
+        bool IsExecuted(uint16_t address) const;
+        bool IsData(uint16_t address) const;
+        //Ranges of ROM bytes, as [first, last], that no instruction was fetched from and no instruction read.
+        //Either code behind a condition the search never met or data only some instruction other than DRW and
+        //Fx65 reads
+        std::vector<std::pair<uint16_t, uint16_t>> GetUnreached() const;
+        ExplorerStats GetStats() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_EXPLORER_H
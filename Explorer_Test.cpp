@@ -0,0 +1,123 @@
+#include <catch2/catch.hpp>
+#include <vector>
+#include "Explorer.h"
+
+namespace {
+    //The faults are behind two keys: 5 has to be held at SKP, then 7 has to be the lowest key held at LD V0, K
+    const std::vector<uint8_t> ROM = {
+            0xA2, 0x1A, //200 LD I, 21A
+            0xD0, 0x15, //202 DRW V0, V1, 5
+            0x60, 0x05, //204 LD V0, 5
+            0xE0, 0x9E, //206 SKP V0
+            0x12, 0x06, //208 JP 206
+            0xF0, 0x0A, //20A LD V0, K
+            0x30, 0x07, //20C SE V0, 7
+            0x12, 0x0A, //20E JP 20A
+            0x81, 0x28, //210 Invalid
+            0xAF, 0xFF, //212 LD I, FFF
+            0xF1, 0x65, //214 LD V1, [I] reads FFF and 000
+            0x12, 0x16, //216 JP 216
+            0x00, 0xE0, //218 CLS, never runs
+            0xF0, 0x90, 0x90, 0x90, 0xF0, //21A Sprite
+    };
+
+    //Runs the keys of a finding on a new machine and checks the instruction at its cycle causes its fault
+    void RequireReproduces(const Emulator::ExplorerFinding &finding, uint64_t seed) {
+        Emulator::Chip8 chip8(seed);
+        chip8.LoadRom(ROM);
+        const std::vector<Emulator::InputLog::Change> &changes = finding.input.GetChanges();
+        size_t next = 0;
+        for (uint64_t cycle = 0; cycle <= finding.cycle; cycle++) {
+            while (next < changes.size() && changes[next].cycle == cycle) chip8.SetKeyState(changes[next++].keys);
+            if (cycle == finding.cycle) {
+                REQUIRE(chip8.GetProgramCounter() == finding.address);
+                REQUIRE_FALSE(chip8.GetFaults() & finding.fault);
+            }
+            chip8.EmulateCycle();
+        }
+        REQUIRE(chip8.GetFaults() & finding.fault);
+        REQUIRE(finding.input.GetSeed() == seed);
+    }
+}
+
+TEST_CASE("Explorer finds the faults behind the right keys and how to get there") {
+    Emulator::ExplorerOptions options;
+    options.seed = 3;
+    options.frames = 20000;
+    Emulator::Explorer explorer(ROM, options);
+    explorer.Explore();
+
+    std::vector<Emulator::ExplorerFinding> findings = explorer.GetFindings();
+    REQUIRE(findings.size() == 2);
+    REQUIRE(findings[0].fault == Emulator::FAULT_MEMORY_RANGE);
+    REQUIRE(findings[0].address == 0x214);
+    REQUIRE(findings[0].opcode == 0xF165);
+    REQUIRE(findings[1].fault == Emulator::FAULT_INVALID_OPCODE);
+    REQUIRE(findings[1].address == 0x210);
+    REQUIRE(findings[1].opcode == 0x8128);
+    for (const Emulator::ExplorerFinding &finding : findings) RequireReproduces(finding, options.seed);
+
+    //Only CLS is left, the sprite counts as read
+    REQUIRE(explorer.IsExecuted(0x216));
+    REQUIRE(explorer.IsData(0x21E));
+    REQUIRE_FALSE(explorer.IsData(0x21F));
+    std::vector<std::pair<uint16_t, uint16_t>> unreached = explorer.GetUnreached();
+    REQUIRE(unreached.size() == 1);
+    REQUIRE(unreached[0] == std::pair<uint16_t, uint16_t>(0x218, 0x219));
+
+    Emulator::ExplorerStats stats = explorer.GetStats();
+    REQUIRE(stats.frames == options.frames);
+    REQUIRE(stats.cycles == options.frames * options.cycles_per_frame);
+    REQUIRE(stats.executed == 12);
+    REQUIRE(stats.checkpoints > 1);
+    REQUIRE(stats.screens >= 2);
+
+    //Another call spends another budget and keeps what was found
+    explorer.Explore();
+    REQUIRE(explorer.GetStats().frames == 2 * options.frames);
+    REQUIRE(explorer.GetFindings().size() == 2);
+}
+
+TEST_CASE("Explorer threads share coverage and findings") {
+    Emulator::ExplorerOptions options;
+    options.seed = 5;
+    options.frames = 40000;
+    options.threads = 4;
+    Emulator::Explorer explorer(ROM, options);
+    explorer.Explore();
+
+    std::vector<Emulator::ExplorerFinding> findings = explorer.GetFindings();
+    REQUIRE(findings.size() == 2);
+    for (const Emulator::ExplorerFinding &finding : findings) RequireReproduces(finding, options.seed);
+    REQUIRE(explorer.GetStats().frames == options.frames);
+    REQUIRE(explorer.GetUnreached().size() == 1);
+}
+
+TEST_CASE("Explorer stops at the time limit") {
+    Emulator::ExplorerOptions options;
+    options.frames = UINT64_MAX;
+    options.seconds = 0.05;
+    Emulator::Explorer explorer(ROM, options);
+    explorer.Explore();
+
+    Emulator::ExplorerStats stats = explorer.GetStats();
+    REQUIRE(stats.frames > 0);
+    REQUIRE(stats.nanoseconds < 2000000000ULL);
+}
+
+TEST_CASE("Explorer ends runs stuck on an invalid opcode and still spends the whole budget") {
+    const std::vector<uint8_t> rom = {0xE1, 0x00}; //Doesn't move the PC
+    Emulator::ExplorerOptions options;
+    options.frames = 1000;
+    Emulator::Explorer explorer(rom, options);
+    explorer.Explore();
+
+    std::vector<Emulator::ExplorerFinding> findings = explorer.GetFindings();
+    REQUIRE(findings.size() == 1);
+    REQUIRE(findings[0].address == 0x200);
+    REQUIRE(findings[0].cycle == 0);
+    //Every run plays one frame, the rest of it goes back to the budget
+    Emulator::ExplorerStats stats = explorer.GetStats();
+    REQUIRE(stats.frames == options.frames);
+    REQUIRE(stats.runs == options.frames);
+}
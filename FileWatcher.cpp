@@ -0,0 +1,44 @@
+#include "FileWatcher.h"
+#include <filesystem>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace Emulator {
+
+    FileWatcher::FileWatcher(const std::string &path) : inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+        std::filesystem::path file(path);
+        name = file.filename().string();
+        std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+
+        if (inotify >= 0 && inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(inotify);
+            inotify = -1;
+        }
+    }
+
+    FileWatcher::~FileWatcher() {
+        if (inotify >= 0) close(inotify);
+    }
+
+    bool FileWatcher::IsWatching() const {
+        return inotify >= 0;
+    }
+
+    bool FileWatcher::Changed() {
+        if (inotify < 0) return false;
+
+        alignas(inotify_event) char buffer[4096];
+        bool changed = false;
+        ssize_t length;
+
+        while ((length = read(inotify, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+                if (event->len > 0 && name == event->name) changed = true;
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        return changed;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef CHIP8_EMULATOR_C_FILEWATCHER_H
+#define CHIP8_EMULATOR_C_FILEWATCHER_H
+
+#include <string>
+
+namespace Emulator {
+
+    //Reports changes to one file without blocking, meant to be polled once per frame. The directory is watched with
+    //inotify so files that editors and build tools replace by renaming are noticed too.
+    class FileWatcher {
+
+    private:
+        int inotify;
+        std::string name;
+
+    public:
+        explicit FileWatcher(const std::string &path);
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher &) = delete;
+        FileWatcher &operator=(const FileWatcher &) = delete;
+
+        bool IsWatching() const;
+        //True when the file was written or replaced since the last call
+        bool Changed();
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_FILEWATCHER_H
@@ -0,0 +1,27 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include "FileWatcher.h"
+
+TEST_CASE("File watcher notices writes and replacements of its file only") {
+    std::string path = "watch_test.ch8";
+    std::string other = "watch_test_other.ch8";
+    std::ofstream(path) << "a";
+
+    Emulator::FileWatcher watcher(path);
+    REQUIRE(watcher.IsWatching());
+    REQUIRE_FALSE(watcher.Changed());
+
+    std::ofstream(other) << "b";
+    REQUIRE_FALSE(watcher.Changed());
+
+    std::ofstream(path) << "c";
+    REQUIRE(watcher.Changed());
+    REQUIRE_FALSE(watcher.Changed());
+
+    //Build tools often write a new file and rename it over the old one
+    std::rename(other.c_str(), path.c_str());
+    REQUIRE(watcher.Changed());
+
+    std::remove(path.c_str());
+}
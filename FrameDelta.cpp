@@ -0,0 +1,102 @@
+#include "FrameDelta.h"
+#include <cstring>
+
+namespace Emulator {
+
+    namespace {
+        //A gap of a single unchanged byte is cheaper to send as part of the changed bytes than as a new run
+        const size_t MIN_GAP = 2;
+
+        //Longest varint of a size_t
+        const size_t MAX_VARINT = 10;
+
+        uint8_t *PutVarint(uint8_t *out, size_t value) {
+            while (value >= 0x80) {
+                *out++ = static_cast<uint8_t>(value | 0x80);
+                value >>= 7;
+            }
+            *out++ = static_cast<uint8_t>(value);
+            return out;
+        }
+
+        bool GetVarint(const uint8_t *data, size_t length, size_t *position, size_t *value) {
+            *value = 0;
+            for (int shift = 0; *position < length && shift < 64; shift += 7) {
+                uint8_t byte = data[(*position)++];
+                *value |= size_t(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) return true;
+            }
+            return false;
+        }
+
+        //Index of the first byte at or after position that differs, whole words are compared while they match
+        size_t NextChange(const uint8_t *previous, const uint8_t *current, size_t position, size_t size) {
+            while (position + 8 <= size) {
+                uint64_t a, b;
+                memcpy(&a, previous + position, 8);
+                memcpy(&b, current + position, 8);
+                if (a != b) break;
+                position += 8;
+            }
+            while (position < size && previous[position] == current[position]) position++;
+            return position;
+        }
+    }
+
+    void EncodeFrameDelta(const uint8_t *previous, const uint8_t *current, size_t size, std::vector<uint8_t> *out) {
+        size_t position = 0;
+        size_t start = NextChange(previous, current, 0, size);
+
+        while (start < size) {
+            //Extend the changed run until MIN_GAP unchanged bytes in a row or the end of the frame
+            size_t end = start + 1;
+            size_t next = NextChange(previous, current, end, size);
+            while (next < size && next - end < MIN_GAP) {
+                end = next + 1;
+                next = NextChange(previous, current, end, size);
+            }
+
+            size_t base = out->size();
+            out->resize(base + 2 * MAX_VARINT + end - start);
+            uint8_t *write = PutVarint(PutVarint(out->data() + base, start - position), end - start);
+            for (size_t i = start; i < end; i++) *write++ = previous[i] ^ current[i];
+            out->resize(write - out->data());
+
+            position = end;
+            start = next;
+        }
+    }
+
+    void EncodeFrameDelta(const Framebuffer &previous, const Framebuffer &current, std::vector<uint8_t> *out) {
+        EncodeFrameDelta(previous.pixels.data(), current.pixels.data(), Framebuffer::SIZE, out);
+    }
+
+    bool ApplyFrameDelta(const uint8_t *delta, size_t length, uint8_t *frame, size_t size) {
+        //Every run is checked before any byte is XORed, a rejected delta leaves the frame as it was
+        for (bool apply : {false, true}) {
+            size_t position = 0;
+            size_t offset = 0;
+
+            while (position < length) {
+                size_t skip, count;
+                if (!GetVarint(delta, length, &position, &skip) || !GetVarint(delta, length, &position, &count)) {
+                    return false;
+                }
+                if (skip > size - offset || count > size - offset - skip || count > length - position) return false;
+
+                offset += skip;
+                if (apply) {
+                    for (size_t i = 0; i < count; i++) frame[offset + i] ^= delta[position + i];
+                }
+                offset += count;
+                position += count;
+            }
+        }
+
+        return true;
+    }
+
+    bool ApplyFrameDelta(const uint8_t *delta, size_t length, Framebuffer *frame) {
+        return ApplyFrameDelta(delta, length, frame->pixels.data(), Framebuffer::SIZE);
+    }
+}
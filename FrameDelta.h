@@ -0,0 +1,26 @@
+#ifndef CHIP8_EMULATOR_C_FRAMEDELTA_H
+#define CHIP8_EMULATOR_C_FRAMEDELTA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Framebuffer.h"
+
+namespace Emulator {
+
+    //Compact difference between two packed frames of any size, for streaming and recording sessions.
+    //The frames are XORed and the result is stored as runs of <varint unchanged bytes> <varint changed bytes>
+    //<changed XOR bytes>, trailing unchanged bytes are left out, so an unchanged frame encodes to nothing.
+    //Applying a delta to the previous frame gives the current one, and since XOR is its own inverse applying it to
+    //the current frame gives back the previous one.
+
+    //Appends the delta from previous to current to out
+    void EncodeFrameDelta(const uint8_t *previous, const uint8_t *current, size_t size, std::vector<uint8_t> *out);
+    void EncodeFrameDelta(const Framebuffer &previous, const Framebuffer &current, std::vector<uint8_t> *out);
+
+    //XORs a delta into frame, false if it is malformed or doesn't fit the frame
+    bool ApplyFrameDelta(const uint8_t *delta, size_t length, uint8_t *frame, size_t size);
+    bool ApplyFrameDelta(const uint8_t *delta, size_t length, Framebuffer *frame);
+}
+
+#endif //CHIP8_EMULATOR_C_FRAMEDELTA_H
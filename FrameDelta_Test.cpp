@@ -0,0 +1,78 @@
+#include <catch2/catch.hpp>
+#include "FrameDelta.h"
+#include "Random.h"
+
+TEST_CASE("Unchanged frames encode to nothing") {
+    Emulator::Framebuffer frame;
+    frame.Clear();
+    frame.pixels[17] = 0x3C;
+
+    std::vector<uint8_t> delta;
+    Emulator::EncodeFrameDelta(frame, frame, &delta);
+    REQUIRE(delta.empty());
+}
+
+TEST_CASE("Frame delta stores runs of changed bytes") {
+    Emulator::Framebuffer previous, current;
+    previous.Clear();
+    current.Clear();
+    current.pixels[10] = 0x80;
+    current.pixels[12] = 0x01;
+    current.pixels[200] = 0xFF;
+
+    std::vector<uint8_t> delta;
+    Emulator::EncodeFrameDelta(previous, current, &delta);
+
+    //The single unchanged byte between 10 and 12 is kept in the run, 200 starts a new one after a two byte varint
+    const std::vector<uint8_t> expected = {10, 3, 0x80, 0x00, 0x01, 0xBB, 0x01, 1, 0xFF};
+    REQUIRE(delta == expected);
+
+    Emulator::Framebuffer decoded = previous;
+    REQUIRE(Emulator::ApplyFrameDelta(delta.data(), delta.size(), &decoded));
+    REQUIRE(decoded == current);
+
+    //XOR deltas work backwards too
+    REQUIRE(Emulator::ApplyFrameDelta(delta.data(), delta.size(), &decoded));
+    REQUIRE(decoded == previous);
+}
+
+TEST_CASE("Frame delta round trips random frames of other sizes") {
+    Emulator::Xoshiro128 rng(7);
+
+    //128x64 frames for the high resolution mode
+    const size_t SIZE = 128 * 64 / 8;
+    for (int round = 0; round < 100; round++) {
+        std::vector<uint8_t> previous(SIZE), current(SIZE);
+        for (size_t i = 0; i < SIZE; i++) {
+            previous[i] = rng.NextByte();
+            current[i] = rng.NextByte() < 16 ? rng.NextByte() : previous[i];
+        }
+
+        std::vector<uint8_t> delta;
+        Emulator::EncodeFrameDelta(previous.data(), current.data(), SIZE, &delta);
+        REQUIRE(Emulator::ApplyFrameDelta(delta.data(), delta.size(), previous.data(), SIZE));
+        REQUIRE(previous == current);
+    }
+}
+
+TEST_CASE("Malformed frame deltas are rejected") {
+    Emulator::Framebuffer frame;
+    frame.Clear();
+
+    const uint8_t past_end[] = {0x80, 0x02, 1, 0x80};
+    REQUIRE_FALSE(Emulator::ApplyFrameDelta(past_end, sizeof(past_end), &frame));
+
+    const uint8_t truncated[] = {0x00, 0x04, 0x80};
+    REQUIRE_FALSE(Emulator::ApplyFrameDelta(truncated, sizeof(truncated), &frame));
+
+    const uint8_t unterminated_varint[] = {0x80};
+    REQUIRE_FALSE(Emulator::ApplyFrameDelta(unterminated_varint, sizeof(unterminated_varint), &frame));
+
+    //The first run is fine, the second is truncated, nothing may be XORed
+    const uint8_t bad_second_run[] = {0x00, 0x01, 0xFF, 0x00, 0x04, 0x80};
+    REQUIRE_FALSE(Emulator::ApplyFrameDelta(bad_second_run, sizeof(bad_second_run), &frame));
+
+    Emulator::Framebuffer cleared;
+    cleared.Clear();
+    REQUIRE(frame.pixels == cleared.pixels);
+}
@@ -0,0 +1,53 @@
+#include "FramePipeline.h"
+#include <algorithm>
+
+namespace Emulator {
+
+    FramePipeline::FramePipeline(int cycles_per_second, int frames_per_second, int blend_frames) :
+            cycles_per_second(std::max(cycles_per_second, 1)), frames_per_second(std::max(frames_per_second, 1)),
+            phase(0), blend_frames(std::max(blend_frames, 0)), history(std::max(blend_frames - 1, 0)),
+            history_position(0) {
+        accumulated.Clear();
+        for (Framebuffer &old : history) old.Clear();
+        frame.Clear();
+    }
+
+    bool FramePipeline::Cycle(const Framebuffer &framebuffer) {
+        if (blend_frames > 0) accumulated |= framebuffer;
+
+        phase += frames_per_second;
+        if (phase < cycles_per_second) return false;
+        phase -= cycles_per_second;
+
+        if (blend_frames == 0) {
+            frame = framebuffer;
+            return true;
+        }
+
+        frame = accumulated;
+        for (const Framebuffer &old : history) frame |= old;
+
+        if (!history.empty()) {
+            history[history_position] = accumulated;
+            history_position = (history_position + 1) % history.size();
+        }
+        accumulated.Clear();
+
+        return true;
+    }
+
+    const Framebuffer &FramePipeline::GetFrame() const {
+        return frame;
+    }
+
+    uint64_t FramePipeline::CyclesUntilFrame(int frames) const {
+        //The k-th release after now is the first cycle c with phase + c * frames_per_second >= k * cycles_per_second
+        if (frames <= 0) return 0;
+        uint64_t target = static_cast<uint64_t>(frames) * cycles_per_second - phase;
+        return (target + frames_per_second - 1) / frames_per_second;
+    }
+
+    bool FramePipeline::IsBlending() const {
+        return blend_frames > 0;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef CHIP8_EMULATOR_C_FRAMEPIPELINE_H
+#define CHIP8_EMULATOR_C_FRAMEPIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Framebuffer.h"
+
+namespace Emulator {
+
+    //Stage between the emulator framebuffer and the video backend. It is fed after every cycle and only releases a
+    //frame on vblank boundaries, so the backend presents at the display rate instead of the instruction rate.
+    //With blending the released frame is the OR of every framebuffer seen during the last blend_frames frames, which
+    //keeps sprites that are erased and redrawn with XOR visible instead of flickering.
+    class FramePipeline {
+
+    private:
+        int cycles_per_second;
+        int frames_per_second;
+        int phase; //Counts frames_per_second per cycle, a vblank happens each time it passes cycles_per_second
+
+        int blend_frames; //0 passes the framebuffer at the vblank through unchanged
+        Framebuffer accumulated; //OR of the framebuffers since the last vblank
+        std::vector<Framebuffer> history; //Accumulated frames of the previous vblanks, used as a ring
+        size_t history_position;
+
+        Framebuffer frame;
+
+    public:
+        FramePipeline(int cycles_per_second, int frames_per_second, int blend_frames = 0);
+
+        //Call after every emulated cycle, returns true when GetFrame() holds a new frame to present
+        bool Cycle(const Framebuffer &framebuffer);
+
+        const Framebuffer &GetFrame() const;
+
+        //Number of Cycle() calls until the frames-th next frame is released
+        uint64_t CyclesUntilFrame(int frames) const;
+        bool IsBlending() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_FRAMEPIPELINE_H
@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+#include "FramePipeline.h"
+
+namespace {
+    Emulator::Framebuffer Blank() {
+        Emulator::Framebuffer framebuffer;
+        framebuffer.Clear();
+        return framebuffer;
+    }
+
+    Emulator::Framebuffer WithPixel(int byte) {
+        Emulator::Framebuffer framebuffer = Blank();
+        framebuffer.pixels[byte] = 0x80;
+        return framebuffer;
+    }
+}
+
+TEST_CASE("Frame pipeline releases frames at the display rate") {
+    Emulator::FramePipeline pipeline(1000, 60);
+    Emulator::Framebuffer framebuffer = Blank();
+
+    int frames = 0;
+    for (int cycle = 0; cycle < 1000; cycle++) {
+        if (pipeline.Cycle(framebuffer)) frames++;
+    }
+    REQUIRE(frames == 60);
+
+    //Without blending the frame is the framebuffer at the vblank
+    Emulator::FramePipeline every(1, 1);
+    REQUIRE(every.Cycle(WithPixel(3)));
+    REQUIRE(every.GetFrame() == WithPixel(3));
+    REQUIRE(every.Cycle(Blank()));
+    REQUIRE(every.GetFrame() == Blank());
+}
+
+TEST_CASE("Frame pipeline blends sprites erased between vblanks") {
+    //Two cycles per frame, the sprite is erased on the second cycle of every frame
+    Emulator::FramePipeline pipeline(2, 1, 1);
+    REQUIRE_FALSE(pipeline.Cycle(WithPixel(0)));
+    REQUIRE(pipeline.Cycle(Blank()));
+    REQUIRE(pipeline.GetFrame() == WithPixel(0));
+
+    //A single blended frame forgets what was drawn before the last vblank
+    REQUIRE_FALSE(pipeline.Cycle(Blank()));
+    REQUIRE(pipeline.Cycle(Blank()));
+    REQUIRE(pipeline.GetFrame() == Blank());
+}
+
+TEST_CASE("Frame pipeline ORs the last blended frames") {
+    Emulator::FramePipeline pipeline(1, 1, 3);
+    Emulator::Framebuffer both = WithPixel(0);
+    both |= WithPixel(1);
+
+    REQUIRE(pipeline.Cycle(WithPixel(0)));
+    REQUIRE(pipeline.Cycle(WithPixel(1)));
+    REQUIRE(pipeline.GetFrame() == both);
+    REQUIRE(pipeline.Cycle(Blank()));
+    REQUIRE(pipeline.GetFrame() == both);
+    REQUIRE(pipeline.Cycle(Blank()));
+    REQUIRE(pipeline.GetFrame() == WithPixel(1));
+    REQUIRE(pipeline.Cycle(Blank()));
+    REQUIRE(pipeline.GetFrame() == Blank());
+}
+
+TEST_CASE("Frame pipeline counts the cycles until a later frame") {
+    Emulator::FramePipeline pipeline(1000, 60);
+    Emulator::Framebuffer framebuffer = Blank();
+
+    for (int start = 0; start < 40; start++) {
+        for (int frames : {1, 2, 7}) {
+            uint64_t expected = 0;
+            Emulator::FramePipeline copy = pipeline;
+            for (int released = 0; released < frames; expected++) released += copy.Cycle(framebuffer);
+            REQUIRE(pipeline.CyclesUntilFrame(frames) == expected);
+        }
+        pipeline.Cycle(framebuffer);
+    }
+    REQUIRE(pipeline.CyclesUntilFrame(0) == 0);
+}
@@ -0,0 +1,71 @@
+#include "FrameSkip.h"
+#include <algorithm>
+
+namespace Emulator {
+
+    namespace {
+        //Further behind than this, e.g. after the process was stopped, the pacing starts over instead of catching up
+        const FrameSkip::Clock::duration MAX_LAG = std::chrono::milliseconds(250);
+    }
+
+    FrameSkip::FrameSkip(int cycles_per_second, int frames_per_second, int max_skip, Clock::time_point start) :
+            cycle_period(std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(1.0 / std::max(cycles_per_second, 1)))),
+            frame_period(std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(1.0 / std::max(frames_per_second, 1)))),
+            max_skip(std::max(max_skip, 0)), speed(1), deadline(start), next_present(start), frames(0),
+            skipped_in_row(0), dropped(0) {}
+
+    void FrameSkip::SetSpeed(int speed, Clock::time_point now) {
+        speed = std::max(speed, 0);
+        if (speed == FrameSkip::speed) return;
+
+        FrameSkip::speed = speed;
+        deadline = now;
+        next_present = now;
+        frames = 0;
+    }
+
+    int FrameSkip::GetSpeed() const {
+        return speed;
+    }
+
+    FrameSkip::Clock::duration FrameSkip::Cycle(Clock::time_point now) {
+        if (speed == UNCAPPED) {
+            deadline = now;
+            return Clock::duration::zero();
+        }
+
+        deadline += cycle_period / speed;
+        if (now - deadline > MAX_LAG) deadline = now;
+        return deadline > now ? deadline - now : Clock::duration::zero();
+    }
+
+    bool FrameSkip::ShouldPresent(Clock::time_point now) {
+        frames++;
+
+        bool present;
+        if (speed == UNCAPPED) {
+            present = now >= next_present;
+        } else {
+            present = frames % speed == 0;
+
+            //More than a frame behind, spend the time on the cycles instead
+            if (present && now - deadline > frame_period && skipped_in_row < max_skip) {
+                skipped_in_row++;
+                dropped++;
+                return false;
+            }
+        }
+
+        if (present) {
+            skipped_in_row = 0;
+            next_present = now + frame_period;
+        }
+        return present;
+    }
+
+    uint64_t FrameSkip::GetDropped() const {
+        return dropped;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef CHIP8_EMULATOR_C_FRAMESKIP_H
+#define CHIP8_EMULATOR_C_FRAMESKIP_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace Emulator {
+
+    //Paces an interactive loop and decides which released frames are presented. Only presents are ever dropped,
+    //never cycles: at speed n the loop runs n times faster than real time and presents every n-th frame, uncapped it
+    //runs as fast as it can and presents at the display rate. When the host can't keep up, frames are dropped until
+    //the cycles have caught up with the clock again, at most max_skip in a row so the picture keeps moving.
+    class FrameSkip {
+
+    public:
+        using Clock = std::chrono::steady_clock;
+        static const int UNCAPPED = 0;
+
+    private:
+        Clock::duration cycle_period;
+        Clock::duration frame_period;
+        int max_skip;
+        int speed;
+
+        Clock::time_point deadline; //When the next cycle is due
+        Clock::time_point next_present; //Earliest present when uncapped
+        uint64_t frames;
+        int skipped_in_row;
+        uint64_t dropped;
+
+    public:
+        FrameSkip(int cycles_per_second, int frames_per_second, int max_skip = 4, Clock::time_point start = Clock::now());
+
+        //1 is real time, UNCAPPED runs without sleeping. Changing it restarts the pacing from now
+        void SetSpeed(int speed, Clock::time_point now);
+        int GetSpeed() const;
+
+        //Call after every cycle, returns how long to sleep before the next one
+        Clock::duration Cycle(Clock::time_point now);
+        //Call for every frame the pipeline releases, returns whether to present it
+        bool ShouldPresent(Clock::time_point now);
+
+        //Frames dropped because the loop fell behind, frames left out by the speed aren't counted
+        uint64_t GetDropped() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_FRAMESKIP_H
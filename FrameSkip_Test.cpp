@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+#include "FrameSkip.h"
+
+namespace {
+    using Clock = Emulator::FrameSkip::Clock;
+
+    const Clock::time_point START = Clock::time_point() + std::chrono::hours(1);
+
+    std::chrono::microseconds Micros(Clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration);
+    }
+}
+
+TEST_CASE("Frame skip paces cycles to the clock") {
+    Emulator::FrameSkip frame_skip(1000, 60, 4, START);
+    Clock::time_point now = START;
+
+    //Cycles that take no time sleep the whole period, slow ones sleep what is left
+    REQUIRE(Micros(frame_skip.Cycle(now)) == std::chrono::microseconds(1000));
+    now += std::chrono::microseconds(1300);
+    REQUIRE(Micros(frame_skip.Cycle(now)) == std::chrono::microseconds(700));
+
+    //Running late sleeps nothing until the deadline passes now again
+    now = START + std::chrono::microseconds(5500);
+    for (int cycle = 0; cycle < 3; cycle++) REQUIRE(frame_skip.Cycle(now) == Clock::duration::zero());
+    REQUIRE(Micros(frame_skip.Cycle(now)) == std::chrono::microseconds(500));
+
+    //At speed 4 a cycle is due every quarter millisecond, counted from the change
+    frame_skip.SetSpeed(4, now);
+    REQUIRE(frame_skip.GetSpeed() == 4);
+    REQUIRE(Micros(frame_skip.Cycle(now)) == std::chrono::microseconds(250));
+    REQUIRE(Micros(frame_skip.Cycle(now)) == std::chrono::microseconds(500));
+
+    //Uncapped never sleeps
+    frame_skip.SetSpeed(Emulator::FrameSkip::UNCAPPED, now);
+    for (int i = 0; i < 100; i++) REQUIRE(frame_skip.Cycle(now) == Clock::duration::zero());
+}
+
+TEST_CASE("Frame skip starts over after a long stall") {
+    Emulator::FrameSkip frame_skip(1000, 60, 4, START);
+
+    //Stopped for a second, the loop doesn't race through the missed cycles
+    Clock::time_point now = START + std::chrono::seconds(1);
+    REQUIRE(frame_skip.Cycle(now) == Clock::duration::zero());
+    REQUIRE(Micros(frame_skip.Cycle(now)) == std::chrono::microseconds(1000));
+}
+
+TEST_CASE("Frame skip presents every n-th frame at speed n") {
+    Emulator::FrameSkip frame_skip(1000, 60, 4, START);
+
+    int presented = 0;
+    for (int frame = 0; frame < 60; frame++) {
+        if (frame_skip.ShouldPresent(START)) presented++;
+    }
+    REQUIRE(presented == 60);
+
+    frame_skip.SetSpeed(4, START);
+    presented = 0;
+    for (int frame = 0; frame < 60; frame++) {
+        bool present = frame_skip.ShouldPresent(START);
+        REQUIRE(present == (frame % 4 == 3));
+        if (present) presented++;
+    }
+    REQUIRE(presented == 15);
+
+    //Left out by the speed isn't dropped
+    REQUIRE(frame_skip.GetDropped() == 0);
+}
+
+TEST_CASE("Frame skip presents at the display rate when uncapped") {
+    Emulator::FrameSkip frame_skip(1000, 60, 4, START);
+    frame_skip.SetSpeed(Emulator::FrameSkip::UNCAPPED, START);
+
+    //A frame released every millisecond of wall time, about one in 17 is presented
+    int presented = 0;
+    for (int frame = 0; frame < 1000; frame++) {
+        if (frame_skip.ShouldPresent(START + std::chrono::milliseconds(frame))) presented++;
+    }
+    REQUIRE(presented >= 59);
+    REQUIRE(presented <= 61);
+    REQUIRE(frame_skip.GetDropped() == 0);
+}
+
+TEST_CASE("Frame skip drops presents while the loop is behind") {
+    Emulator::FrameSkip frame_skip(1000, 60, 3, START);
+
+    //Half a frame behind still presents
+    Clock::time_point now = START + std::chrono::milliseconds(8);
+    frame_skip.Cycle(now);
+    REQUIRE(frame_skip.ShouldPresent(now));
+
+    //Further behind than a frame drops, but at most max_skip in a row
+    now = START + std::chrono::milliseconds(100);
+    for (int frame = 0; frame < 3; frame++) REQUIRE_FALSE(frame_skip.ShouldPresent(now));
+    REQUIRE(frame_skip.ShouldPresent(now));
+    REQUIRE_FALSE(frame_skip.ShouldPresent(now));
+    REQUIRE(frame_skip.GetDropped() == 4);
+
+    //Caught up again, every frame is presented
+    for (int cycle = 0; cycle < 100; cycle++) frame_skip.Cycle(now);
+    for (int frame = 0; frame < 10; frame++) REQUIRE(frame_skip.ShouldPresent(now));
+    REQUIRE(frame_skip.GetDropped() == 4);
+}
@@ -0,0 +1,49 @@
+#ifndef CHIP8_EMULATOR_C_FRAMEBUFFER_H
+#define CHIP8_EMULATOR_C_FRAMEBUFFER_H
+
+#include <array>
+#include <cstdint>
+
+namespace Emulator {
+
+    //Monochrome display packed 8 pixels per byte, the leftmost pixel is the most significant bit like in sprites
+    struct Framebuffer {
+        static const int WIDTH = 64;
+        static const int HEIGHT = 32;
+        static const int BYTES_PER_ROW = WIDTH / 8;
+        static const int SIZE = HEIGHT * BYTES_PER_ROW;
+
+        std::array<uint8_t, SIZE> pixels;
+
+        bool GetPixel(int x, int y) const {
+            return (pixels[y * BYTES_PER_ROW + (x >> 3)] >> (7 - (x & 7))) & 1;
+        }
+
+        const uint8_t *Row(int y) const {
+            return &pixels[y * BYTES_PER_ROW];
+        }
+
+        uint8_t *Row(int y) {
+            return &pixels[y * BYTES_PER_ROW];
+        }
+
+        void Clear() {
+            pixels.fill(0);
+        }
+
+        Framebuffer &operator|=(const Framebuffer &other) {
+            for (int i = 0; i < SIZE; i++) pixels[i] |= other.pixels[i];
+            return *this;
+        }
+
+        bool operator==(const Framebuffer &other) const {
+            return pixels == other.pixels;
+        }
+
+        bool operator!=(const Framebuffer &other) const {
+            return pixels != other.pixels;
+        }
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_FRAMEBUFFER_H
@@ -0,0 +1,327 @@
+#include "GdbStub.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Emulator {
+
+    namespace {
+        const int GDB_REGISTER_COUNT = 21;
+        const uint64_t CYCLES_BETWEEN_INTERRUPT_CHECKS = 10000;
+    }
+
+    GdbStub::GdbStub(Debugger &debugger) : debugger(debugger), client(-1), detached(false) {}
+
+    std::string GdbStub::ToHex(const unsigned char *data, size_t length) {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (size_t i = 0; i < length; i++) {
+            hex += digits[data[i] >> 4];
+            hex += digits[data[i] & 0xF];
+        }
+        return hex;
+    }
+
+    int GdbStub::FromHexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    unsigned long GdbStub::ParseHex(const std::string &text, size_t *position) {
+        unsigned long value = 0;
+        while (*position < text.size() && FromHexDigit(text[*position]) >= 0) {
+            value = value << 4 | FromHexDigit(text[*position]);
+            (*position)++;
+        }
+        return value;
+    }
+
+    std::string GdbStub::ReadRegister(int reg) {
+        Chip8 &chip8 = debugger.GetChip8();
+        unsigned char bytes[2] = {0, 0};
+        size_t length = 1;
+
+        if (reg < 16) bytes[0] = chip8.GetCpuRegister(reg);
+        else if (reg == 16 || reg == 17) {
+            unsigned short value = reg == 16 ? chip8.GetIndexRegister() : chip8.GetProgramCounter();
+            bytes[0] = value & 0xFF;
+            bytes[1] = value >> 8;
+            length = 2;
+        } else if (reg == 18) bytes[0] = chip8.GetStackPointer();
+        else if (reg == 19) bytes[0] = chip8.GetDelayTimer();
+        else if (reg == 20) bytes[0] = chip8.GetSoundTimer();
+        else return "E01";
+
+        return ToHex(bytes, length);
+    }
+
+    std::string GdbStub::WriteRegister(int reg, const std::string &hex) {
+        Chip8 &chip8 = debugger.GetChip8();
+        if (hex.size() < 2) return "E01";
+
+        unsigned value = FromHexDigit(hex[0]) << 4 | FromHexDigit(hex[1]);
+        if (hex.size() >= 4) value |= (FromHexDigit(hex[2]) << 4 | FromHexDigit(hex[3])) << 8;
+
+        if (reg < 16) chip8.SetCpuRegister(reg, value & 0xFF);
+        else if (reg == 16) chip8.SetIndexRegister(value);
+        else if (reg == 17) chip8.SetProgramCounter(value);
+        else if (reg == 18) chip8.SetStackPointer(value & 0xFF);
+        else if (reg == 19) chip8.SetDelayTimer(value & 0xFF);
+        else if (reg == 20) chip8.SetSoundTimer(value & 0xFF);
+        else return "E01";
+
+        return "OK";
+    }
+
+    std::string GdbStub::ReadRegisters() {
+        std::string hex;
+        for (int reg = 0; reg < GDB_REGISTER_COUNT; reg++) hex += ReadRegister(reg);
+        return hex;
+    }
+
+    std::string GdbStub::WriteRegisters(const std::string &hex) {
+        size_t position = 0;
+        for (int reg = 0; reg < GDB_REGISTER_COUNT; reg++) {
+            size_t length = (reg == 16 || reg == 17) ? 4 : 2;
+            if (position + length > hex.size()) return "E01";
+            WriteRegister(reg, hex.substr(position, length));
+            position += length;
+        }
+        return "OK";
+    }
+
+    std::string GdbStub::ReadMemory(const std::string &arguments) {
+        size_t position = 0;
+        unsigned long address = ParseHex(arguments, &position);
+        position++; //Skip ,
+        unsigned long length = ParseHex(arguments, &position);
+
+        std::string hex;
+        for (unsigned long i = 0; i < length && address + i < 4096; i++) {
+            unsigned char byte = debugger.GetChip8().GetMemory(static_cast<int>(address + i));
+            hex += ToHex(&byte, 1);
+        }
+        return hex.empty() && length > 0 ? "E01" : hex;
+    }
+
+    std::string GdbStub::WriteMemory(const std::string &arguments) {
+        size_t position = 0;
+        unsigned long address = ParseHex(arguments, &position);
+        position++; //Skip ,
+        unsigned long length = ParseHex(arguments, &position);
+        position++; //Skip :
+
+        if (address + length > 4096 || position + length * 2 > arguments.size()) return "E01";
+
+        for (unsigned long i = 0; i < length; i++) {
+            int byte = FromHexDigit(arguments[position + 2 * i]) << 4 | FromHexDigit(arguments[position + 2 * i + 1]);
+            debugger.GetChip8().WriteToMemory(static_cast<int>(address + i), static_cast<unsigned char>(byte));
+        }
+        return "OK";
+    }
+
+    std::string GdbStub::SetBreakpoint(const std::string &arguments, bool insert) {
+        size_t position = 0;
+        unsigned long type = ParseHex(arguments, &position);
+        position++; //Skip ,
+        unsigned long address = ParseHex(arguments, &position);
+        position++; //Skip ,
+        unsigned long length = ParseHex(arguments, &position);
+
+        if (address >= 4096) return "E01";
+
+        if (type == 0 || type == 1) {
+            if (insert) debugger.AddBreakpoint(address);
+            else debugger.RemoveBreakpoint(address);
+            return "OK";
+        }
+
+        WatchType watch_type;
+        if (type == 2) watch_type = WatchType::Write;
+        else if (type == 3) watch_type = WatchType::Read;
+        else if (type == 4) watch_type = WatchType::Access;
+        else return "";
+
+        if (insert) debugger.AddWatchpoint(address, length, watch_type);
+        else debugger.RemoveWatchpoint(address, length, watch_type);
+        return "OK";
+    }
+
+    std::string GdbStub::StopReply(StopReason reason) {
+        char reply[32];
+
+        if (reason == StopReason::WriteWatchpoint) {
+            snprintf(reply, sizeof(reply), "T05watch:%x;", debugger.GetStopAddress());
+        } else if (reason == StopReason::ReadWatchpoint) {
+            snprintf(reply, sizeof(reply), "T05rwatch:%x;", debugger.GetStopAddress());
+        } else if (reason == StopReason::CycleLimit) {
+            snprintf(reply, sizeof(reply), "S02"); //SIGINT, the client interrupted us
+        } else {
+            snprintf(reply, sizeof(reply), "S05"); //SIGTRAP
+        }
+
+        return reply;
+    }
+
+    std::string GdbStub::Resume(bool single_step) {
+        if (single_step) return StopReply(debugger.Step());
+
+        StopReason reason;
+        do {
+            reason = debugger.Continue(CYCLES_BETWEEN_INTERRUPT_CHECKS);
+        } while (reason == StopReason::CycleLimit && !Interrupted());
+
+        return StopReply(reason);
+    }
+
+    std::string GdbStub::HandlePacket(const std::string &packet) {
+        if (packet.empty()) return "";
+
+        std::string arguments = packet.substr(1);
+        size_t position = 0;
+
+        switch (packet[0]) {
+            case '?':
+                return "S05";
+            case 'g':
+                return ReadRegisters();
+            case 'G':
+                return WriteRegisters(arguments);
+            case 'p':
+                return ReadRegister(static_cast<int>(ParseHex(arguments, &position)));
+            case 'P': {
+                int reg = static_cast<int>(ParseHex(arguments, &position));
+                return WriteRegister(reg, arguments.substr(position + 1));
+            }
+            case 'm':
+                return ReadMemory(arguments);
+            case 'M':
+                return WriteMemory(arguments);
+            case 'Z':
+                return SetBreakpoint(arguments, true);
+            case 'z':
+                return SetBreakpoint(arguments, false);
+            case 's':
+                return Resume(true);
+            case 'c':
+                return Resume(false);
+            case 'H':
+                return "OK";
+            case 'D':
+                detached = true;
+                return "OK";
+            case 'k':
+                detached = true;
+                return "";
+            case 'q':
+                if (packet.compare(0, 10, "qSupported") == 0) return "PacketSize=1000";
+                if (packet == "qAttached") return "1";
+                if (packet == "qC") return "QC1";
+                return "";
+            default:
+                return "";
+        }
+    }
+
+    bool GdbStub::Interrupted() {
+        if (client < 0) return false;
+
+        //A client may send the next packet before it sees the stop reply, keep it for ReceivePacket
+        char byte;
+        if (recv(client, &byte, 1, MSG_DONTWAIT) != 1) return false;
+        if (byte == 0x03) return true;
+        pending.push_back(byte);
+        return false;
+    }
+
+    bool GdbStub::ReceiveByte(char *c) {
+        if (!pending.empty()) {
+            *c = pending.front();
+            pending.erase(0, 1);
+            return true;
+        }
+        return recv(client, c, 1, 0) == 1;
+    }
+
+    bool GdbStub::SendPacket(const std::string &payload) {
+        unsigned char checksum = 0;
+        for (char c : payload) checksum += static_cast<unsigned char>(c);
+
+        char trailer[4];
+        snprintf(trailer, sizeof(trailer), "#%02x", checksum);
+
+        std::string packet = "$" + payload + trailer;
+        return send(client, packet.data(), packet.size(), 0) == static_cast<ssize_t>(packet.size());
+    }
+
+    bool GdbStub::ReceivePacket(std::string *payload) {
+        char c;
+
+        while (true) {
+            //Skip acks and interrupts until the start of a packet
+            do {
+                if (!ReceiveByte(&c)) return false;
+            } while (c != '$');
+
+            payload->clear();
+            unsigned char sum = 0;
+            while (ReceiveByte(&c) && c != '#') {
+                payload->push_back(c);
+                sum += static_cast<unsigned char>(c);
+            }
+
+            char checksum[2];
+            if (!ReceiveByte(&checksum[0]) || !ReceiveByte(&checksum[1])) return false;
+
+            //A damaged packet is nacked and the client sends it again
+            int high = FromHexDigit(checksum[0]), low = FromHexDigit(checksum[1]);
+            if (high >= 0 && low >= 0 && (high << 4 | low) == sum) return send(client, "+", 1, 0) == 1;
+            if (send(client, "-", 1, 0) != 1) return false;
+        }
+    }
+
+    bool GdbStub::Serve(const std::string &socket_path) {
+        int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server < 0) {
+            std::cerr << "Can't create gdb socket" << std::endl;
+            return false;
+        }
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socket_path.c_str());
+
+        if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(server, 1) < 0) {
+            std::cerr << "Can't listen on gdb socket " << socket_path << std::endl;
+            close(server);
+            return false;
+        }
+
+        client = accept(server, nullptr, nullptr);
+        close(server);
+        if (client < 0) return false;
+
+        std::string packet;
+        detached = false;
+        pending.clear();
+        while (!detached && ReceivePacket(&packet)) {
+            std::string reply = HandlePacket(packet);
+            if (packet != "k" && !SendPacket(reply)) break;
+        }
+
+        close(client);
+        client = -1;
+        unlink(socket_path.c_str());
+        return true;
+    }
+
+    bool GdbStub::IsDetached() const {
+        return detached;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef CHIP8_EMULATOR_C_GDBSTUB_H
+#define CHIP8_EMULATOR_C_GDBSTUB_H
+
+#include <string>
+#include "Debugger.h"
+
+namespace Emulator {
+
+    //GDB remote serial protocol stub for one client on a Unix domain socket.
+    //Register numbers for g/G/p/P: 0-15 V0-VF, 16 I, 17 PC (both 16 bit little endian), 18 SP, 19 DT, 20 ST.
+    //Breakpoints are Z0/Z1, watchpoints Z2 (write), Z3 (read) and Z4 (access).
+    class GdbStub {
+
+    private:
+        Debugger &debugger;
+        int client;
+        bool detached;
+        std::string pending; //Bytes Interrupted() read while the target ran that weren't an interrupt
+
+        static std::string ToHex(const unsigned char *data, size_t length);
+        static int FromHexDigit(char c);
+        static unsigned long ParseHex(const std::string &text, size_t *position);
+
+        std::string ReadRegisters();
+        std::string WriteRegisters(const std::string &hex);
+        std::string ReadRegister(int reg);
+        std::string WriteRegister(int reg, const std::string &hex);
+        std::string ReadMemory(const std::string &arguments);
+        std::string WriteMemory(const std::string &arguments);
+        std::string SetBreakpoint(const std::string &arguments, bool insert);
+        std::string Resume(bool single_step);
+        std::string StopReply(StopReason reason);
+
+        bool Interrupted();
+        bool ReceiveByte(char *c);
+        bool SendPacket(const std::string &payload);
+        bool ReceivePacket(std::string *payload);
+
+    public:
+        explicit GdbStub(Debugger &debugger);
+
+        //Handles one packet payload without the $ and checksum and returns the reply payload
+        std::string HandlePacket(const std::string &packet);
+
+        //Listens on socket_path and serves one client until it detaches or kills the session
+        bool Serve(const std::string &socket_path);
+
+        bool IsDetached() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_GDBSTUB_H
@@ -0,0 +1,57 @@
+#include "InputLog.h"
+#include <fstream>
+#include <sstream>
+
+namespace Emulator {
+
+    InputLog::InputLog(uint64_t seed) : seed(seed) {}
+
+    void InputLog::Record(uint64_t cycle, uint16_t keys) {
+        uint16_t last = changes.empty() ? 0 : changes.back().keys;
+        if (keys == last) return;
+        if (!changes.empty() && changes.back().cycle == cycle) changes.back().keys = keys;
+        else changes.push_back({cycle, keys});
+    }
+
+    bool InputLog::Save(const std::string &path) const {
+        std::ofstream file(path);
+        if (!file) return false;
+
+        file << "seed " << seed << "\n";
+        for (const Change &change : changes) file << std::dec << change.cycle << " " << std::hex << change.keys << "\n";
+        return static_cast<bool>(file);
+    }
+
+    bool InputLog::Load(const std::string &path) {
+        std::ifstream file(path);
+        std::string line, word;
+        if (!std::getline(file, line)) return false;
+
+        std::istringstream header(line);
+        uint64_t loaded_seed;
+        if (!(header >> word >> loaded_seed) || word != "seed") return false;
+
+        std::vector<Change> loaded;
+        while (std::getline(file, line)) {
+            if (line.empty()) continue;
+            std::istringstream fields(line);
+            uint64_t cycle;
+            unsigned keys;
+            if (!(fields >> std::dec >> cycle >> std::hex >> keys) || keys > 0xFFFF) return false;
+            if (!loaded.empty() && cycle < loaded.back().cycle) return false;
+            loaded.push_back({cycle, static_cast<uint16_t>(keys)});
+        }
+
+        seed = loaded_seed;
+        changes = std::move(loaded);
+        return true;
+    }
+
+    uint64_t InputLog::GetSeed() const {
+        return seed;
+    }
+
+    const std::vector<InputLog::Change> &InputLog::GetChanges() const {
+        return changes;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef CHIP8_EMULATOR_C_INPUTLOG_H
+#define CHIP8_EMULATOR_C_INPUTLOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Emulator {
+
+    //Key changes of a run. Replaying them on a machine with the same ROM and seed repeats the run exactly, which is
+    //how a session is turned into a video later. Stored as text, "seed <n>" on the first line and then a
+    //"<cycle> <keys>" line per change, the keys as a hex mask that holds from that cycle on.
+    class InputLog {
+
+    public:
+        struct Change {
+            uint64_t cycle; //Applied before this cycle runs
+            uint16_t keys;
+        };
+
+    private:
+        uint64_t seed;
+        std::vector<Change> changes;
+
+    public:
+        explicit InputLog(uint64_t seed = 0);
+
+        //Ignored when the keys are the same as after the last change, cycles have to grow
+        void Record(uint64_t cycle, uint16_t keys);
+
+        bool Save(const std::string &path) const;
+        //Replaces seed and changes, false when the file can't be read or a line isn't valid
+        bool Load(const std::string &path);
+
+        uint64_t GetSeed() const;
+        const std::vector<Change> &GetChanges() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_INPUTLOG_H
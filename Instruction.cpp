@@ -0,0 +1,138 @@
+#include "Instruction.h"
+#include <cstdio>
+
+namespace Emulator {
+
+    MemoryAccess MemoryAccessOf(unsigned short opcode, unsigned short index_register) {
+        MemoryAccess access = {0, 0, 0, 0};
+        int x = (opcode & 0x0F00) >> 8;
+
+        if ((opcode & 0xF000) == 0xD000) { //DRW Vx, Vy, nibble
+            access.read_address = index_register;
+            access.read_length = opcode & 0x000F;
+        } else if ((opcode & 0xF0FF) == 0xF033) { //LD B, Vx
+            access.write_address = index_register;
+            access.write_length = 3;
+        } else if ((opcode & 0xF0FF) == 0xF055) { //LD [I], Vx
+            access.write_address = index_register;
+            access.write_length = x + 1;
+        } else if ((opcode & 0xF0FF) == 0xF065) { //LD Vx, [I]
+            access.read_address = index_register;
+            access.read_length = x + 1;
+        }
+
+        return access;
+    }
+
+    uint16_t RegisterWritesOf(unsigned short opcode) {
+        uint16_t vx = 1u << ((opcode & 0x0F00) >> 8);
+
+        switch (opcode & 0xF000) {
+            case 0x6000:
+            case 0x7000:
+            case 0xC000:
+                return vx;
+            case 0x8000:
+                if ((opcode & 0x000F) <= 0x3) return vx;
+                return vx | 0x8000; //Arithmetic and shifts also set VF
+            case 0xD000:
+                return 0x8000;
+            case 0xF000:
+                if ((opcode & 0x00FF) == 0x07 || (opcode & 0x00FF) == 0x0A) return vx;
+                if ((opcode & 0x00FF) == 0x65) return static_cast<uint16_t>((vx << 1) - 1); //V0 to Vx
+                return 0;
+            default:
+                return 0;
+        }
+    }
+
+    std::string OpcodeShape(unsigned short opcode) {
+        char text[8];
+        int digit = opcode >> 12;
+
+        switch (opcode & 0xF000) {
+            case 0x0000:
+                if (opcode == 0x00E0 || opcode == 0x00EE) snprintf(text, sizeof(text), "%04X", opcode);
+                else snprintf(text, sizeof(text), "0NNN");
+                break;
+            case 0x1000:
+            case 0x2000:
+            case 0xA000:
+            case 0xB000:
+                snprintf(text, sizeof(text), "%XNNN", digit);
+                break;
+            case 0x5000:
+            case 0x8000:
+            case 0x9000:
+                snprintf(text, sizeof(text), "%XXY%X", digit, opcode & 0x000F);
+                break;
+            case 0xD000:
+                snprintf(text, sizeof(text), "DXYN");
+                break;
+            case 0xE000:
+            case 0xF000:
+                snprintf(text, sizeof(text), "%XX%02X", digit, opcode & 0x00FF);
+                break;
+            default:
+                snprintf(text, sizeof(text), "%XXNN", digit);
+        }
+
+        return text;
+    }
+
+    std::string Disassemble(unsigned short opcode) {
+        char text[32];
+        int x = (opcode & 0x0F00) >> 8;
+        int y = (opcode & 0x00F0) >> 4;
+        int n = opcode & 0x000F;
+        int kk = opcode & 0x00FF;
+        int nnn = opcode & 0x0FFF;
+
+        static const char *alu[16] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                      nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr};
+
+        switch (opcode & 0xF000) {
+            case 0x0000:
+                if (opcode == 0x00E0) return "CLS";
+                if (opcode == 0x00EE) return "RET";
+                snprintf(text, sizeof(text), "SYS 0x%03X", nnn);
+                break;
+            case 0x1000: snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+            case 0x2000: snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+            case 0x3000: snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk); break;
+            case 0x4000: snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk); break;
+            case 0x5000: snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+            case 0x6000: snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk); break;
+            case 0x7000: snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk); break;
+            case 0x8000:
+                if (alu[n] == nullptr) return "INVALID";
+                snprintf(text, sizeof(text), "%s V%X, V%X", alu[n], x, y);
+                break;
+            case 0x9000: snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+            case 0xA000: snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+            case 0xB000: snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+            case 0xC000: snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk); break;
+            case 0xD000: snprintf(text, sizeof(text), "DRW V%X, V%X, %d", x, y, n); break;
+            case 0xE000:
+                if (kk == 0x9E) snprintf(text, sizeof(text), "SKP V%X", x);
+                else if (kk == 0xA1) snprintf(text, sizeof(text), "SKNP V%X", x);
+                else return "INVALID";
+                break;
+            default:
+                switch (kk) {
+                    case 0x07: snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+                    case 0x0A: snprintf(text, sizeof(text), "LD V%X, K", x); break;
+                    case 0x15: snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+                    case 0x18: snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+                    case 0x1E: snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+                    case 0x29: snprintf(text, sizeof(text), "LD F, V%X", x); break;
+                    case 0x33: snprintf(text, sizeof(text), "LD B, V%X", x); break;
+                    case 0x55: snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+                    case 0x65: snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+                    default: return "INVALID";
+                }
+        }
+
+        return text;
+    }
+}
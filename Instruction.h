@@ -0,0 +1,29 @@
+#ifndef CHIP8_EMULATOR_C_INSTRUCTION_H
+#define CHIP8_EMULATOR_C_INSTRUCTION_H
+
+#include <cstdint>
+#include <string>
+
+namespace Emulator {
+
+    //Memory range an instruction reads or writes besides its own fetch
+    struct MemoryAccess {
+        unsigned short read_address;
+        unsigned short read_length;
+        unsigned short write_address;
+        unsigned short write_length;
+    };
+
+    MemoryAccess MemoryAccessOf(unsigned short opcode, unsigned short index_register);
+
+    //Bit n is set if the instruction may write register Vn
+    uint16_t RegisterWritesOf(unsigned short opcode);
+
+    //Opcode with its operands replaced by X, Y, N, NN or NNN, e.g. "6XNN" or "FX07", to group instructions in statistics
+    std::string OpcodeShape(unsigned short opcode);
+
+    //Assembly text in the notation used by the comments of Chip8.cpp, e.g. "LD V1, 0x05"
+    std::string Disassemble(unsigned short opcode);
+}
+
+#endif //CHIP8_EMULATOR_C_INSTRUCTION_H
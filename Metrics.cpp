@@ -0,0 +1,231 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace Emulator {
+
+    namespace {
+        uint64_t Microseconds(Metrics::Clock::duration duration) {
+            return std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0);
+        }
+
+        //Enough digits for rates and seconds, the stream default of 6 would print 1.23457e+06
+        std::string Number(double value) {
+            char text[32];
+            snprintf(text, sizeof(text), "%.9g", value);
+            return text;
+        }
+
+        MetricsSummary Summarize(const Histogram &histogram, uint64_t count, uint64_t sum) {
+            return {count, sum, histogram.Percentile(0.5), histogram.Percentile(0.9), histogram.Percentile(0.99),
+                    histogram.GetMax()};
+        }
+
+        void WriteSummaryJson(const MetricsSummary &summary, std::ostream &out) {
+            out << "{\"count\": " << summary.count << ", \"sum_us\": " << summary.sum << ", \"p50_us\": "
+                << summary.p50 << ", \"p90_us\": " << summary.p90 << ", \"p99_us\": " << summary.p99
+                << ", \"max_us\": " << summary.max << "}";
+        }
+
+        void WriteSummaryPrometheus(const char *name, const char *help, const MetricsSummary &summary,
+                                    std::ostream &out) {
+            out << "# HELP " << name << " " << help << "\n# TYPE " << name << " summary\n";
+            out << name << "{quantile=\"0.5\"} " << Number(summary.p50 / 1e6) << "\n";
+            out << name << "{quantile=\"0.9\"} " << Number(summary.p90 / 1e6) << "\n";
+            out << name << "{quantile=\"0.99\"} " << Number(summary.p99 / 1e6) << "\n";
+            out << name << "_sum " << Number(summary.sum / 1e6) << "\n";
+            out << name << "_count " << summary.count << "\n";
+        }
+
+        void WriteMetricPrometheus(const char *name, const char *type, const char *help, const std::string &value,
+                                   std::ostream &out) {
+            out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+            out << name << " " << value << "\n";
+        }
+    }
+
+    int Histogram::Bucket(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<int>(value);
+
+        int shift = 63 - __builtin_clzll(value) - 3;
+        return (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    uint64_t Histogram::BucketUpperBound(int bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+
+        int shift = bucket / SUB_BUCKETS - 1;
+        uint64_t lower = uint64_t(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+    void Histogram::Record(uint64_t value) {
+        counts[Bucket(value)]++;
+        count++;
+        max = std::max(max, value);
+    }
+
+    void Histogram::Clear() {
+        counts.fill(0);
+        count = 0;
+        max = 0;
+    }
+
+    uint64_t Histogram::GetCount() const {
+        return count;
+    }
+
+    uint64_t Histogram::GetMax() const {
+        return max;
+    }
+
+    uint64_t Histogram::Percentile(double fraction) const {
+        if (count == 0) return 0;
+
+        uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * count)), 1);
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BUCKETS; bucket++) {
+            seen += counts[bucket];
+            if (seen >= target) return std::min(BucketUpperBound(bucket), max);
+        }
+        return max;
+    }
+
+    Metrics::Metrics(int cycles_per_second, int frames_per_second, Clock::time_point start) :
+            cycles_per_second(std::max(cycles_per_second, 1)),
+            frame_period(std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(1.0 / std::max(frames_per_second, 1)))),
+            start(start), last_frame(start), last_snapshot(start), last_snapshot_cycles(0), frames(0),
+            frames_skipped(0), frame_time_count(0), frame_time_sum(0), sleep_overshoot_count(0),
+            sleep_overshoot_sum(0), run_ahead_count(0), run_ahead_sum(0) {}
+
+    void Metrics::FramePresented(Clock::time_point now) {
+        Clock::duration interval = now - last_frame;
+        last_frame = now;
+
+        //A frame that took about n refresh periods means n - 1 refreshes showed the old frame again
+        int64_t periods = (interval + frame_period / 2) / frame_period;
+        if (frames > 0 && periods > 1) frames_skipped += periods - 1;
+        frames++;
+
+        uint64_t microseconds = Microseconds(interval);
+        frame_time.Record(microseconds);
+        frame_time_count++;
+        frame_time_sum += microseconds;
+    }
+
+    void Metrics::Slept(Clock::duration requested, Clock::duration actual) {
+        uint64_t microseconds = Microseconds(actual - requested);
+        sleep_overshoot.Record(microseconds);
+        sleep_overshoot_count++;
+        sleep_overshoot_sum += microseconds;
+    }
+
+    void Metrics::RanAhead(Clock::duration duration) {
+        uint64_t microseconds = Microseconds(duration);
+        run_ahead.Record(microseconds);
+        run_ahead_count++;
+        run_ahead_sum += microseconds;
+    }
+
+    MetricsSnapshot Metrics::Snapshot(const Chip8 &chip8, uint64_t cycles, Clock::time_point now) {
+        const Chip8Counters &counters = chip8.GetCounters();
+        double interval = std::chrono::duration<double>(now - last_snapshot).count();
+        double emulated = static_cast<double>(cycles) / cycles_per_second;
+        double elapsed = std::chrono::duration<double>(now - start).count();
+
+        MetricsSnapshot snapshot = {};
+        snapshot.seconds = elapsed;
+        snapshot.instructions = cycles;
+        snapshot.frames = frames;
+        snapshot.frames_skipped = frames_skipped;
+        snapshot.sprites = counters.sprites;
+        snapshot.collisions = counters.collisions;
+        snapshot.skipped_cycles = counters.skipped_cycles;
+        snapshot.instructions_per_second = interval > 0 ? (cycles - last_snapshot_cycles) / interval : 0;
+        snapshot.timer_drift_us = static_cast<int64_t>((elapsed - emulated) * 1e6);
+        snapshot.frame_time = Summarize(frame_time, frame_time_count, frame_time_sum);
+        snapshot.sleep_overshoot = Summarize(sleep_overshoot, sleep_overshoot_count, sleep_overshoot_sum);
+        snapshot.run_ahead = Summarize(run_ahead, run_ahead_count, run_ahead_sum);
+
+        last_snapshot = now;
+        last_snapshot_cycles = cycles;
+        frame_time.Clear();
+        sleep_overshoot.Clear();
+        run_ahead.Clear();
+        return snapshot;
+    }
+
+    void WriteMetricsJson(const MetricsSnapshot &snapshot, std::ostream &out) {
+        out << "{\"seconds\": " << Number(snapshot.seconds) << ", \"instructions\": " << snapshot.instructions
+            << ", \"instructions_per_second\": " << Number(snapshot.instructions_per_second) << ", \"frames\": "
+            << snapshot.frames << ", \"frames_skipped\": " << snapshot.frames_skipped << ", \"sprites\": "
+            << snapshot.sprites << ", \"collisions\": " << snapshot.collisions << ", \"skipped_cycles\": "
+            << snapshot.skipped_cycles << ", \"timer_drift_us\": " << snapshot.timer_drift_us
+            << ", \"frame_time\": ";
+        WriteSummaryJson(snapshot.frame_time, out);
+        out << ", \"sleep_overshoot\": ";
+        WriteSummaryJson(snapshot.sleep_overshoot, out);
+        out << ", \"run_ahead\": ";
+        WriteSummaryJson(snapshot.run_ahead, out);
+        out << "}\n";
+    }
+
+    void WriteMetricsPrometheus(const MetricsSnapshot &snapshot, std::ostream &out) {
+        WriteMetricPrometheus("chip8_instructions_total", "counter", "Emulated instructions.",
+                              std::to_string(snapshot.instructions), out);
+        WriteMetricPrometheus("chip8_instructions_per_second", "gauge", "Instruction rate over the last interval.",
+                              Number(snapshot.instructions_per_second), out);
+        WriteMetricPrometheus("chip8_frames_total", "counter", "Presented frames.",
+                              std::to_string(snapshot.frames), out);
+        WriteMetricPrometheus("chip8_frames_skipped_total", "counter", "Display refreshes without a new frame.",
+                              std::to_string(snapshot.frames_skipped), out);
+        WriteMetricPrometheus("chip8_sprites_total", "counter", "Drawn sprites.",
+                              std::to_string(snapshot.sprites), out);
+        WriteMetricPrometheus("chip8_collisions_total", "counter", "Sprites that erased a pixel.",
+                              std::to_string(snapshot.collisions), out);
+        WriteMetricPrometheus("chip8_skipped_cycles_total", "counter", "Fast forwarded idle cycles.",
+                              std::to_string(snapshot.skipped_cycles), out);
+        WriteMetricPrometheus("chip8_timer_drift_seconds", "gauge", "Wall clock minus emulated time.",
+                              Number(snapshot.timer_drift_us / 1e6), out);
+        WriteSummaryPrometheus("chip8_frame_time_seconds", "Time between presented frames.", snapshot.frame_time,
+                               out);
+        WriteSummaryPrometheus("chip8_sleep_overshoot_seconds", "Time slept past the requested time.",
+                               snapshot.sleep_overshoot, out);
+        WriteSummaryPrometheus("chip8_run_ahead_seconds", "Time spent running ahead per presented frame.",
+                               snapshot.run_ahead, out);
+    }
+
+    bool WriteMetricsFile(const MetricsSnapshot &snapshot, const std::string &path) {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out.is_open()) return false;
+
+            bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+            if (json) WriteMetricsJson(snapshot, out);
+            else WriteMetricsPrometheus(snapshot, out);
+            if (!out) return false;
+        }
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    std::string FormatMetricsOverlay(const MetricsSnapshot &snapshot) {
+        char text[160];
+        snprintf(text, sizeof(text), "IPS %.0f\nFT P50 %.1f P99 %.1f MS\nSKIP %llu DRIFT %lld MS",
+                 snapshot.instructions_per_second, snapshot.frame_time.p50 / 1e3, snapshot.frame_time.p99 / 1e3,
+                 static_cast<unsigned long long>(snapshot.frames_skipped),
+                 static_cast<long long>(snapshot.timer_drift_us / 1000));
+        std::string overlay = text;
+
+        if (snapshot.run_ahead.count > 0) {
+            snprintf(text, sizeof(text), "\nAHEAD P50 %llu P99 %llu US",
+                     static_cast<unsigned long long>(snapshot.run_ahead.p50),
+                     static_cast<unsigned long long>(snapshot.run_ahead.p99));
+            overlay += text;
+        }
+        return overlay;
+    }
+}
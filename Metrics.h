@@ -0,0 +1,116 @@
+#ifndef CHIP8_EMULATOR_C_METRICS_H
+#define CHIP8_EMULATOR_C_METRICS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    //Log linear histogram, values below 8 have their own bucket and every power of two above is split into 8
+    //buckets, so percentiles are within 12.5% of the recorded value. Recording never allocates.
+    class Histogram {
+
+    public:
+        static constexpr int SUB_BUCKETS = 8;
+        static constexpr int BUCKETS = 62 * SUB_BUCKETS;
+
+    private:
+        std::array<uint64_t, BUCKETS> counts{};
+        uint64_t count = 0;
+        uint64_t max = 0;
+
+        static int Bucket(uint64_t value);
+        static uint64_t BucketUpperBound(int bucket);
+
+    public:
+        void Record(uint64_t value);
+        void Clear();
+
+        uint64_t GetCount() const;
+        uint64_t GetMax() const;
+        //Upper bound of the bucket holding the given fraction of the values, 0 when nothing was recorded
+        uint64_t Percentile(double fraction) const;
+    };
+
+    //Percentiles and maximum over the last interval, count and sum since the start. Times are in microseconds
+    struct MetricsSummary {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t max;
+    };
+
+    struct MetricsSnapshot {
+        double seconds; //Since the metrics were created
+        uint64_t instructions; //Emulated cycles, including fast forwarded ones
+        uint64_t frames;
+        uint64_t frames_skipped; //Display refreshes that passed without a new frame because the loop fell behind
+        uint64_t sprites;
+        uint64_t collisions;
+        uint64_t skipped_cycles;
+        double instructions_per_second; //Over the last interval
+        int64_t timer_drift_us; //Wall clock minus emulated time, positive when the emulation runs behind
+        MetricsSummary frame_time;
+        MetricsSummary sleep_overshoot;
+        MetricsSummary run_ahead; //Time spent running ahead per presented frame, empty without run-ahead
+    };
+
+    //Runtime metrics of a frontend loop. The loop reports presented frames and its sleeps, the instruction, sprite
+    //and collision counts are read from the Chip8 when a snapshot is taken. Snapshot() closes the interval the
+    //instruction rate and the percentiles are computed over, take one about every second.
+    class Metrics {
+
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        int cycles_per_second;
+        Clock::duration frame_period;
+
+        Clock::time_point start;
+        Clock::time_point last_frame;
+        Clock::time_point last_snapshot;
+        uint64_t last_snapshot_cycles;
+
+        uint64_t frames;
+        uint64_t frames_skipped;
+
+        Histogram frame_time;
+        uint64_t frame_time_count;
+        uint64_t frame_time_sum;
+        Histogram sleep_overshoot;
+        uint64_t sleep_overshoot_count;
+        uint64_t sleep_overshoot_sum;
+        Histogram run_ahead;
+        uint64_t run_ahead_count;
+        uint64_t run_ahead_sum;
+
+    public:
+        Metrics(int cycles_per_second, int frames_per_second, Clock::time_point start = Clock::now());
+
+        void FramePresented(Clock::time_point now);
+        void Slept(Clock::duration requested, Clock::duration actual);
+        void RanAhead(Clock::duration duration);
+
+        //cycles is the total number of cycles run so far
+        MetricsSnapshot Snapshot(const Chip8 &chip8, uint64_t cycles, Clock::time_point now);
+    };
+
+    void WriteMetricsJson(const MetricsSnapshot &snapshot, std::ostream &out);
+    //Prometheus text exposition format, counters end in _total and the times are summaries in seconds
+    void WriteMetricsPrometheus(const MetricsSnapshot &snapshot, std::ostream &out);
+    //Replaces the file in one rename so readers never see a partial dump, JSON for paths ending in .json and
+    //Prometheus text for everything else
+    bool WriteMetricsFile(const MetricsSnapshot &snapshot, const std::string &path);
+
+    //A few short lines for the on screen overlay
+    std::string FormatMetricsOverlay(const MetricsSnapshot &snapshot);
+}
+
+#endif //CHIP8_EMULATOR_C_METRICS_H
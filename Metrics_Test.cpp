@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+#include <sstream>
+#include "Metrics.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Histogram percentiles are within a bucket of the recorded values") {
+    Emulator::Histogram histogram;
+    REQUIRE(histogram.Percentile(0.5) == 0);
+
+    for (uint64_t value = 1; value <= 1000; value++) histogram.Record(value);
+
+    REQUIRE(histogram.GetCount() == 1000);
+    REQUIRE(histogram.GetMax() == 1000);
+    REQUIRE(histogram.Percentile(0.5) >= 500);
+    REQUIRE(histogram.Percentile(0.5) <= 500 * 9 / 8);
+    REQUIRE(histogram.Percentile(0.99) >= 990);
+    REQUIRE(histogram.Percentile(1.0) == 1000);
+
+    //Small values are exact
+    histogram.Clear();
+    histogram.Record(3);
+    REQUIRE(histogram.Percentile(0.5) == 3);
+}
+
+TEST_CASE("Metrics count frames, skipped refreshes and the instruction rate") {
+    Emulator::Chip8 chip8(1);
+    Emulator::Metrics::Clock::time_point start;
+    Emulator::Metrics metrics(1000, 60, start);
+
+    auto frame = std::chrono::duration_cast<Emulator::Metrics::Clock::duration>(1s) / 60;
+    auto now = start;
+    for (int i = 0; i < 10; i++) {
+        now += frame;
+        metrics.FramePresented(now);
+    }
+    //Three refresh periods without a frame, two of them are skipped
+    now += frame * 3;
+    metrics.FramePresented(now);
+    metrics.Slept(1000us, 1100us);
+    metrics.RanAhead(300us);
+
+    Emulator::MetricsSnapshot snapshot = metrics.Snapshot(chip8, 500, start + 1s);
+    REQUIRE(snapshot.frames == 11);
+    REQUIRE(snapshot.frames_skipped == 2);
+    REQUIRE(snapshot.instructions_per_second == Approx(500));
+    REQUIRE(snapshot.timer_drift_us == 500000);
+    REQUIRE(snapshot.frame_time.count == 11);
+    REQUIRE(snapshot.frame_time.p50 >= 16666);
+    REQUIRE(snapshot.frame_time.p50 < 17000 * 9 / 8);
+    REQUIRE(snapshot.frame_time.max >= 49999);
+    REQUIRE(snapshot.sleep_overshoot.max == 100);
+    REQUIRE(snapshot.run_ahead.count == 1);
+    REQUIRE(snapshot.run_ahead.max == 300);
+    REQUIRE(Emulator::FormatMetricsOverlay(snapshot).find("\nAHEAD P50 300 P99 300 US") != std::string::npos);
+
+    //The rate and the percentiles cover the last interval only
+    snapshot = metrics.Snapshot(chip8, 2500, start + 2s);
+    REQUIRE(snapshot.instructions_per_second == Approx(2000));
+    REQUIRE(snapshot.frame_time.count == 11);
+    REQUIRE(snapshot.frame_time.max == 0);
+}
+
+TEST_CASE("Metrics read sprite and collision counts from the emulator") {
+    Emulator::Chip8 chip8(1);
+    //Draws the font sprite of 0 twice at the same place, the second draw collides
+    const uint8_t rom[] = {0xA0, 0x00, 0xD0, 0x05, 0xD0, 0x05};
+    chip8.LoadRom(rom);
+    for (int i = 0; i < 3; i++) chip8.EmulateCycle();
+
+    Emulator::Metrics::Clock::time_point start;
+    Emulator::Metrics metrics(1000, 60, start);
+    Emulator::MetricsSnapshot snapshot = metrics.Snapshot(chip8, 3, start + 1s);
+    REQUIRE(snapshot.sprites == 2);
+    REQUIRE(snapshot.collisions == 1);
+
+    chip8.ResetCounters();
+    REQUIRE(chip8.GetCounters().sprites == 0);
+}
+
+TEST_CASE("Metrics are written as JSON and Prometheus text") {
+    Emulator::MetricsSnapshot snapshot = {};
+    snapshot.instructions = 123456789;
+    snapshot.frames = 60;
+    snapshot.instructions_per_second = 1000;
+    snapshot.frame_time = {60, 1000000, 16000, 17000, 18000, 20000};
+
+    std::ostringstream json;
+    Emulator::WriteMetricsJson(snapshot, json);
+    REQUIRE(json.str().find("\"instructions\": 123456789,") != std::string::npos);
+    REQUIRE(json.str().find("\"frame_time\": {\"count\": 60, \"sum_us\": 1000000, \"p50_us\": 16000") !=
+            std::string::npos);
+
+    std::ostringstream prometheus;
+    Emulator::WriteMetricsPrometheus(snapshot, prometheus);
+    REQUIRE(prometheus.str().find("# TYPE chip8_instructions_total counter\nchip8_instructions_total 123456789\n") !=
+            std::string::npos);
+    REQUIRE(prometheus.str().find("chip8_frame_time_seconds{quantile=\"0.99\"} 0.018\n") != std::string::npos);
+    REQUIRE(prometheus.str().find("chip8_frame_time_seconds_count 60\n") != std::string::npos);
+
+    REQUIRE(Emulator::FormatMetricsOverlay(snapshot).find("IPS 1000") == 0);
+    REQUIRE(Emulator::FormatMetricsOverlay(snapshot).find("AHEAD") == std::string::npos);
+}
@@ -0,0 +1,300 @@
+#include "Netplay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Emulator {
+
+    namespace {
+        //Bytes in front of the keys
+        const size_t HEADER = 27;
+
+        void PutLittleEndian(uint8_t *out, uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+
+        uint64_t GetLittleEndian(const uint8_t *in, int bytes) {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; i++) value |= uint64_t(in[i]) << (8 * i);
+            return value;
+        }
+    }
+
+    UdpTransport::UdpTransport() : socket(-1) {}
+
+    UdpTransport::~UdpTransport() {
+        if (socket >= 0) close(socket);
+    }
+
+    bool UdpTransport::Bind(uint16_t port) {
+        if (socket >= 0) close(socket);
+        socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socket < 0) return false;
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            close(socket);
+            socket = -1;
+            return false;
+        }
+        return true;
+    }
+
+    bool UdpTransport::Connect(const std::string &host, uint16_t port) {
+        if (socket < 0) return false;
+
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo *addresses = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &addresses) != 0 || !addresses) return false;
+
+        sockaddr_in address = *reinterpret_cast<sockaddr_in *>(addresses->ai_addr);
+        freeaddrinfo(addresses);
+        address.sin_port = htons(port);
+        return connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    }
+
+    uint16_t UdpTransport::GetPort() const {
+        sockaddr_in address = {};
+        socklen_t length = sizeof(address);
+        if (socket < 0 || getsockname(socket, reinterpret_cast<sockaddr *>(&address), &length) != 0) return 0;
+        return ntohs(address.sin_port);
+    }
+
+    void UdpTransport::Send(const uint8_t *data, size_t length) {
+        //A full send buffer loses the packet like the network would, the next one carries the same keys
+        if (socket >= 0) send(socket, data, length, 0);
+    }
+
+    int UdpTransport::Receive(uint8_t *data, size_t capacity) {
+        if (socket < 0) return -1;
+        //Errors like ECONNREFUSED before the peer is up count as nothing received
+        ssize_t received = recv(socket, data, capacity, 0);
+        return received < 0 ? -1 : static_cast<int>(received);
+    }
+
+    LoopbackLink::LoopbackLink(const LinkConditions &conditions) :
+            conditions(conditions), rng(conditions.seed), now(0), lost(0) {
+        for (int side = 0; side < 2; side++) {
+            ends[side].link = this;
+            ends[side].side = side;
+        }
+    }
+
+    void LoopbackLink::End::Send(const uint8_t *data, size_t length) {
+        const LinkConditions &conditions = link->conditions;
+        if (double(link->rng.Next()) < conditions.loss * 4294967296.0) {
+            link->lost++;
+            return;
+        }
+
+        uint64_t arrival = link->now + std::max(conditions.latency, 0);
+        if (conditions.jitter > 0) arrival += link->rng.Next() % uint32_t(conditions.jitter + 1);
+        link->in_flight[1 - side].emplace(arrival, std::vector<uint8_t>(data, data + length));
+    }
+
+    int LoopbackLink::End::Receive(uint8_t *data, size_t capacity) {
+        auto &in_flight = link->in_flight[side];
+        auto next = in_flight.begin();
+        if (next == in_flight.end() || next->first > link->now) return -1;
+
+        size_t length = std::min(next->second.size(), capacity);
+        memcpy(data, next->second.data(), length);
+        in_flight.erase(next);
+        return static_cast<int>(length);
+    }
+
+    NetplayTransport &LoopbackLink::GetEnd(int side) {
+        return ends[side & 1];
+    }
+
+    void LoopbackLink::Tick() {
+        now++;
+    }
+
+    uint64_t LoopbackLink::GetLost() const {
+        return lost;
+    }
+
+    NetplaySession::NetplaySession(Chip8 &chip8, NetplayTransport &transport, const NetplayOptions &options) :
+            chip8(chip8), transport(transport), cycles_per_second(std::max(options.cycles_per_second, 1)),
+            input_delay(std::min(std::max(options.input_delay, 0), MAX_INPUT_DELAY)),
+            max_prediction(std::min(std::max(options.max_prediction, 1), STATE_RING - 1)),
+            frame(0), remote_received(0), remote_acked(0), remote_frame(0), remote_advantage(0), checked_frame(0),
+            states(STATE_RING), peer_hash_frame(0), peer_hash(0), packet(MAX_PACKET) {}
+
+    uint32_t NetplaySession::Oldest() const {
+        //Keys still needed: ours the peer hasn't acknowledged, and the peer's last ones for predictions
+        return std::min(remote_acked, remote_received > 0 ? remote_received - 1 : 0);
+    }
+
+    uint64_t NetplaySession::CyclesInFrame(uint32_t frame) const {
+        //Spreads the remainder of uneven rates like 1000 Hz over 60 Hz the same way on both sides
+        return (uint64_t(frame) + 1) * cycles_per_second / 60 - uint64_t(frame) * cycles_per_second / 60;
+    }
+
+    void NetplaySession::RunFrame(uint32_t frame) {
+        states[frame % STATE_RING] = chip8.GetState();
+        hashes[frame % STATE_RING] = chip8.StateHash();
+
+        uint16_t remote = 0;
+        if (frame < remote_received) remote = remote_keys[frame % INPUT_RING];
+        else if (remote_received > 0) remote = remote_keys[(remote_received - 1) % INPUT_RING];
+        used_remote_keys[frame % INPUT_RING] = remote;
+
+        chip8.SetKeyState(local_keys[frame % INPUT_RING] | remote);
+        chip8.Run(CyclesInFrame(frame));
+    }
+
+    void NetplaySession::HandlePacket(const uint8_t *data, size_t length, uint32_t *rollback_from) {
+        if (length < HEADER || data[0] != 'I') return;
+        size_t count = data[26];
+        if (length != HEADER + 2 * count) return;
+        stats.packets_received++;
+
+        auto sender_frame = static_cast<uint32_t>(GetLittleEndian(data + 1, 4));
+        if (sender_frame >= remote_frame) {
+            remote_frame = sender_frame;
+            remote_advantage = static_cast<int8_t>(data[5]);
+        }
+        auto ack = static_cast<uint32_t>(GetLittleEndian(data + 6, 4));
+        remote_acked = std::max(remote_acked, std::min(ack, frame + input_delay));
+
+        auto hash_frame = static_cast<uint32_t>(GetLittleEndian(data + 10, 4));
+        if (hash_frame >= peer_hash_frame) {
+            peer_hash_frame = hash_frame;
+            peer_hash = GetLittleEndian(data + 14, 8);
+        }
+
+        //Keys are only taken without a gap, the peer resends everything from our ack on
+        auto first = static_cast<uint32_t>(GetLittleEndian(data + 22, 4));
+        if (first > remote_received) return;
+        for (uint32_t key_frame = remote_received; key_frame < first + count; key_frame++) {
+            if (key_frame - Oldest() >= uint32_t(INPUT_RING)) break;
+
+            auto keys = static_cast<uint16_t>(GetLittleEndian(data + HEADER + 2 * (key_frame - first), 2));
+            remote_keys[key_frame % INPUT_RING] = keys;
+            if (key_frame < frame && keys != used_remote_keys[key_frame % INPUT_RING]) {
+                *rollback_from = std::min(*rollback_from, key_frame);
+            }
+            remote_received = key_frame + 1;
+        }
+    }
+
+    void NetplaySession::Receive() {
+        uint32_t rollback_from = frame;
+        int length;
+        while ((length = transport.Receive(packet.data(), packet.size())) >= 0) {
+            HandlePacket(packet.data(), length, &rollback_from);
+        }
+
+        if (rollback_from < frame) {
+            auto start = std::chrono::steady_clock::now();
+            uint16_t keys = chip8.GetKeyState();
+            chip8.SetState(states[rollback_from % STATE_RING]);
+            for (uint32_t again = rollback_from; again < frame; again++) RunFrame(again);
+            chip8.SetKeyState(keys);
+
+            stats.rollbacks++;
+            stats.resimulated_frames += frame - rollback_from;
+            stats.max_rollback = std::max<uint64_t>(stats.max_rollback, frame - rollback_from);
+            stats.resimulate_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+        }
+
+        CheckHash();
+    }
+
+    void NetplaySession::CheckHash() {
+        //The peer's hash can only be compared once this side has all keys up to its frame too
+        if (stats.packets_received == 0 || peer_hash_frame < checked_frame) return;
+        if (peer_hash_frame > GetConfirmedFrame()) return;
+
+        if (frame - peer_hash_frame < uint32_t(STATE_RING)) {
+            uint64_t hash = peer_hash_frame < frame ? hashes[peer_hash_frame % STATE_RING] : chip8.StateHash();
+            if (hash != peer_hash) stats.desyncs++;
+        }
+        checked_frame = peer_hash_frame + 1;
+    }
+
+    void NetplaySession::SendKeys() {
+        uint32_t recorded = frame + input_delay;
+        uint32_t first = std::min(remote_acked, recorded);
+        uint32_t count = std::min<uint32_t>(recorded - first, 255);
+
+        uint32_t confirmed = GetConfirmedFrame();
+        uint64_t hash = confirmed < frame ? hashes[confirmed % STATE_RING] : chip8.StateHash();
+        int64_t advantage = int64_t(frame) - remote_frame;
+
+        uint8_t *out = packet.data();
+        out[0] = 'I';
+        PutLittleEndian(out + 1, frame, 4);
+        out[5] = static_cast<uint8_t>(std::min<int64_t>(std::max<int64_t>(advantage, -128), 127));
+        PutLittleEndian(out + 6, remote_received, 4);
+        PutLittleEndian(out + 10, confirmed, 4);
+        PutLittleEndian(out + 14, hash, 8);
+        PutLittleEndian(out + 22, first, 4);
+        out[26] = static_cast<uint8_t>(count);
+        for (uint32_t i = 0; i < count; i++) {
+            PutLittleEndian(out + HEADER + 2 * i, local_keys[(first + i) % INPUT_RING], 2);
+        }
+
+        transport.Send(out, HEADER + 2 * count);
+        stats.packets_sent++;
+    }
+
+    bool NetplaySession::AdvanceFrame(uint16_t keys) {
+        Receive();
+
+        //Too far ahead of the peer's keys, or of what it acknowledged to fit the send window
+        if (int64_t(frame) - remote_received >= max_prediction ||
+            frame + input_delay - Oldest() >= uint32_t(INPUT_RING - 1)) {
+            stats.stalls++;
+            chip8.SetKeyState(keys);
+            SendKeys();
+            return false;
+        }
+
+        local_keys[(frame + input_delay) % INPUT_RING] = keys;
+        RunFrame(frame);
+        frame++;
+        stats.frames++;
+        chip8.SetKeyState(keys);
+
+        SendKeys();
+        return true;
+    }
+
+    void NetplaySession::Poll() {
+        Receive();
+        SendKeys();
+    }
+
+    uint32_t NetplaySession::GetFrame() const {
+        return frame;
+    }
+
+    uint32_t NetplaySession::GetConfirmedFrame() const {
+        return std::min(remote_received, frame);
+    }
+
+    int NetplaySession::GetFrameAdvantage() const {
+        if (stats.packets_received == 0) return 0;
+        //Both sides see the other one latency frames late, the difference of their views cancels it out
+        int64_t advantage = int64_t(frame) - remote_frame;
+        return static_cast<int>((advantage - remote_advantage) / 2);
+    }
+
+    const NetplayStats &NetplaySession::GetStats() const {
+        return stats;
+    }
+}
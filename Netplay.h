@@ -0,0 +1,181 @@
+#ifndef CHIP8_EMULATOR_C_NETPLAY_H
+#define CHIP8_EMULATOR_C_NETPLAY_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Chip8.h"
+#include "Random.h"
+
+namespace Emulator {
+
+    //Unreliable datagrams to and from one peer, packets may be lost, duplicated or reordered
+    class NetplayTransport {
+
+    public:
+        virtual ~NetplayTransport() = default;
+
+        virtual void Send(const uint8_t *data, size_t length) = 0;
+        //Copies the next waiting datagram to data and returns its length, -1 when none is waiting
+        virtual int Receive(uint8_t *data, size_t capacity) = 0;
+    };
+
+    //Non-blocking IPv4 UDP socket talking to a single peer
+    class UdpTransport : public NetplayTransport {
+
+    private:
+        int socket;
+
+    public:
+        UdpTransport();
+        ~UdpTransport() override;
+        UdpTransport(const UdpTransport &) = delete;
+        UdpTransport &operator=(const UdpTransport &) = delete;
+
+        //Listens on port on all interfaces, 0 picks a free port
+        bool Bind(uint16_t port);
+        //Sends to and only receives from host:port, call after Bind()
+        bool Connect(const std::string &host, uint16_t port);
+        uint16_t GetPort() const;
+
+        void Send(const uint8_t *data, size_t length) override;
+        int Receive(uint8_t *data, size_t capacity) override;
+    };
+
+    struct LinkConditions {
+        int latency = 0; //Frames until a packet arrives
+        int jitter = 0; //Up to this many more frames, picked per packet, so packets get reordered
+        double loss = 0; //Probability that a packet is dropped
+        uint64_t seed = 0;
+    };
+
+    //Two connected transports in one process for tests and benchmarks. Time is counted in frames and only moves on
+    //Tick(), so a run with the same conditions and seed always delivers the same packets at the same frames.
+    class LoopbackLink {
+
+    private:
+        class End : public NetplayTransport {
+
+        public:
+            LoopbackLink *link;
+            int side;
+
+            void Send(const uint8_t *data, size_t length) override;
+            int Receive(uint8_t *data, size_t capacity) override;
+        };
+
+        LinkConditions conditions;
+        Xoshiro128 rng;
+        uint64_t now;
+        std::array<End, 2> ends;
+        std::array<std::multimap<uint64_t, std::vector<uint8_t>>, 2> in_flight; //By arrival frame, per receiver
+        uint64_t lost;
+
+    public:
+        explicit LoopbackLink(const LinkConditions &conditions);
+        LoopbackLink(const LoopbackLink &) = delete;
+        LoopbackLink &operator=(const LoopbackLink &) = delete;
+
+        //Side 0 or 1, what one side sends the other receives
+        NetplayTransport &GetEnd(int side);
+        void Tick();
+        uint64_t GetLost() const;
+    };
+
+    struct NetplayOptions {
+        int cycles_per_second = 1000;
+        //Frames before local keys take effect. Each frame of delay hides a frame of latency from the peer, at the
+        //cost of the local player seeing their own presses later
+        int input_delay = 0;
+        //Frames the machine may run ahead of the last keys received from the peer before it waits for them
+        int max_prediction = 8;
+    };
+
+    struct NetplayStats {
+        uint64_t frames = 0; //Frames advanced, not counting re-simulation
+        uint64_t rollbacks = 0; //Predictions of the peer's keys that turned out wrong and rewound the machine
+        uint64_t resimulated_frames = 0;
+        uint64_t resimulate_nanoseconds = 0; //Restoring and running the resimulated frames
+        uint64_t max_rollback = 0; //Most frames rewound at once
+        uint64_t stalls = 0; //AdvanceFrame() calls that waited for the peer
+        uint64_t packets_sent = 0;
+        uint64_t packets_received = 0;
+        uint64_t desyncs = 0; //Frames whose confirmed state differed from the peer's
+    };
+
+    //Runs a machine in lockstep with a peer that runs the same ROM with the same seed, for games where two players
+    //share the keypad. Both machines press the keys of both players, frame by frame.
+    //The keys of the peer for the current frame are predicted to be the last ones received. The machine state
+    //before every frame is kept, and when the real keys arrive and differ from the prediction the machine is
+    //restored to the first wrong frame and the frames since are run again.
+    //Every frame each side sends all of its keys the peer hasn't acknowledged, so a lost packet is made up for by
+    //the next one. Integers are little endian:
+    //  'I' <u32 frame> <i8 advantage> <u32 ack> <u32 hash frame> <u64 hash> <u32 first> <u8 count> <u16 keys>*count
+    //frame is the sender's next frame and advantage how far it thinks it is ahead, ack the number of frames of keys
+    //it has received, then the state hash at the start of a frame it has all keys for, then its keys from frame
+    //first on. Hashes are compared to count desyncs.
+    class NetplaySession {
+
+    public:
+        static constexpr int INPUT_RING = 256;
+        static constexpr int STATE_RING = 64;
+        static constexpr int MAX_INPUT_DELAY = 16;
+        static constexpr int MAX_PACKET = 27 + 2 * 255;
+
+    private:
+        Chip8 &chip8;
+        NetplayTransport &transport;
+        int cycles_per_second;
+        int input_delay;
+        int max_prediction;
+
+        uint32_t frame; //Next frame to run
+        uint32_t remote_received; //Frames of keys received from the peer without a gap
+        uint32_t remote_acked; //Frames of keys the peer has received from us
+        uint32_t remote_frame;
+        int remote_advantage;
+        uint32_t checked_frame; //Frames before this had their hashes compared already
+
+        std::array<uint16_t, INPUT_RING> local_keys{};
+        std::array<uint16_t, INPUT_RING> remote_keys{};
+        std::array<uint16_t, INPUT_RING> used_remote_keys{}; //What each run frame was simulated with
+        std::vector<Chip8State> states; //At the start of each frame
+        std::array<uint64_t, STATE_RING> hashes{};
+
+        uint32_t peer_hash_frame;
+        uint64_t peer_hash;
+
+        NetplayStats stats;
+        std::vector<uint8_t> packet;
+
+        uint32_t Oldest() const;
+        uint64_t CyclesInFrame(uint32_t frame) const;
+        void RunFrame(uint32_t frame);
+        void Receive();
+        void HandlePacket(const uint8_t *data, size_t length, uint32_t *rollback_from);
+        void CheckHash();
+        void SendKeys();
+
+    public:
+        //chip8 has to be in the same state as the peer's machine, usually the same ROM loaded with the same seed
+        NetplaySession(Chip8 &chip8, NetplayTransport &transport, const NetplayOptions &options = NetplayOptions());
+
+        //Handles the peer's packets, records the local keys and runs one frame. Returns false without running when
+        //the peer is too far behind, call again with the then current keys. Between frames the machine holds only
+        //the local keys, so a frontend can keep updating them with SetKeyPressed().
+        bool AdvanceFrame(uint16_t keys);
+        //Handles the peer's packets and sends the local keys again without running a frame
+        void Poll();
+
+        uint32_t GetFrame() const;
+        //Frames before this ran with the peer's real keys and won't be rolled back anymore
+        uint32_t GetConfirmedFrame() const;
+        //How many frames this side runs ahead of the peer, a side that is ahead should wait now and then
+        int GetFrameAdvantage() const;
+        const NetplayStats &GetStats() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_NETPLAY_H
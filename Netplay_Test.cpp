@@ -0,0 +1,178 @@
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <vector>
+#include "Netplay.h"
+
+namespace {
+    //Adds V0 to V1 for every pressed key V0 and V1 to V2 after each pass, so the registers depend on the keys of
+    //every frame
+    const std::vector<uint8_t> KEYS_ROM = {0x60, 0x00, 0xE0, 0xA1, 0x81, 0x04, 0x70, 0x01, 0x30, 0x10, 0x12, 0x02,
+                                           0x82, 0x14, 0x12, 0x00};
+
+    Emulator::Chip8 &Loaded(Emulator::Chip8 &chip8) {
+        chip8.LoadRom(KEYS_ROM);
+        return chip8;
+    }
+
+    //Keys a player holds in a frame, they change every few frames like a person's would
+    uint16_t PlayerKeys(uint64_t seed, uint32_t frame) {
+        Emulator::Xoshiro128 rng(seed * 1000003 + frame / 5);
+        return static_cast<uint16_t>(rng.Next());
+    }
+
+    struct Match {
+        Emulator::LoopbackLink link;
+        Emulator::Chip8 chip8[2];
+        Emulator::NetplaySession session[2];
+
+        Match(const Emulator::LinkConditions &conditions, const Emulator::NetplayOptions &options) :
+                link(conditions), chip8{Emulator::Chip8(7), Emulator::Chip8(7)},
+                session{{Loaded(chip8[0]), link.GetEnd(0), options}, {Loaded(chip8[1]), link.GetEnd(1), options}} {}
+
+        //Plays frames frames a frame per tick, then lets the sessions exchange the rest of the keys
+        void Play(uint32_t frames) {
+            for (int tick = 0; tick < 100000; tick++) {
+                bool done = true;
+                for (int side = 0; side < 2; side++) {
+                    Emulator::NetplaySession &player = session[side];
+                    if (player.GetFrame() < frames) player.AdvanceFrame(PlayerKeys(side, player.GetFrame()));
+                    else player.Poll();
+                    done = done && player.GetConfirmedFrame() == frames;
+                }
+                if (done) return;
+                link.Tick();
+            }
+        }
+    };
+
+    //The machine both sides should end up with: the keys of both players pressed from the start of every frame
+    Emulator::Chip8State Expected(uint32_t frames, int input_delay) {
+        Emulator::Chip8 chip8(7);
+        chip8.LoadRom(KEYS_ROM);
+        for (uint32_t frame = 0; frame < frames; frame++) {
+            uint32_t pressed = frame - input_delay;
+            if (frame >= uint32_t(input_delay)) chip8.SetKeyState(PlayerKeys(0, pressed) | PlayerKeys(1, pressed));
+            else chip8.SetKeyState(0);
+            chip8.Run((uint64_t(frame) + 1) * 1000 / 60 - uint64_t(frame) * 1000 / 60);
+        }
+        return chip8.GetState();
+    }
+}
+
+TEST_CASE("Netplay sessions agree with a local machine given both players' keys") {
+    const uint32_t FRAMES = 300;
+    struct Case {
+        Emulator::LinkConditions conditions;
+        int input_delay;
+    };
+    std::vector<Case> cases = {{{0, 0, 0.0, 1}, 1},
+                               {{3, 0, 0.0, 2}, 0},
+                               {{2, 3, 0.2, 3}, 0},
+                               {{4, 2, 0.3, 4}, 2}};
+
+    for (const Case &test : cases) {
+        Emulator::NetplayOptions options;
+        options.input_delay = test.input_delay;
+        Match match(test.conditions, options);
+        match.Play(FRAMES);
+
+        Emulator::Chip8State expected = Expected(FRAMES, test.input_delay);
+        for (int side = 0; side < 2; side++) {
+            const Emulator::NetplayStats &stats = match.session[side].GetStats();
+            REQUIRE(match.session[side].GetConfirmedFrame() == FRAMES);
+            REQUIRE(memcmp(&match.chip8[side].GetState(), &expected, sizeof(expected)) == 0);
+            REQUIRE(stats.frames == FRAMES);
+            REQUIRE(stats.desyncs == 0);
+
+            //With more delay than latency the keys always arrive in time, otherwise the predictions miss now and then
+            if (test.input_delay > test.conditions.latency + test.conditions.jitter) REQUIRE(stats.rollbacks == 0);
+            else REQUIRE(stats.rollbacks > 0);
+            REQUIRE(stats.max_rollback <= 8);
+            REQUIRE(stats.resimulated_frames >= stats.rollbacks);
+        }
+        if (test.conditions.loss > 0) REQUIRE(match.link.GetLost() > 0);
+    }
+}
+
+TEST_CASE("Netplay waits for a peer that falls behind") {
+    Emulator::LoopbackLink link({});
+    Emulator::Chip8 chip8(1);
+    chip8.LoadRom(KEYS_ROM);
+    Emulator::NetplayOptions options;
+    options.max_prediction = 4;
+    Emulator::NetplaySession session(chip8, link.GetEnd(0), options);
+
+    //Nobody answers, so only max_prediction frames run
+    for (int i = 0; i < 10; i++) session.AdvanceFrame(0x0001);
+    REQUIRE(session.GetFrame() == 4);
+    REQUIRE(session.GetStats().stalls == 6);
+    REQUIRE(session.GetStats().packets_sent == 10);
+
+    //The machine holds the local keys between frames
+    REQUIRE(chip8.GetKeyState() == 0x0001);
+}
+
+TEST_CASE("Netplay detects machines that drifted apart") {
+    //Different seeds, and RND decides what ends up in V1
+    const std::vector<uint8_t> rom = {0xC1, 0xFF, 0x12, 0x00};
+    Emulator::LoopbackLink link({1, 0, 0.0, 0});
+    Emulator::Chip8 first(1), second(2);
+    first.LoadRom(rom);
+    second.LoadRom(rom);
+    Emulator::NetplaySession sessions[2] = {{first, link.GetEnd(0)}, {second, link.GetEnd(1)}};
+
+    for (int frame = 0; frame < 20; frame++) {
+        for (auto &session : sessions) session.AdvanceFrame(0);
+        link.Tick();
+    }
+    REQUIRE(sessions[0].GetStats().desyncs > 0);
+    REQUIRE(sessions[1].GetStats().desyncs > 0);
+}
+
+TEST_CASE("Netplay estimates how far a side runs ahead") {
+    Emulator::LoopbackLink link({2, 0, 0.0, 0});
+    Emulator::Chip8 chip8[2] = {Emulator::Chip8(3), Emulator::Chip8(3)};
+    Emulator::NetplayOptions options;
+    options.max_prediction = 20;
+    Emulator::NetplaySession sessions[2] = {{Loaded(chip8[0]), link.GetEnd(0), options},
+                                            {Loaded(chip8[1]), link.GetEnd(1), options}};
+
+    //The first side starts 6 frames earlier
+    for (int tick = 0; tick < 40; tick++) {
+        sessions[0].AdvanceFrame(0);
+        if (tick >= 6) sessions[1].AdvanceFrame(0);
+        link.Tick();
+    }
+    REQUIRE(sessions[0].GetFrameAdvantage() == 6);
+    REQUIRE(sessions[1].GetFrameAdvantage() == -6);
+}
+
+TEST_CASE("UDP transport exchanges datagrams with its peer") {
+    Emulator::UdpTransport first, second;
+    REQUIRE(first.Bind(0));
+    REQUIRE(second.Bind(0));
+    REQUIRE(first.Connect("127.0.0.1", second.GetPort()));
+    REQUIRE(second.Connect("127.0.0.1", first.GetPort()));
+
+    uint8_t buffer[16];
+    REQUIRE(second.Receive(buffer, sizeof(buffer)) == -1);
+
+    const uint8_t hello[] = {'I', 1, 2, 3};
+    first.Send(hello, sizeof(hello));
+    int received = -1;
+    for (int attempt = 0; attempt < 1000 && received < 0; attempt++) received = second.Receive(buffer, sizeof(buffer));
+    REQUIRE(received == sizeof(hello));
+    REQUIRE(memcmp(buffer, hello, sizeof(hello)) == 0);
+
+    //Two sessions over real sockets
+    Emulator::Chip8 chip8[2] = {Emulator::Chip8(5), Emulator::Chip8(5)};
+    Emulator::NetplaySession sessions[2] = {{Loaded(chip8[0]), first}, {Loaded(chip8[1]), second}};
+    for (int tick = 0; tick < 100000 && (sessions[0].GetFrame() < 30 || sessions[1].GetFrame() < 30); tick++) {
+        for (int side = 0; side < 2; side++) {
+            if (sessions[side].GetFrame() < 30) sessions[side].AdvanceFrame(uint16_t(1 << side));
+            else sessions[side].Poll();
+        }
+    }
+    REQUIRE(sessions[0].GetFrame() == 30);
+    REQUIRE(sessions[1].GetFrame() == 30);
+}
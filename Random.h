@@ -0,0 +1,69 @@
+#ifndef CHIP8_EMULATOR_C_RANDOM_H
+#define CHIP8_EMULATOR_C_RANDOM_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+namespace Emulator {
+
+    //Pluggable random byte source for the CXNN opcode, replaces the built in generator when set
+    using RandomSource = std::function<unsigned char()>;
+
+    //xoshiro128++ by Blackman and Vigna, 16 bytes of state and a handful of ALU ops per number
+    class Xoshiro128 {
+
+    private:
+        std::array<uint32_t, 4> state;
+
+        static uint32_t RotateLeft(uint32_t x, int k) {
+            return (x << k) | (x >> (32 - k));
+        }
+
+    public:
+        explicit Xoshiro128(uint64_t seed = 0) {
+            Seed(seed);
+        }
+
+        void Seed(uint64_t seed) {
+            //Expand the seed with splitmix64 so that similar seeds give unrelated streams and the state is never 0
+            for (int i = 0; i < 4; i += 2) {
+                uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                z = z ^ (z >> 31);
+                state[i] = static_cast<uint32_t>(z);
+                state[i + 1] = static_cast<uint32_t>(z >> 32);
+            }
+        }
+
+        uint32_t Next() {
+            const uint32_t result = RotateLeft(state[0] + state[3], 7) + state[0];
+            const uint32_t t = state[1] << 9;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = RotateLeft(state[3], 11);
+
+            return result;
+        }
+
+        //Uses the high bits, they have the best quality, and covers the whole range 0-255
+        unsigned char NextByte() {
+            return static_cast<unsigned char>(Next() >> 24);
+        }
+
+        const std::array<uint32_t, 4> &GetState() const {
+            return state;
+        }
+
+        void SetState(const std::array<uint32_t, 4> &state) {
+            Xoshiro128::state = state;
+        }
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_RANDOM_H
@@ -0,0 +1,36 @@
+#include "RunAhead.h"
+#include <algorithm>
+
+namespace Emulator {
+
+    RunAhead::RunAhead(int frames) : frames(std::max(frames, 0)), ahead(0), pipeline(1, 1) {
+        frame.Clear();
+    }
+
+    const Framebuffer &RunAhead::Frame(const Chip8 &chip8, const FramePipeline &pipeline) {
+        if (frames == 0) return pipeline.GetFrame();
+
+        ahead.SetState(chip8.GetState());
+        ahead.SetKeyState(chip8.GetKeyState());
+        uint64_t cycles = pipeline.CyclesUntilFrame(frames);
+
+        //Without blending only the framebuffer at the last vblank counts, so idle loops and superinstructions apply
+        if (!pipeline.IsBlending()) {
+            ahead.Run(cycles);
+            frame = ahead.GetGfx();
+            return frame;
+        }
+
+        RunAhead::pipeline = pipeline;
+        for (uint64_t cycle = 0; cycle < cycles; cycle++) {
+            ahead.EmulateCycle();
+            RunAhead::pipeline.Cycle(ahead.GetGfx());
+        }
+        frame = RunAhead::pipeline.GetFrame();
+        return frame;
+    }
+
+    int RunAhead::GetFrames() const {
+        return frames;
+    }
+}
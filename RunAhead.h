@@ -0,0 +1,32 @@
+#ifndef CHIP8_EMULATOR_C_RUNAHEAD_H
+#define CHIP8_EMULATOR_C_RUNAHEAD_H
+
+#include "Chip8.h"
+#include "FramePipeline.h"
+#include "Framebuffer.h"
+
+namespace Emulator {
+
+    //Hides the frames a game takes to react to a key by presenting the machine as it will be a few frames from now
+    //with the keys held at the moment. Every frame the state is saved into a second machine, which runs ahead
+    //without rendering; the real machine never runs ahead, so restoring is just dropping the copy. The copy runs
+    //frames times the cycles of a frame, which is the CPU cost to weigh against the latency it saves.
+    class RunAhead {
+
+    private:
+        int frames;
+        Chip8 ahead;
+        FramePipeline pipeline; //Copy of the frontend pipeline when it blends
+        Framebuffer frame;
+
+    public:
+        explicit RunAhead(int frames);
+
+        //Call when pipeline released a frame for chip8, returns the frame to present instead of its own
+        const Framebuffer &Frame(const Chip8 &chip8, const FramePipeline &pipeline);
+
+        int GetFrames() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_RUNAHEAD_H
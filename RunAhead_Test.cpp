@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "RunAhead.h"
+
+namespace {
+    //Moves the font sprite of 0 one pixel to the right every 8 cycles, erasing it in between
+    const std::vector<uint8_t> MOVING = {0xA0, 0x00, 0xD0, 0x15, 0x62, 0x00, 0x72, 0x01, 0x32, 0x04, 0x12, 0x06,
+                                         0xD0, 0x15, 0x70, 0x01, 0x12, 0x02};
+
+    //Runs the frontend loop from state until the pipeline released frames more frames and returns the last one
+    Emulator::Framebuffer PresentedAfter(const Emulator::Chip8State &state, Emulator::FramePipeline pipeline,
+                                         int frames) {
+        Emulator::Chip8 chip8(0);
+        chip8.SetState(state);
+        for (int released = 0; released < frames;) {
+            chip8.EmulateCycle();
+            if (pipeline.Cycle(chip8.GetGfx())) released++;
+        }
+        return pipeline.GetFrame();
+    }
+}
+
+TEST_CASE("Run-ahead presents the frame the loop would present later") {
+    for (int blend : {0, 2}) {
+        for (int frames : {1, 2, 5}) {
+            Emulator::Chip8 chip8(1);
+            chip8.LoadRom(MOVING);
+            Emulator::FramePipeline pipeline(1000, 60, blend);
+            Emulator::RunAhead run_ahead(frames);
+
+            for (int frame = 0; frame < 20;) {
+                chip8.EmulateCycle();
+                if (!pipeline.Cycle(chip8.GetGfx())) continue;
+                frame++;
+
+                Emulator::Chip8State state = chip8.GetState();
+                const Emulator::Framebuffer &ahead = run_ahead.Frame(chip8, pipeline);
+                REQUIRE(ahead == PresentedAfter(state, pipeline, frames));
+
+                //The machine itself doesn't move
+                REQUIRE(memcmp(&chip8.GetState(), &state, sizeof(state)) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Run-ahead shows key presses earlier") {
+    //LD V0, 0; CLS; wait for a key, count V2 down from 20 and draw the digit. The delay stands for the game logic
+    const std::vector<uint8_t> rom = {0x60, 0x00, 0x00, 0xE0, 0xF1, 0x0A, 0x62, 0x14, 0x72, 0xFF, 0x32, 0x00,
+                                      0x12, 0x08, 0xF1, 0x29, 0xD0, 0x05, 0x12, 0x12};
+    Emulator::Chip8 chip8(1);
+    chip8.LoadRom(rom);
+    Emulator::FramePipeline pipeline(1000, 60);
+    Emulator::RunAhead none(0), two(2), five(5);
+
+    auto present = [&]() {
+        do chip8.EmulateCycle();
+        while (!pipeline.Cycle(chip8.GetGfx()));
+    };
+    auto lit = [](const Emulator::Framebuffer &frame) {
+        for (uint8_t byte : frame.pixels) {
+            if (byte != 0) return true;
+        }
+        return false;
+    };
+
+    present();
+    chip8.SetKeyPressed(7, true);
+    present();
+    REQUIRE_FALSE(lit(none.Frame(chip8, pipeline)));
+    REQUIRE_FALSE(lit(two.Frame(chip8, pipeline)));
+    REQUIRE(lit(five.Frame(chip8, pipeline)));
+    REQUIRE(&none.Frame(chip8, pipeline) == &pipeline.GetFrame());
+
+    //Two frames later two frames of run-ahead show it too
+    for (int i = 0; i < 2; i++) present();
+    REQUIRE_FALSE(lit(none.Frame(chip8, pipeline)));
+    REQUIRE(lit(two.Frame(chip8, pipeline)));
+    REQUIRE(two.Frame(chip8, pipeline) == five.Frame(chip8, pipeline));
+}
@@ -0,0 +1,254 @@
+#include "Scaler.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Emulator {
+
+    namespace {
+        //Scanlines keep 5/8 of the brightness
+        uint32_t Darken(uint32_t color) {
+            uint32_t r = ((color >> 16) & 0xFF) * 5 / 8;
+            uint32_t g = ((color >> 8) & 0xFF) * 5 / 8;
+            uint32_t b = (color & 0xFF) * 5 / 8;
+            return (color & 0xFF000000) | r << 16 | g << 8 | b;
+        }
+
+        //Overlay glyphs, 5 rows of 3 pixels with one octal digit per row
+        const char GLYPH_CHARACTERS[] = "0123456789.-:%/ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        const uint16_t GLYPHS[] = {
+                075557, 026227, 071747, 071317, 055711, 074717, 074757, 071111, 075757, 075717,
+                000002, 000700, 002020, 051245, 011244,
+                025755, 065656, 034443, 065556, 074647, 074644, 034553, 055755, 072227, 011152, 055655, 044447,
+                057755, 065555, 025552, 065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, 055255,
+                055222, 071247};
+
+        uint16_t Glyph(char character) {
+            if (character >= 'a' && character <= 'z') character = static_cast<char>(character - 'a' + 'A');
+            for (int i = 0; GLYPH_CHARACTERS[i] != 0; i++) {
+                if (GLYPH_CHARACTERS[i] == character) return GLYPHS[i];
+            }
+            return 0;
+        }
+    }
+
+    Scaler::Scaler(int scale, Palette palette) : scale(std::max(scale, 1)), palette(palette), scanlines(false),
+                                                 persistence(0) {
+        image.resize(GetWidth() * GetHeight());
+        colors.resize(Framebuffer::WIDTH * Framebuffer::HEIGHT);
+        BuildSpans();
+    }
+
+    void Scaler::BuildSpans() {
+        int span_length = 8 * scale;
+        spans.resize(256 * span_length);
+        scanline_spans.resize(256 * span_length);
+
+        for (int byte = 0; byte < 256; byte++) {
+            for (int bit = 0; bit < 8; bit++) {
+                uint32_t color = ((byte >> (7 - bit)) & 1) ? palette.on : palette.off;
+                std::fill_n(&spans[byte * span_length + bit * scale], scale, color);
+                std::fill_n(&scanline_spans[byte * span_length + bit * scale], scale, Darken(color));
+            }
+        }
+    }
+
+    void Scaler::SetPalette(Palette palette) {
+        Scaler::palette = palette;
+        BuildSpans();
+    }
+
+    void Scaler::SetScanlines(bool scanlines) {
+        Scaler::scanlines = scanlines;
+    }
+
+    void Scaler::SetPersistence(uint8_t persistence) {
+        Scaler::persistence = persistence;
+        phosphor.clear();
+    }
+
+    void Scaler::SetOverlay(const std::string &text) {
+        overlay = text;
+    }
+
+    void Scaler::ExpandRow(const uint8_t *row, const std::vector<uint32_t> &table, uint32_t *out) const {
+        int span_length = 8 * scale;
+        for (int i = 0; i < Framebuffer::BYTES_PER_ROW; i++) {
+            memcpy(out + i * span_length, &table[row[i] * span_length], span_length * sizeof(uint32_t));
+        }
+    }
+
+    void Scaler::BlendPhosphor() {
+        //colors = max(colors, phosphor * persistence / 256) per channel, the result is the next phosphor
+        size_t count = colors.size();
+        uint32_t *out = colors.data();
+        uint32_t *previous = phosphor.data();
+        size_t i = 0;
+
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i factor = _mm_set1_epi16(static_cast<short>(persistence << 8));
+
+        for (; i + 4 <= count; i += 4) {
+            __m128i fresh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(out + i));
+            __m128i old = _mm_loadu_si128(reinterpret_cast<const __m128i *>(previous + i));
+
+            //Unpacking with zero below puts every channel in the high byte of a 16 bit lane, so mulhi gives c*f/256
+            __m128i low = _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, old), factor);
+            __m128i high = _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, old), factor);
+            __m128i faded = _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8));
+
+            __m128i blended = _mm_max_epu8(fresh, faded);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), blended);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(previous + i), blended);
+        }
+#endif
+
+        for (; i < count; i++) {
+            uint32_t blended = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                uint32_t fresh = (out[i] >> shift) & 0xFF;
+                uint32_t faded = (((previous[i] >> shift) & 0xFF) * persistence) >> 8;
+                blended |= std::max(fresh, faded) << shift;
+            }
+            out[i] = previous[i] = blended;
+        }
+    }
+
+    void Scaler::ExpandColors(const uint32_t *colors, bool darken, uint32_t *out) const {
+        for (int x = 0; x < Framebuffer::WIDTH; x++) {
+            std::fill_n(out + x * scale, scale, darken ? Darken(colors[x]) : colors[x]);
+        }
+    }
+
+    const uint32_t *Scaler::Scale(const Framebuffer &framebuffer) {
+        int width = GetWidth();
+        int copies = scanlines && scale > 1 ? scale - 1 : scale;
+
+        //Persistence is blended once per emulated pixel, the blended colors are then expanded without the tables
+        if (persistence > 0) {
+            for (int y = 0; y < Framebuffer::HEIGHT; y++) {
+                for (int x = 0; x < Framebuffer::WIDTH; x++) {
+                    colors[y * Framebuffer::WIDTH + x] = framebuffer.GetPixel(x, y) ? palette.on : palette.off;
+                }
+            }
+            if (phosphor.empty()) phosphor = colors;
+            BlendPhosphor();
+        }
+
+        for (int y = 0; y < Framebuffer::HEIGHT; y++) {
+            uint32_t *first_line = &image[y * scale * width];
+            const uint32_t *row_colors = &colors[y * Framebuffer::WIDTH];
+
+            if (persistence > 0) ExpandColors(row_colors, false, first_line);
+            else ExpandRow(framebuffer.Row(y), spans, first_line);
+
+            for (int line = 1; line < copies; line++) {
+                memcpy(first_line + line * width, first_line, width * sizeof(uint32_t));
+            }
+
+            if (copies < scale) {
+                if (persistence > 0) ExpandColors(row_colors, true, first_line + copies * width);
+                else ExpandRow(framebuffer.Row(y), scanline_spans, first_line + copies * width);
+            }
+        }
+
+        if (!overlay.empty()) DrawOverlay();
+
+        return image.data();
+    }
+
+    void Scaler::DrawOverlay() {
+        //Glyphs grow with the scale so the text stays readable, every character cell has a pixel of spacing
+        int pixel = std::max(scale / 4, 1);
+        int width = GetWidth();
+        int height = GetHeight();
+
+        int columns = 0;
+        int lines = 1;
+        for (size_t i = 0, column = 0; i < overlay.size(); i++) {
+            if (overlay[i] == '\n') {
+                lines++;
+                column = 0;
+            } else {
+                columns = std::max(columns, static_cast<int>(++column));
+            }
+        }
+
+        //Solid background so the text stays readable over the picture
+        int box_width = std::min((columns * 4 + 1) * pixel, width);
+        int box_height = std::min((lines * 6 + 1) * pixel, height);
+        for (int y = 0; y < box_height; y++) std::fill_n(&image[y * width], box_width, palette.off);
+
+        int line = 0;
+        int column = 0;
+        for (char character : overlay) {
+            if (character == '\n') {
+                line++;
+                column = 0;
+                continue;
+            }
+
+            uint16_t glyph = Glyph(character);
+            int left = (column * 4 + 1) * pixel;
+            int top = (line * 6 + 1) * pixel;
+            column++;
+
+            for (int row = 0; row < 5; row++) {
+                for (int bit = 0; bit < 3; bit++) {
+                    if (!((glyph >> ((4 - row) * 3 + 2 - bit)) & 1)) continue;
+
+                    int x = left + bit * pixel;
+                    int y = top + row * pixel;
+                    if (x + pixel > width || y + pixel > height) continue;
+                    for (int line_y = y; line_y < y + pixel; line_y++) {
+                        std::fill_n(&image[line_y * width + x], pixel, palette.on);
+                    }
+                }
+            }
+        }
+    }
+
+    int Scaler::GetWidth() const {
+        return Framebuffer::WIDTH * scale;
+    }
+
+    int Scaler::GetHeight() const {
+        return Framebuffer::HEIGHT * scale;
+    }
+
+    int Scaler::GetPitch() const {
+        return GetWidth() * sizeof(uint32_t);
+    }
+
+    bool ParsePalette(const std::string &text, Palette *palette) {
+        if (text == "white") *palette = PALETTE_WHITE;
+        else if (text == "green") *palette = PALETTE_GREEN;
+        else if (text == "amber") *palette = PALETTE_AMBER;
+        else {
+            //1 to 6 hex digits each, strtoul alone would also take signs, spaces and 0x
+            auto parse_color = [](const std::string &digits, uint32_t *color) {
+                if (digits.empty() || digits.size() > 6) return false;
+                for (char digit : digits) {
+                    if (!std::isxdigit(static_cast<unsigned char>(digit))) return false;
+                }
+                *color = 0xFF000000 | static_cast<uint32_t>(std::strtoul(digits.c_str(), nullptr, 16));
+                return true;
+            };
+
+            size_t separator = text.find(':');
+            uint32_t on, off;
+            if (separator == std::string::npos || !parse_color(text.substr(0, separator), &on) ||
+                !parse_color(text.substr(separator + 1), &off)) {
+                return false;
+            }
+            *palette = {off, on};
+        }
+        return true;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef CHIP8_EMULATOR_C_SCALER_H
+#define CHIP8_EMULATOR_C_SCALER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Framebuffer.h"
+
+namespace Emulator {
+
+    //ARGB8888 colors for unlit and lit pixels
+    struct Palette {
+        uint32_t off;
+        uint32_t on;
+    };
+
+    const Palette PALETTE_WHITE = {0xFF000000, 0xFFFFFFFF};
+    const Palette PALETTE_GREEN = {0xFF001000, 0xFF33FF66};
+    const Palette PALETTE_AMBER = {0xFF100800, 0xFFFFB000};
+
+    //"white", "green", "amber" or two RGB hex colors for lit and unlit pixels like "FFFFFF:000000". False for
+    //anything else, palette is left alone then
+    bool ParsePalette(const std::string &text, Palette *palette);
+
+    //Software upscaler from the packed framebuffer to an ARGB8888 image of WIDTH*scale x HEIGHT*scale.
+    //Every framebuffer byte is expanded through a 256 entry table of ready scaled spans, and each finished row is
+    //copied scale times. Optional scanlines darken the last line of every scaled row and optional phosphor
+    //persistence keeps a fading copy of earlier frames to hide the flicker of XOR drawn sprites. The fade is
+    //blended per emulated pixel before scaling, so its cost doesn't grow with the scale.
+    class Scaler {
+
+    private:
+        int scale;
+        Palette palette;
+        bool scanlines;
+        uint8_t persistence; //Fraction of the previous frame that is kept, in 1/256, 0 turns it off
+
+        std::vector<uint32_t> spans; //256 spans of 8*scale pixels
+        std::vector<uint32_t> scanline_spans;
+        std::vector<uint32_t> image;
+        std::vector<uint32_t> colors; //One color per emulated pixel, only used with persistence
+        std::vector<uint32_t> phosphor;
+        std::string overlay;
+
+        void BuildSpans();
+        void ExpandRow(const uint8_t *row, const std::vector<uint32_t> &table, uint32_t *out) const;
+        void ExpandColors(const uint32_t *colors, bool darken, uint32_t *out) const;
+        void BlendPhosphor();
+        void DrawOverlay();
+
+    public:
+        explicit Scaler(int scale, Palette palette = PALETTE_WHITE);
+
+        void SetPalette(Palette palette);
+        void SetScanlines(bool scanlines);
+        void SetPersistence(uint8_t persistence);
+        //Text drawn into the top left corner of every scaled image with a 3x5 pixel font, lines are separated by
+        //'\n'. Digits, upper case letters and . - : % / are supported, anything else is blank. Empty turns it off
+        void SetOverlay(const std::string &text);
+
+        //Returns the scaled image, valid until the next call
+        const uint32_t *Scale(const Framebuffer &framebuffer);
+
+        int GetWidth() const;
+        int GetHeight() const;
+        int GetPitch() const; //In bytes
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_SCALER_H
@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+#include "Scaler.h"
+
+namespace {
+    Emulator::Framebuffer FramebufferWithRow(int y, uint8_t first_byte) {
+        Emulator::Framebuffer framebuffer;
+        framebuffer.Clear();
+        framebuffer.Row(y)[0] = first_byte;
+        return framebuffer;
+    }
+}
+
+TEST_CASE("Scaler expands every pixel to a square of palette colors") {
+    Emulator::Scaler scaler(3, Emulator::PALETTE_GREEN);
+    REQUIRE(scaler.GetWidth() == 192);
+    REQUIRE(scaler.GetHeight() == 96);
+    REQUIRE(scaler.GetPitch() == 192 * 4);
+
+    //Lights pixels 0 and 2 of row 1
+    const uint32_t *image = scaler.Scale(FramebufferWithRow(1, 0xA0));
+
+    for (int y = 0; y < scaler.GetHeight(); y++) {
+        for (int x = 0; x < scaler.GetWidth(); x++) {
+            bool lit = y / 3 == 1 && (x / 3 == 0 || x / 3 == 2);
+            REQUIRE(image[y * scaler.GetWidth() + x] == (lit ? Emulator::PALETTE_GREEN.on : Emulator::PALETTE_GREEN.off));
+        }
+    }
+}
+
+TEST_CASE("Scanlines darken the last line of every scaled row") {
+    Emulator::Scaler scaler(4);
+    scaler.SetScanlines(true);
+    const uint32_t *image = scaler.Scale(FramebufferWithRow(0, 0x80));
+
+    REQUIRE(image[0] == 0xFFFFFFFF);
+    REQUIRE(image[2 * scaler.GetWidth()] == 0xFFFFFFFF);
+    REQUIRE(image[3 * scaler.GetWidth()] == 0xFF9F9F9F);
+    REQUIRE(image[3 * scaler.GetWidth() + 4] == 0xFF000000);
+}
+
+TEST_CASE("Phosphor persistence fades pixels that were turned off") {
+    Emulator::Scaler scaler(2);
+    scaler.SetPersistence(128);
+
+    REQUIRE(scaler.Scale(FramebufferWithRow(0, 0x80))[0] == 0xFFFFFFFF);
+
+    //Every channel keeps half its value per frame, alpha stays opaque
+    Emulator::Framebuffer blank = FramebufferWithRow(0, 0x00);
+    REQUIRE(scaler.Scale(blank)[0] == 0xFF7F7F7F);
+    REQUIRE(scaler.Scale(blank)[1] == 0xFF3F3F3F);
+    REQUIRE(scaler.Scale(blank)[0] == 0xFF1F1F1F);
+
+    //Pixels at the end of the image go through the same blend
+    Emulator::Scaler tail(1);
+    tail.SetPersistence(128);
+    Emulator::Framebuffer corner;
+    corner.Clear();
+    corner.Row(31)[7] = 0x01;
+    REQUIRE(tail.Scale(corner)[64 * 32 - 1] == 0xFFFFFFFF);
+    corner.Clear();
+    REQUIRE(tail.Scale(corner)[64 * 32 - 1] == 0xFF7F7F7F);
+}
+
+TEST_CASE("The overlay draws text over the top left corner") {
+    Emulator::Scaler scaler(4);
+    Emulator::Framebuffer framebuffer;
+    framebuffer.Clear();
+    const uint32_t on = Emulator::PALETTE_WHITE.on;
+    const uint32_t off = Emulator::PALETTE_WHITE.off;
+
+    //At scale 4 every glyph pixel is a single image pixel, "1" has its stem in the middle column
+    scaler.SetOverlay("1");
+    const uint32_t *image = scaler.Scale(framebuffer);
+    REQUIRE(image[1 * scaler.GetWidth() + 2] == on);
+    REQUIRE(image[1 * scaler.GetWidth() + 1] == off);
+    REQUIRE(image[5 * scaler.GetWidth() + 1] == on);
+
+    //The background box hides the picture below the text, the rest is untouched
+    for (uint8_t &byte : framebuffer.pixels) byte = 0xFF;
+    image = scaler.Scale(framebuffer);
+    REQUIRE(image[0] == off);
+    REQUIRE(image[10 * scaler.GetWidth() + 10] == on);
+
+    scaler.SetOverlay("");
+    image = scaler.Scale(framebuffer);
+    REQUIRE(image[0] == on);
+}
+
+TEST_CASE("Palettes parse from names and hex colors and reject anything else") {
+    Emulator::Palette palette = Emulator::PALETTE_WHITE;
+    REQUIRE(Emulator::ParsePalette("amber", &palette));
+    REQUIRE(palette.on == Emulator::PALETTE_AMBER.on);
+    REQUIRE(Emulator::ParsePalette("FF8000:10", &palette));
+    REQUIRE(palette.on == 0xFFFF8000);
+    REQUIRE(palette.off == 0xFF000010);
+
+    for (const char *text : {"xyz:abc", "gren", "FFFFFF", ":000000", "FFFFFF:", "1234567:000000", "0x10:0", "-1:0",
+                             " 1:0"}) {
+        REQUIRE_FALSE(Emulator::ParsePalette(text, &palette));
+    }
+    REQUIRE(palette.on == 0xFFFF8000);
+}
@@ -0,0 +1,151 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace Emulator {
+
+    void WaitQueue::Push(Waiter *waiter) {
+        waiter->next = nullptr;
+        if (tail != nullptr) tail->next = waiter;
+        else head = waiter;
+        tail = waiter;
+    }
+
+    Waiter *WaitQueue::Pop() {
+        Waiter *waiter = head;
+        if (waiter != nullptr) {
+            head = waiter->next;
+            if (head == nullptr) tail = nullptr;
+        }
+        return waiter;
+    }
+
+    void WaitQueue::Splice(WaitQueue &other) {
+        if (other.head == nullptr) return;
+        if (tail != nullptr) tail->next = other.head;
+        else head = other.head;
+        tail = other.tail;
+        other.head = other.tail = nullptr;
+    }
+
+    bool WaitQueue::IsEmpty() const {
+        return head == nullptr;
+    }
+
+    Task Task::promise_type::get_return_object() {
+        return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    void Task::promise_type::unhandled_exception() {
+        std::cerr << "Unhandled exception in a scheduler task" << std::endl;
+        std::abort();
+    }
+
+    Task::Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    Task::Task(Task &&other) noexcept : handle(other.handle) {
+        other.handle = nullptr;
+    }
+
+    Task::~Task() {
+        //Only tasks that were never spawned are still owned here
+        if (handle) handle.destroy();
+    }
+
+    Scheduler::Scheduler() : ticks(0) {}
+
+    Scheduler::~Scheduler() {
+        for (auto &task : tasks) task.destroy();
+    }
+
+    void Scheduler::Spawn(Task task) {
+        std::coroutine_handle<Task::promise_type> handle = task.handle;
+        task.handle = nullptr;
+
+        handle.promise().index = tasks.size();
+        handle.promise().start.handle = handle;
+        tasks.push_back(handle);
+        ready.Push(&handle.promise().start);
+    }
+
+    void Scheduler::Tick() {
+        ticks++;
+        ready.Splice(next_tick);
+        RunReady();
+    }
+
+    void Scheduler::RunReady() {
+        while (Waiter *waiter = ready.Pop()) {
+            //The waiter is gone once the task runs, keep the handle
+            std::coroutine_handle<> handle = waiter->handle;
+            handle.resume();
+            if (handle.done()) Finish(handle);
+        }
+    }
+
+    void Scheduler::Finish(std::coroutine_handle<> handle) {
+        auto task = std::coroutine_handle<Task::promise_type>::from_address(handle.address());
+        size_t index = task.promise().index;
+
+        tasks[index] = tasks.back();
+        tasks[index].promise().index = index;
+        tasks.pop_back();
+        task.destroy();
+    }
+
+    QueueAwaiter Scheduler::NextTick() {
+        return QueueAwaiter(&next_tick);
+    }
+
+    QueueAwaiter Scheduler::Yield() {
+        return QueueAwaiter(&ready);
+    }
+
+    size_t Scheduler::GetTaskCount() const {
+        return tasks.size();
+    }
+
+    uint64_t Scheduler::GetTicks() const {
+        return ticks;
+    }
+
+    Event::Event(Scheduler &scheduler) : scheduler(scheduler) {}
+
+    QueueAwaiter Event::Wait() {
+        return QueueAwaiter(&waiting);
+    }
+
+    void Event::Notify() {
+        scheduler.ready.Splice(waiting);
+    }
+
+    Task RunChip8Task(Scheduler &scheduler, Chip8 &chip8, Event &key_event, Chip8TaskOptions options) {
+        int ticks_per_second = std::max(options.ticks_per_second, 1);
+        uint64_t tick = 0;
+
+        while (true) {
+            co_await scheduler.NextTick();
+
+            //Nothing can change until a key is pressed, don't wake up for every tick meanwhile. The tick after the
+            //key event runs normally again. Only the delay timer counts down, the sound timer is never decremented
+            if (chip8.IsWaitingForKey() && chip8.GetKeyState() == 0 && chip8.GetDelayTimer() == 0) {
+                co_await key_event.Wait();
+                continue;
+            }
+
+            uint64_t cycles = (tick + 1) * options.cycles_per_second / ticks_per_second -
+                              tick * options.cycles_per_second / ticks_per_second;
+            tick++;
+
+            while (cycles > 0) {
+                uint64_t slice = options.slice_cycles > 0 ? std::min<uint64_t>(cycles, options.slice_cycles) : cycles;
+                chip8.Run(slice);
+                cycles -= slice;
+                if (cycles > 0) co_await scheduler.Yield();
+            }
+
+            if (options.on_frame) options.on_frame(chip8);
+        }
+    }
+}
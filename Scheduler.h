@@ -0,0 +1,146 @@
+#ifndef CHIP8_EMULATOR_C_SCHEDULER_H
+#define CHIP8_EMULATOR_C_SCHEDULER_H
+
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    class Scheduler;
+
+    //Link of a suspended task in one of the scheduler or event queues. It lives in the awaiter, which is part of the
+    //coroutine frame while the task is suspended, so suspending never allocates
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        Waiter *next = nullptr;
+    };
+
+    class WaitQueue {
+
+    private:
+        Waiter *head = nullptr;
+        Waiter *tail = nullptr;
+
+    public:
+        void Push(Waiter *waiter);
+        Waiter *Pop();
+        //Moves all waiters of other to the end of this queue
+        void Splice(WaitQueue &other);
+        bool IsEmpty() const;
+    };
+
+    //Coroutine type of scheduler tasks. A task starts suspended and runs once it is spawned, the scheduler owns it from
+    //then on and destroys it when it returns or when the scheduler is destroyed
+    class Task {
+
+    public:
+        struct promise_type {
+            Waiter start;
+            size_t index = 0; //Position in the task list of the scheduler
+
+            Task get_return_object();
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception();
+        };
+
+        Task(Task &&other) noexcept;
+        ~Task();
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+    private:
+        friend class Scheduler;
+        std::coroutine_handle<promise_type> handle;
+
+        explicit Task(std::coroutine_handle<promise_type> handle);
+    };
+
+    //Awaiting it suspends the task and queues it on queue
+    class QueueAwaiter : private Waiter {
+
+    private:
+        WaitQueue *queue;
+
+    public:
+        explicit QueueAwaiter(WaitQueue *queue) : queue(queue) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            Waiter::handle = handle;
+            queue->Push(this);
+        }
+        void await_resume() const noexcept {}
+    };
+
+    //Single threaded executor of cooperative tasks, each one typically an emulator. The host calls Tick() at the
+    //display rate and tasks await the next tick, an Event or just the end of the queue with Yield(). Suspending and
+    //resuming is a couple of pointer writes and a jump, for many cores run one scheduler per thread.
+    class Scheduler {
+
+    private:
+        friend class Event;
+
+        WaitQueue ready;
+        WaitQueue next_tick;
+        std::vector<std::coroutine_handle<Task::promise_type>> tasks;
+        uint64_t ticks;
+
+        void Finish(std::coroutine_handle<> handle);
+
+    public:
+        Scheduler();
+        ~Scheduler();
+        Scheduler(const Scheduler &) = delete;
+        Scheduler &operator=(const Scheduler &) = delete;
+
+        //The task first runs in the next RunReady() or Tick()
+        void Spawn(Task task);
+
+        //Resumes every task waiting for the next tick, then runs until all tasks wait again
+        void Tick();
+        //Runs ready tasks until none is left
+        void RunReady();
+
+        QueueAwaiter NextTick();
+        //Lets the other ready tasks run first
+        QueueAwaiter Yield();
+
+        size_t GetTaskCount() const;
+        uint64_t GetTicks() const;
+    };
+
+    //Tasks wait on it until Notify() makes them ready again, e.g. for key presses. Only use it on the thread of its
+    //scheduler
+    class Event {
+
+    private:
+        Scheduler &scheduler;
+        WaitQueue waiting;
+
+    public:
+        explicit Event(Scheduler &scheduler);
+
+        QueueAwaiter Wait();
+        //Every waiting task runs in the next RunReady() or Tick()
+        void Notify();
+    };
+
+    struct Chip8TaskOptions {
+        int cycles_per_second = 1000;
+        int ticks_per_second = 60;
+        int slice_cycles = 0; //Yield after this many cycles within a tick so other tasks get to run, 0 never yields
+        std::function<void(const Chip8 &)> on_frame; //Called after every tick's cycles
+    };
+
+    //Runs chip8 at options.cycles_per_second, one tick worth of cycles per scheduler tick. While Fx0A waits with the
+    //delay timer stopped the task sleeps on key_event instead of ticking, so notify it whenever the keys change.
+    //The scheduler, the Chip8 and the event must outlive the task.
+    Task RunChip8Task(Scheduler &scheduler, Chip8 &chip8, Event &key_event, Chip8TaskOptions options);
+}
+
+#endif //CHIP8_EMULATOR_C_SCHEDULER_H
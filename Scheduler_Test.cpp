@@ -0,0 +1,116 @@
+#include <catch2/catch.hpp>
+#include <string>
+#include "Scheduler.h"
+
+namespace {
+    Emulator::Task Record(Emulator::Scheduler &scheduler, std::string *log, char name, int ticks) {
+        for (int i = 0; i < ticks; i++) {
+            log->push_back(name);
+            co_await scheduler.NextTick();
+        }
+    }
+
+    Emulator::Task Interleave(Emulator::Scheduler &scheduler, std::string *log, char name) {
+        for (int i = 0; i < 3; i++) {
+            log->push_back(name);
+            co_await scheduler.Yield();
+        }
+    }
+
+    Emulator::Task WaitFor(Emulator::Event &event, std::string *log, char name) {
+        co_await event.Wait();
+        log->push_back(name);
+    }
+}
+
+TEST_CASE("Tasks run in spawn order and resume once per tick") {
+    Emulator::Scheduler scheduler;
+    std::string log;
+    scheduler.Spawn(Record(scheduler, &log, 'a', 2));
+    scheduler.Spawn(Record(scheduler, &log, 'b', 3));
+    REQUIRE(log.empty());
+
+    scheduler.RunReady();
+    REQUIRE(log == "ab");
+    scheduler.RunReady();
+    REQUIRE(log == "ab");
+
+    scheduler.Tick();
+    REQUIRE(log == "abab");
+    scheduler.Tick();
+    REQUIRE(log == "ababb");
+    REQUIRE(scheduler.GetTaskCount() == 1);
+    scheduler.Tick();
+    REQUIRE(scheduler.GetTaskCount() == 0);
+    REQUIRE(scheduler.GetTicks() == 3);
+}
+
+TEST_CASE("Yield lets the other ready tasks run first") {
+    Emulator::Scheduler scheduler;
+    std::string log;
+    scheduler.Spawn(Interleave(scheduler, &log, 'a'));
+    scheduler.Spawn(Interleave(scheduler, &log, 'b'));
+
+    scheduler.RunReady();
+    REQUIRE(log == "ababab");
+    REQUIRE(scheduler.GetTaskCount() == 0);
+}
+
+TEST_CASE("Events wake their waiting tasks") {
+    Emulator::Scheduler scheduler;
+    Emulator::Event event(scheduler);
+    std::string log;
+    scheduler.Spawn(WaitFor(event, &log, 'a'));
+    scheduler.Spawn(WaitFor(event, &log, 'b'));
+
+    scheduler.Tick();
+    scheduler.Tick();
+    REQUIRE(log.empty());
+
+    event.Notify();
+    scheduler.RunReady();
+    REQUIRE(log == "ab");
+
+    //Unfinished tasks are destroyed with the scheduler
+    scheduler.Spawn(WaitFor(event, &log, 'c'));
+    scheduler.RunReady();
+    REQUIRE(scheduler.GetTaskCount() == 1);
+}
+
+TEST_CASE("Chip8 tasks run a tick of cycles and sleep in Fx0A until a key event") {
+    Emulator::Scheduler scheduler;
+    Emulator::Event keys(scheduler);
+    Emulator::Chip8 chip8(1);
+    //ADD V0, 1 ten times, LD V1, K, then ADD V2, 1 / JP back
+    const uint8_t rom[] = {0x70, 0x01, 0x70, 0x01, 0x70, 0x01, 0x70, 0x01, 0x70, 0x01, 0x70, 0x01, 0x70, 0x01,
+                           0x70, 0x01, 0x70, 0x01, 0x70, 0x01, 0xF1, 0x0A, 0x72, 0x01, 0x12, 0x16};
+    chip8.LoadRom(rom);
+    chip8.SetSoundTimer(10); //Never counts down, it mustn't keep the task awake
+
+    int frames = 0;
+    Emulator::Chip8TaskOptions options;
+    options.cycles_per_second = 600; //10 cycles per tick
+    options.slice_cycles = 4;
+    options.on_frame = [&frames](const Emulator::Chip8 &) { frames++; };
+    scheduler.Spawn(Emulator::RunChip8Task(scheduler, chip8, keys, options));
+
+    scheduler.RunReady();
+    scheduler.Tick();
+    REQUIRE(chip8.GetCpuRegister(0) == 10);
+    REQUIRE(frames == 1);
+
+    //Fx0A stops the machine and the task doesn't run on ticks anymore
+    for (int i = 0; i < 5; i++) scheduler.Tick();
+    REQUIRE(chip8.IsWaitingForKey());
+    REQUIRE(frames == 2);
+
+    chip8.SetKeyPressed(7, true);
+    keys.Notify();
+    scheduler.RunReady();
+    REQUIRE(frames == 2);
+
+    scheduler.Tick();
+    REQUIRE(frames == 3);
+    REQUIRE(chip8.GetCpuRegister(1) == 7);
+    REQUIRE(chip8.GetCpuRegister(2) == 5);
+}
@@ -0,0 +1,113 @@
+#include "SdlVideoBackend.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace Emulator {
+
+    namespace {
+        // Keypad keymap
+        const uint8_t keymap[16] = {SDLK_x, SDLK_1, SDLK_2, SDLK_3, SDLK_q, SDLK_w, SDLK_e, SDLK_a, SDLK_s, SDLK_d,
+                                    SDLK_y, SDLK_c,
+                                    SDLK_4, SDLK_r, SDLK_f, SDLK_v,
+        };
+    }
+
+    SdlVideoBackend::SdlVideoBackend(const VideoOptions &options) : scaler(options.scale, options.palette),
+                                                                    window(nullptr), renderer(nullptr),
+                                                                    display_texture(nullptr), turbo_held(false) {
+        scaler.SetScanlines(options.scanlines);
+        scaler.SetPersistence(options.persistence);
+
+        std::fill(std::begin(key_lookup), std::end(key_lookup), -1);
+        for (int i = 0; i < 16; ++i) {
+            key_lookup[keymap[i]] = i;
+        }
+    }
+
+    SdlVideoBackend::~SdlVideoBackend() {
+        if (display_texture != nullptr) SDL_DestroyTexture(display_texture);
+        if (renderer != nullptr) SDL_DestroyRenderer(renderer);
+        if (window != nullptr) {
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+        }
+    }
+
+    bool SdlVideoBackend::Init() {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+            return false;
+        }
+
+        window = SDL_CreateWindow("Chip8", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                  scaler.GetWidth(), scaler.GetHeight(), SDL_WINDOW_SHOWN);
+        if (window == nullptr) {
+            printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
+            return false;
+        }
+
+        renderer = SDL_CreateRenderer(window, -1, 0);
+        display_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                            scaler.GetWidth(), scaler.GetHeight());
+
+        return true;
+    }
+
+    void SdlVideoBackend::Present(const Framebuffer &framebuffer) {
+        SDL_UpdateTexture(display_texture, nullptr, scaler.Scale(framebuffer), scaler.GetPitch());
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, display_texture, nullptr, nullptr);
+        SDL_RenderPresent(renderer);
+    }
+
+    void SdlVideoBackend::SetOverlay(const std::string &text) {
+        scaler.SetOverlay(text);
+    }
+
+    void SdlVideoBackend::SetTitle(const std::string &title) {
+        SDL_SetWindowTitle(window, title.c_str());
+    }
+
+    bool SdlVideoBackend::HandleEvent(const SDL_Event &e, Chip8 &chip8) {
+        //Exit if quit event is triggered
+        if (e.type == SDL_QUIT) {
+            return true;
+        }
+
+        if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+            SDL_Keycode sym = e.key.keysym.sym;
+            if (sym >= 0 && sym < 256 && key_lookup[sym] >= 0) {
+                chip8.SetKeyPressed(key_lookup[sym], e.type == SDL_KEYDOWN);
+            }
+            if (sym == SDLK_TAB) turbo_held = e.type == SDL_KEYDOWN;
+        }
+
+        return false;
+    }
+
+    bool SdlVideoBackend::PollEvents(Chip8 &chip8) {
+        SDL_Event e;
+        bool quit = false;
+
+        //Handle events on queue
+        while (SDL_PollEvent(&e) != 0) {
+            quit = HandleEvent(e, chip8) || quit;
+        }
+
+        return quit;
+    }
+
+    bool SdlVideoBackend::WaitEvents(Chip8 &chip8) {
+        SDL_Event e;
+        bool quit = SDL_WaitEvent(&e) && HandleEvent(e, chip8);
+        return PollEvents(chip8) || quit;
+    }
+
+    bool SdlVideoBackend::IsInteractive() const {
+        return true;
+    }
+
+    bool SdlVideoBackend::IsTurboHeld() const {
+        return turbo_held;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef CHIP8_EMULATOR_C_SDLVIDEOBACKEND_H
+#define CHIP8_EMULATOR_C_SDLVIDEOBACKEND_H
+
+#include <cstdint>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "VideoBackend.h"
+
+namespace Emulator {
+
+    //Window with keyboard input, frames are scaled on the CPU and uploaded to a streaming texture of the window size
+    class SdlVideoBackend : public VideoBackend {
+
+    private:
+        Scaler scaler;
+
+        SDL_Window *window;
+        SDL_Renderer *renderer;
+        SDL_Texture *display_texture;
+
+        int8_t key_lookup[256]; //Reverse of the keymap indexed by SDL keycode, -1 for keys that aren't mapped
+        bool turbo_held; //Tab fast forwards
+
+        bool HandleEvent(const SDL_Event &e, Chip8 &chip8);
+
+    public:
+        explicit SdlVideoBackend(const VideoOptions &options);
+        ~SdlVideoBackend() override;
+
+        bool Init() override;
+        void Present(const Framebuffer &framebuffer) override;
+        void SetOverlay(const std::string &text) override;
+        void SetTitle(const std::string &title) override;
+        bool PollEvents(Chip8 &chip8) override;
+        bool WaitEvents(Chip8 &chip8) override;
+        bool IsInteractive() const override;
+        bool IsTurboHeld() const override;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_SDLVIDEOBACKEND_H
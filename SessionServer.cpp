@@ -0,0 +1,303 @@
+#include "SessionServer.h"
+#include "FrameDelta.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Emulator {
+
+    namespace {
+        //Sessions whose client doesn't read stop getting frames until this much has drained
+        const size_t MAX_PENDING_OUTPUT = 64 * 1024;
+
+        //Scratch buffer for encoding frames, one per worker
+        thread_local std::vector<uint8_t> delta;
+
+        void PutLittleEndian(std::string *out, uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; i++) out->push_back(static_cast<char>(value >> (8 * i)));
+        }
+
+        uint64_t GetLittleEndian(const std::string &in, size_t position, int bytes) {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; i++) value |= uint64_t(static_cast<uint8_t>(in[position + i])) << (8 * i);
+            return value;
+        }
+
+        uint64_t ThreadCpuNanoseconds() {
+            timespec time = {};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+            return uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+        }
+    }
+
+    SessionServer::SessionServer(int worker_count, int cycles_per_second) :
+            cycles_per_second(cycles_per_second), running(true), next_session(0), listener(-1) {
+        for (int i = 0; i < std::max(worker_count, 1); i++) {
+            workers.emplace_back(new Worker());
+            Worker &worker = *workers.back();
+            worker.wheel.resize(WHEEL_SLOTS);
+            worker.epoll = epoll_create1(0);
+            worker.cpu_nanoseconds = 0;
+        }
+        for (auto &worker : workers) {
+            Worker *target = worker.get();
+            worker->thread = std::thread([this, target]() { RunWorker(*target); });
+        }
+    }
+
+    SessionServer::~SessionServer() {
+        Stop();
+        for (auto &worker : workers) {
+            worker->thread.join();
+            for (auto &session : worker->pending) close(session->socket);
+            for (auto &slot : worker->wheel) {
+                for (auto &session : slot) {
+                    if (!session->closed) close(session->socket);
+                }
+            }
+            close(worker->epoll);
+        }
+    }
+
+    int SessionServer::AddClient(int socket) {
+        std::unique_ptr<Session> session(new Session());
+        session->id = next_session++;
+        session->socket = socket;
+        session->closed = false;
+        session->sent.Clear();
+        session->stats = {session->id, 0, 0, 0};
+
+        int id = session->id;
+        Worker &worker = *workers[id % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.pending.push_back(std::move(session));
+        return id;
+    }
+
+    void SessionServer::RunWorker(Worker &worker) {
+        const auto slot_period = std::chrono::nanoseconds(1000000000 / FRAMES_PER_SECOND / WHEEL_SLOTS);
+        auto next_slot = std::chrono::steady_clock::now();
+        int current_slot = 0;
+        epoll_event events[64];
+
+        while (running) {
+            //Rounded up, so the worker sleeps instead of spinning on the sub millisecond remainder
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                    next_slot - std::chrono::steady_clock::now()).count();
+            int timeout = static_cast<int>(std::max<int64_t>((wait + 999) / 1000, 0));
+            int ready = epoll_wait(worker.epoll, events, 64, timeout);
+
+            std::lock_guard<std::mutex> lock(worker.mutex);
+
+            //New sessions are spread over the slots by id
+            for (auto &session : worker.pending) {
+                epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.ptr = session.get();
+                epoll_ctl(worker.epoll, EPOLL_CTL_ADD, session->socket, &event);
+                worker.wheel[session->id % WHEEL_SLOTS].push_back(std::move(session));
+            }
+            worker.pending.clear();
+
+            for (int i = 0; i < ready; i++) {
+                Session &session = *static_cast<Session *>(events[i].data.ptr);
+                if (!session.closed) ReadInput(worker, session);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_slot) {
+                RunSlot(worker.wheel[current_slot]);
+                current_slot = (current_slot + 1) % WHEEL_SLOTS;
+                next_slot += slot_period;
+
+                //Don't try to catch up on more than a frame after a stall
+                if (now - next_slot > slot_period * WHEEL_SLOTS) next_slot = now;
+            }
+
+            worker.cpu_nanoseconds = ThreadCpuNanoseconds();
+        }
+    }
+
+    void SessionServer::RunSlot(std::vector<std::unique_ptr<Session>> &slot) {
+        for (size_t i = 0; i < slot.size();) {
+            Session &session = *slot[i];
+
+            //Closed sessions are only deleted here, so nothing else keeps pointers to them
+            if (session.closed) {
+                slot[i] = std::move(slot.back());
+                slot.pop_back();
+                continue;
+            }
+            i++;
+
+            if (!session.chip8) continue;
+
+            //Thread CPU time like the worker total, so a worker that gets preempted doesn't bill the session for it
+            uint64_t start = ThreadCpuNanoseconds();
+
+            uint64_t frame = session.stats.frames;
+            uint64_t cycles = (frame + 1) * cycles_per_second / FRAMES_PER_SECOND -
+                              frame * cycles_per_second / FRAMES_PER_SECOND;
+            for (uint64_t cycle = 0; cycle < cycles; cycle++) session.chip8->EmulateCycle();
+
+            session.stats.cycles += cycles;
+            session.stats.frames++;
+            SendFrame(session);
+            Flush(session);
+
+            session.stats.cpu_nanoseconds += ThreadCpuNanoseconds() - start;
+        }
+    }
+
+    void SessionServer::ReadInput(Worker &worker, Session &session) {
+        char buffer[4096];
+        ssize_t length = recv(session.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+        if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            Close(worker, session);
+            return;
+        }
+        if (length < 0) return;
+
+        session.input.append(buffer, length);
+        if (!HandleMessages(session)) Close(worker, session);
+    }
+
+    bool SessionServer::HandleMessages(Session &session) {
+        size_t position = 0;
+        std::string &in = session.input;
+
+        while (position < in.size()) {
+            size_t available = in.size() - position;
+            char type = in[position];
+
+            if (type == 'K') {
+                if (available < 3) break;
+                if (session.chip8) session.chip8->SetKeyState(GetLittleEndian(in, position + 1, 2));
+                position += 3;
+            } else if (type == 'L') {
+                if (available < 3) break;
+                size_t length = GetLittleEndian(in, position + 1, 2);
+                if (length > 4096 - 0x200) return false;
+                if (available < 3 + length) break;
+
+                //Loading again swaps the program of the running session
+                if (!session.chip8) session.chip8.reset(new Chip8());
+                session.chip8->LoadRom(std::span<const uint8_t>(
+                        reinterpret_cast<const uint8_t *>(in.data()) + position + 3, length));
+                position += 3 + length;
+            } else if (type == 'S') {
+                session.output.push_back('S');
+                PutLittleEndian(&session.output, session.stats.cpu_nanoseconds, 8);
+                PutLittleEndian(&session.output, session.stats.cycles, 8);
+                PutLittleEndian(&session.output, session.stats.frames, 8);
+                position += 1;
+            } else {
+                return false;
+            }
+        }
+
+        in.erase(0, position);
+        Flush(session);
+        return true;
+    }
+
+    void SessionServer::SendFrame(Session &session) {
+        //Skipping a frame is fine, the next delta is still against what the client has
+        if (session.output.size() > MAX_PENDING_OUTPUT) return;
+
+        const Framebuffer &gfx = session.chip8->GetGfx();
+        if (gfx == session.sent) return;
+
+        delta.clear();
+        EncodeFrameDelta(session.sent, gfx, &delta);
+
+        session.output.push_back('F');
+        PutLittleEndian(&session.output, delta.size(), 2);
+        session.output.append(delta.begin(), delta.end());
+        session.sent = gfx;
+    }
+
+    void SessionServer::Flush(Session &session) {
+        if (session.output.empty()) return;
+
+        ssize_t sent = send(session.socket, session.output.data(), session.output.size(),
+                            MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent > 0) session.output.erase(0, sent);
+    }
+
+    void SessionServer::Close(Worker &worker, Session &session) {
+        epoll_ctl(worker.epoll, EPOLL_CTL_DEL, session.socket, nullptr);
+        close(session.socket);
+        session.closed = true;
+    }
+
+    bool SessionServer::Serve(const std::string &socket_path) {
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) {
+            std::cerr << "Can't create server socket" << std::endl;
+            return false;
+        }
+
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socket_path.c_str());
+
+        if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listener, 128) < 0) {
+            std::cerr << "Can't listen on server socket " << socket_path << std::endl;
+            close(listener);
+            listener = -1;
+            return false;
+        }
+
+        //Poll with a timeout so Stop() is noticed
+        pollfd poll_listener = {listener, POLLIN, 0};
+        while (running) {
+            if (poll(&poll_listener, 1, 100) <= 0) continue;
+
+            int client = accept(listener, nullptr, nullptr);
+            if (client >= 0) AddClient(client);
+        }
+
+        close(listener);
+        listener = -1;
+        unlink(socket_path.c_str());
+        return true;
+    }
+
+    void SessionServer::Stop() {
+        running = false;
+    }
+
+    std::vector<SessionStats> SessionServer::GetStats() {
+        std::vector<SessionStats> stats;
+        for (auto &worker : workers) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            for (auto &slot : worker->wheel) {
+                for (auto &session : slot) {
+                    if (!session->closed) stats.push_back(session->stats);
+                }
+            }
+        }
+
+        std::sort(stats.begin(), stats.end(), [](const SessionStats &a, const SessionStats &b) {
+            return a.id < b.id;
+        });
+        return stats;
+    }
+
+    uint64_t SessionServer::GetWorkerCpuNanoseconds() const {
+        uint64_t total = 0;
+        for (auto &worker : workers) total += worker->cpu_nanoseconds;
+        return total;
+    }
+}
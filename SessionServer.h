@@ -0,0 +1,89 @@
+#ifndef CHIP8_EMULATOR_C_SESSIONSERVER_H
+#define CHIP8_EMULATOR_C_SESSIONSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    struct SessionStats {
+        int id;
+        uint64_t cpu_nanoseconds; //CPU time its worker thread spent emulating and encoding this session
+        uint64_t cycles;
+        uint64_t frames;
+    };
+
+    //Hosts one Chip8 per client connection on a fixed set of worker threads.
+    //Every message starts with a type byte, integers are little endian:
+    //  client 'L' <u16 length> <rom>    loads a ROM at 0x200 and starts or restarts the session
+    //  client 'K' <u16 mask>            sets the pressed keys, bit n is key n
+    //  client 'S'                       asks for the session statistics
+    //  server 'F' <u16 length> <delta>  changes to the framebuffer since the last 'F', see FrameDelta.h
+    //  server 'S' <u64 cpu ns> <u64 cycles> <u64 frames>
+    //Each worker owns its sessions and advances them from a timer wheel, a 60 Hz frame is split into WHEEL_SLOTS
+    //slots and each session runs one frame worth of cycles when its slot comes up, which spreads the work evenly.
+    class SessionServer {
+
+    public:
+        static constexpr int FRAMES_PER_SECOND = 60;
+        static constexpr int WHEEL_SLOTS = 16;
+
+    private:
+        struct Session {
+            int id;
+            int socket;
+            bool closed;
+            std::unique_ptr<Chip8> chip8; //Null until a ROM is loaded
+            Framebuffer sent; //What the client has been sent so far
+            std::string input;
+            std::string output;
+            SessionStats stats;
+        };
+
+        struct Worker {
+            std::mutex mutex; //Held by the worker while it runs, so statistics can be read from other threads
+            std::vector<std::unique_ptr<Session>> pending;
+            std::vector<std::vector<std::unique_ptr<Session>>> wheel;
+            int epoll;
+            std::atomic<uint64_t> cpu_nanoseconds;
+            std::thread thread;
+        };
+
+        int cycles_per_second;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<bool> running;
+        std::atomic<int> next_session;
+        int listener;
+
+        void RunWorker(Worker &worker);
+        void RunSlot(std::vector<std::unique_ptr<Session>> &slot);
+        void ReadInput(Worker &worker, Session &session);
+        bool HandleMessages(Session &session);
+        void SendFrame(Session &session);
+        void Flush(Session &session);
+        void Close(Worker &worker, Session &session);
+
+    public:
+        explicit SessionServer(int worker_count, int cycles_per_second = 1000);
+        ~SessionServer();
+
+        //Starts a session on an already connected stream socket, the server owns the socket afterwards
+        int AddClient(int socket);
+
+        //Accepts clients on a Unix domain socket until Stop() is called
+        bool Serve(const std::string &socket_path);
+        void Stop();
+
+        std::vector<SessionStats> GetStats();
+        //CPU time of all worker threads together
+        uint64_t GetWorkerCpuNanoseconds() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_SESSIONSERVER_H
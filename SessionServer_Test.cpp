@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "FrameDelta.h"
+#include "SessionServer.h"
+
+namespace {
+    //Reads exactly length bytes or gives up after a second
+    bool ReadAll(int socket, uint8_t *out, size_t length) {
+        while (length > 0) {
+            pollfd poll_socket = {socket, POLLIN, 0};
+            if (poll(&poll_socket, 1, 1000) <= 0) return false;
+            ssize_t received = recv(socket, out, length, 0);
+            if (received <= 0) return false;
+            out += received;
+            length -= received;
+        }
+        return true;
+    }
+
+    uint64_t LittleEndian(const uint8_t *in, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= uint64_t(in[i]) << (8 * i);
+        return value;
+    }
+}
+
+TEST_CASE("Session server streams changed framebuffer rows and statistics") {
+    int sockets[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+
+    Emulator::SessionServer server(1);
+    REQUIRE(server.AddClient(sockets[1]) == 0);
+
+    //Draws the "0" font sprite at 0,0 on row 0-4 then loops
+    const uint8_t load[] = {'L', 6, 0, 0xD0, 0x05, 0x12, 0x02, 0x00, 0x00};
+    REQUIRE(send(sockets[0], load, sizeof(load), 0) == sizeof(load));
+
+    uint8_t header[3];
+    REQUIRE(ReadAll(sockets[0], header, sizeof(header)));
+    REQUIRE(header[0] == 'F');
+
+    std::vector<uint8_t> delta(LittleEndian(header + 1, 2));
+    REQUIRE(ReadAll(sockets[0], delta.data(), delta.size()));
+
+    Emulator::Framebuffer frame;
+    frame.Clear();
+    REQUIRE(Emulator::ApplyFrameDelta(delta.data(), delta.size(), &frame));
+    REQUIRE(frame.Row(0)[0] == 0xF0);
+    REQUIRE(frame.Row(1)[0] == 0x90);
+    REQUIRE(frame.Row(5)[0] == 0x00);
+
+    //The picture doesn't change anymore, so the next message is the statistics reply
+    const uint8_t stats_request[] = {'K', 0x01, 0x00, 'S'};
+    REQUIRE(send(sockets[0], stats_request, sizeof(stats_request), 0) == sizeof(stats_request));
+
+    uint8_t stats[25];
+    REQUIRE(ReadAll(sockets[0], stats, sizeof(stats)));
+    REQUIRE(stats[0] == 'S');
+    REQUIRE(LittleEndian(stats + 9, 8) >= 16);
+    REQUIRE(LittleEndian(stats + 17, 8) >= 1);
+
+    auto sessions = server.GetStats();
+    REQUIRE(sessions.size() == 1);
+    REQUIRE(sessions[0].cpu_nanoseconds > 0);
+    REQUIRE(sessions[0].frames >= 1);
+
+    close(sockets[0]);
+}
@@ -0,0 +1,80 @@
+#include "SharedDisplay.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace Emulator {
+
+    SharedDisplayReader::SharedDisplayReader() : segment(nullptr) {}
+
+    SharedDisplayReader::~SharedDisplayReader() {
+        Close();
+    }
+
+    bool SharedDisplayReader::Open(const std::string &name) {
+        Close();
+        int file = shm_open(name.c_str(), O_RDONLY, 0);
+        if (file < 0) return false;
+
+        struct stat info = {};
+        void *mapping = MAP_FAILED;
+        if (fstat(file, &info) == 0 && size_t(info.st_size) >= sizeof(SharedDisplaySegment)) {
+            mapping = mmap(nullptr, sizeof(SharedDisplaySegment), PROT_READ, MAP_SHARED, file, 0);
+        }
+        close(file);
+        if (mapping == MAP_FAILED) return false;
+
+        segment = static_cast<const SharedDisplaySegment *>(mapping);
+        if (segment->magic.load(std::memory_order_acquire) != SharedDisplaySegment::MAGIC ||
+            segment->version != SharedDisplaySegment::VERSION || segment->frame_size != sizeof(SharedDisplayFrame)) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void SharedDisplayReader::Close() {
+        if (segment) munmap(const_cast<SharedDisplaySegment *>(segment), sizeof(SharedDisplaySegment));
+        segment = nullptr;
+    }
+
+    bool SharedDisplayReader::IsOpen() const {
+        return segment != nullptr;
+    }
+
+    bool SharedDisplayReader::Read(SharedDisplayFrame *frame, int max_attempts) const {
+        if (!segment) return false;
+
+        std::array<uint64_t, SharedDisplaySegment::FRAME_WORDS> words;
+        for (int attempt = 0; attempt < max_attempts; attempt++) {
+            uint64_t before = segment->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < words.size(); i++) {
+                words[i] = std::atomic_ref<uint64_t>(const_cast<uint64_t &>(segment->words[i])).load(
+                        std::memory_order_relaxed);
+            }
+            //Orders the copy before the second read, a store that raced with the copy shows up as a new sequence
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->sequence.load(std::memory_order_relaxed) == before) {
+                memcpy(static_cast<void *>(frame), words.data(), sizeof(*frame));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t SharedDisplayReader::GetSequence() const {
+        return segment ? segment->sequence.load(std::memory_order_acquire) : 0;
+    }
+
+    uint32_t SharedDisplayReader::GetWriterPid() const {
+        return segment ? segment->writer_pid : 0;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef CHIP8_EMULATOR_C_SHAREDDISPLAY_H
+#define CHIP8_EMULATOR_C_SHAREDDISPLAY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "Framebuffer.h"
+
+namespace Emulator {
+
+    //What the emulator publishes once per frame
+    struct SharedDisplayFrame {
+        uint64_t frame = 0; //Frames published so far, 0 before the first one
+        uint64_t cycle = 0;
+        std::array<uint8_t, Framebuffer::SIZE> pixels{}; //Packed like Framebuffer
+        std::array<uint8_t, 16> v{};
+        uint16_t program_counter = 0;
+        uint16_t index_register = 0;
+        uint16_t keys = 0;
+        uint8_t stack_pointer = 0;
+        uint8_t delay_timer = 0;
+        uint8_t sound_timer = 0;
+        uint8_t faults = 0;
+        uint8_t halted = 0;
+        uint8_t waiting_for_key = 0;
+        uint8_t unused[4]{}; //Fills up the last word, the frame is copied 8 bytes at a time
+
+        bool GetPixel(int x, int y) const {
+            return (pixels[y * Framebuffer::BYTES_PER_ROW + (x >> 3)] >> (7 - (x & 7))) & 1;
+        }
+    };
+
+    static_assert(sizeof(SharedDisplayFrame) % 8 == 0, "SharedDisplayFrame is copied in 8 byte words");
+    static_assert(std::has_unique_object_representations<SharedDisplayFrame>::value, "No padding between fields");
+    static_assert(offsetof(SharedDisplayFrame, frame) == 0, "The frame counter is the first word");
+
+    //Layout of the POSIX shared memory segment. The frame is guarded by a sequence lock: the writer makes sequence
+    //odd, stores the frame and makes it even again. A reader copies the frame between two reads of sequence and
+    //keeps the copy if both were the same even number, otherwise it tries again. The writer never waits for readers
+    //and readers never write, so any number of them can watch without slowing the emulator down.
+    struct SharedDisplaySegment {
+        static constexpr uint32_t MAGIC = 0x38504843; //"CHP8"
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t FRAME_WORDS = sizeof(SharedDisplayFrame) / 8;
+
+        std::atomic<uint32_t> magic; //Set last, once the rest of the header is valid
+        uint32_t version;
+        uint32_t frame_size;
+        uint32_t writer_pid;
+
+        alignas(64) std::atomic<uint64_t> sequence;
+        std::array<uint64_t, FRAME_WORDS> words; //The frame, only accessed through atomic_ref
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Atomics in shared memory have to be lock free");
+
+    //Maps a segment published by SharedDisplayWriter read only. Needs nothing of the emulator besides this header.
+    class SharedDisplayReader {
+
+    private:
+        const SharedDisplaySegment *segment;
+
+    public:
+        SharedDisplayReader();
+        ~SharedDisplayReader();
+        SharedDisplayReader(const SharedDisplayReader &) = delete;
+        SharedDisplayReader &operator=(const SharedDisplayReader &) = delete;
+
+        //name like "/chip8", false when there is no segment of this version under it
+        bool Open(const std::string &name);
+        void Close();
+        bool IsOpen() const;
+
+        //Copies the latest frame. Returns false when the writer was storing during each of max_attempts copies,
+        //which only happens if it publishes faster than a frame can be copied
+        bool Read(SharedDisplayFrame *frame, int max_attempts = 1000) const;
+        //Grows by 2 per published frame, cheap to poll for a new one
+        uint64_t GetSequence() const;
+        uint32_t GetWriterPid() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_SHAREDDISPLAY_H
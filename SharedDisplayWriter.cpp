@@ -0,0 +1,92 @@
+#include "SharedDisplayWriter.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Emulator {
+
+    SharedDisplayWriter::SharedDisplayWriter() : segment(nullptr), frames(0) {}
+
+    SharedDisplayWriter::~SharedDisplayWriter() {
+        Close();
+    }
+
+    bool SharedDisplayWriter::Open(const std::string &segment_name) {
+        Close();
+        //A fresh segment instead of truncating the old one, which would fault readers that still map it
+        shm_unlink(segment_name.c_str());
+        int file = shm_open(segment_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (file < 0) return false;
+
+        void *mapping = MAP_FAILED;
+        if (ftruncate(file, sizeof(SharedDisplaySegment)) == 0) {
+            mapping = mmap(nullptr, sizeof(SharedDisplaySegment), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        }
+        close(file);
+        if (mapping == MAP_FAILED) {
+            shm_unlink(segment_name.c_str());
+            return false;
+        }
+
+        //The new pages are zero, which is a valid sequence with no frame published yet
+        segment = static_cast<SharedDisplaySegment *>(mapping);
+        segment->version = SharedDisplaySegment::VERSION;
+        segment->frame_size = sizeof(SharedDisplayFrame);
+        segment->writer_pid = getpid();
+        segment->magic.store(SharedDisplaySegment::MAGIC, std::memory_order_release);
+        name = segment_name;
+        frames = 0;
+        return true;
+    }
+
+    void SharedDisplayWriter::Close() {
+        if (!segment) return;
+        munmap(segment, sizeof(SharedDisplaySegment));
+        shm_unlink(name.c_str());
+        segment = nullptr;
+    }
+
+    bool SharedDisplayWriter::IsOpen() const {
+        return segment != nullptr;
+    }
+
+    void SharedDisplayWriter::Publish(const Chip8 &chip8, uint64_t cycle) {
+        const Chip8State &state = chip8.GetState();
+        SharedDisplayFrame frame;
+        frame.cycle = cycle;
+        frame.pixels = state.gfx.pixels;
+        frame.v = state.v;
+        frame.program_counter = state.program_counter;
+        frame.index_register = state.index_register;
+        frame.keys = chip8.GetKeyState();
+        frame.stack_pointer = state.stack_pointer;
+        frame.delay_timer = state.delay_timer;
+        frame.sound_timer = state.sound_timer;
+        frame.faults = state.faults;
+        frame.halted = state.halted;
+        frame.waiting_for_key = state.waiting_for_key;
+        Publish(frame);
+    }
+
+    void SharedDisplayWriter::Publish(const SharedDisplayFrame &frame) {
+        if (!segment) return;
+
+        std::array<uint64_t, SharedDisplaySegment::FRAME_WORDS> words;
+        memcpy(words.data(), &frame, sizeof(frame));
+        words[0] = ++frames; //frame.frame is the first field
+
+        //Odd while storing, the release fence keeps the stores below from moving above the odd sequence
+        uint64_t sequence = segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < words.size(); i++) {
+            std::atomic_ref<uint64_t>(segment->words[i]).store(words[i], std::memory_order_relaxed);
+        }
+        segment->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    uint64_t SharedDisplayWriter::GetFrames() const {
+        return frames;
+    }
+}
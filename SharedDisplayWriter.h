@@ -0,0 +1,38 @@
+#ifndef CHIP8_EMULATOR_C_SHAREDDISPLAYWRITER_H
+#define CHIP8_EMULATOR_C_SHAREDDISPLAYWRITER_H
+
+#include <string>
+#include "Chip8.h"
+#include "SharedDisplay.h"
+
+namespace Emulator {
+
+    //Publishes the display, keys and registers of a running machine into a POSIX shared memory segment that
+    //SharedDisplayReader maps from other processes. Publishing is a handful of stores, it never blocks on readers.
+    class SharedDisplayWriter {
+
+    private:
+        SharedDisplaySegment *segment;
+        std::string name;
+        uint64_t frames;
+
+    public:
+        SharedDisplayWriter();
+        ~SharedDisplayWriter();
+        SharedDisplayWriter(const SharedDisplayWriter &) = delete;
+        SharedDisplayWriter &operator=(const SharedDisplayWriter &) = delete;
+
+        //Replaces any segment left under name, readers still mapping an old one keep seeing its last frame
+        bool Open(const std::string &name);
+        //Unmaps and removes the segment
+        void Close();
+        bool IsOpen() const;
+
+        void Publish(const Chip8 &chip8, uint64_t cycle);
+        //Stores frame as is apart from frame.frame, which counts the published frames
+        void Publish(const SharedDisplayFrame &frame);
+        uint64_t GetFrames() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_SHAREDDISPLAYWRITER_H
@@ -0,0 +1,159 @@
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SharedDisplayWriter.h"
+
+namespace {
+    std::string SegmentName(const char *test) {
+        return "/chip8_test_" + std::string(test) + "_" + std::to_string(getpid());
+    }
+
+    //Every field derives from the frame number, so a frame mixed from two stores can't pass Consistent
+    Emulator::SharedDisplayFrame MakeFrame(uint64_t number) {
+        Emulator::SharedDisplayFrame frame;
+        frame.cycle = number * 17;
+        frame.pixels.fill(static_cast<uint8_t>(number));
+        frame.v.fill(static_cast<uint8_t>(number + 1));
+        frame.program_counter = number & 0xFFF;
+        frame.index_register = static_cast<uint16_t>(number * 3);
+        frame.keys = static_cast<uint16_t>(number);
+        frame.stack_pointer = number & 0xF;
+        frame.delay_timer = static_cast<uint8_t>(number + 2);
+        frame.sound_timer = static_cast<uint8_t>(number + 3);
+        return frame;
+    }
+
+    bool Consistent(const Emulator::SharedDisplayFrame &frame) {
+        Emulator::SharedDisplayFrame expected = MakeFrame(frame.frame);
+        expected.frame = frame.frame;
+        return memcmp(&frame, &expected, sizeof(frame)) == 0;
+    }
+
+    //Reads as fast as it can until stop, returns the number of bad frames
+    uint64_t ReadUntil(const std::string &name, const std::atomic<bool> &stop, uint64_t *reads) {
+        Emulator::SharedDisplayReader reader;
+        if (!reader.Open(name)) return 1;
+        uint64_t bad = 0;
+        uint64_t last = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            Emulator::SharedDisplayFrame frame;
+            if (!reader.Read(&frame)) continue;
+            //Frames only ever move forward
+            if (frame.frame < last || (frame.frame > 0 && !Consistent(frame))) bad++;
+            last = frame.frame;
+            (*reads)++;
+        }
+        return bad;
+    }
+}
+
+TEST_CASE("Shared display publishes a machine's screen, keys and registers") {
+    std::string name = SegmentName("machine");
+    Emulator::SharedDisplayWriter writer;
+    REQUIRE(writer.Open(name));
+
+    Emulator::SharedDisplayReader reader;
+    REQUIRE(reader.Open(name));
+    REQUIRE(reader.GetWriterPid() == uint32_t(getpid()));
+
+    //Nothing published yet reads as an empty frame 0
+    Emulator::SharedDisplayFrame frame;
+    REQUIRE(reader.Read(&frame));
+    REQUIRE(frame.frame == 0);
+    REQUIRE(reader.GetSequence() == 0);
+
+    Emulator::Chip8 chip8(1);
+    chip8.WriteMemory(0x200, std::vector<uint8_t>{0xA2, 0x0A, 0xD0, 0x05}); //I = 0x20A, draw 5 rows at V0, V0
+    chip8.SetCpuRegister(0, 3);
+    chip8.SetCpuRegister(0xE, 0x42);
+    chip8.SetDelayTimer(9);
+    chip8.SetKeyState(0x8001);
+    chip8.EmulateCycle();
+    chip8.EmulateCycle();
+    writer.Publish(chip8, 2);
+
+    REQUIRE(reader.GetSequence() == 2);
+    REQUIRE(reader.Read(&frame));
+    REQUIRE(frame.frame == 1);
+    REQUIRE(frame.cycle == 2);
+    REQUIRE(frame.program_counter == chip8.GetProgramCounter());
+    REQUIRE(frame.index_register == 0x20A);
+    REQUIRE(frame.v[0] == 3);
+    REQUIRE(frame.v[0xE] == 0x42);
+    REQUIRE(frame.delay_timer == chip8.GetDelayTimer());
+    REQUIRE(frame.keys == 0x8001);
+    REQUIRE(frame.halted == 0);
+    for (int y = 0; y < Emulator::Framebuffer::HEIGHT; y++) {
+        for (int x = 0; x < Emulator::Framebuffer::WIDTH; x++) {
+            REQUIRE(frame.GetPixel(x, y) == chip8.GetGfx().GetPixel(x, y));
+        }
+    }
+
+    //Closing the writer removes the name, a reader that has it mapped keeps the last frame
+    writer.Close();
+    Emulator::SharedDisplayReader late;
+    REQUIRE_FALSE(late.Open(name));
+    REQUIRE(reader.Read(&frame));
+    REQUIRE(frame.frame == 1);
+}
+
+TEST_CASE("Shared display readers never see a torn frame") {
+    std::string name = SegmentName("threads");
+    Emulator::SharedDisplayWriter writer;
+    REQUIRE(writer.Open(name));
+
+    const int READERS = 4;
+    std::atomic<bool> stop(false);
+    std::vector<uint64_t> bad(READERS), reads(READERS);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < READERS; i++) {
+        readers.emplace_back([&, i]() { bad[i] = ReadUntil(name, stop, &reads[i]); });
+    }
+
+    //The writer doesn't wait for anyone, only the readers retry
+    const uint64_t FRAMES = 200000;
+    for (uint64_t number = 1; number <= FRAMES; number++) writer.Publish(MakeFrame(number));
+    stop = true;
+    for (std::thread &reader: readers) reader.join();
+
+    REQUIRE(writer.GetFrames() == FRAMES);
+    for (int i = 0; i < READERS; i++) {
+        REQUIRE(bad[i] == 0);
+        REQUIRE(reads[i] > 0);
+    }
+}
+
+TEST_CASE("Shared display is readable from another process") {
+    std::string name = SegmentName("process");
+    Emulator::SharedDisplayWriter writer;
+    REQUIRE(writer.Open(name));
+
+    const uint64_t FRAMES = 100000;
+    pid_t child = fork();
+    if (child == 0) {
+        //Reads until it has seen the last frame, the exit status tells the parent how it went
+        Emulator::SharedDisplayReader reader;
+        if (!reader.Open(name)) _exit(2);
+        Emulator::SharedDisplayFrame frame;
+        uint64_t last = 0;
+        do {
+            if (!reader.Read(&frame)) continue;
+            if (frame.frame < last || (frame.frame > 0 && !Consistent(frame))) _exit(1);
+            last = frame.frame;
+        } while (last < FRAMES);
+        _exit(0);
+    }
+    REQUIRE(child > 0);
+
+    for (uint64_t number = 1; number <= FRAMES; number++) writer.Publish(MakeFrame(number));
+
+    int status = 0;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
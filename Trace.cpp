@@ -0,0 +1,374 @@
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+#include "Instruction.h"
+
+namespace Emulator {
+
+    namespace {
+        const char TRACE_MAGIC[8] = {'C', '8', 'T', 'R', 'A', 'C', 'E', '1'};
+        const size_t RECORDS_PER_CHUNK = 8192;
+
+        //Flags that only exist in the file, they mark fields that can't be predicted from the record before
+        const uint8_t ENCODED_CYCLE = 0x10;
+        const uint8_t ENCODED_PC = 0x20;
+        const uint8_t ENCODED_OPCODE = 0x40;
+
+        void PutU16(std::vector<unsigned char> *out, uint16_t value) {
+            out->push_back(value & 0xFF);
+            out->push_back(value >> 8);
+        }
+
+        void PutU32(unsigned char *out, uint32_t value) {
+            for (int i = 0; i < 4; i++) out[i] = (value >> (8 * i)) & 0xFF;
+        }
+
+        uint32_t GetU32(const unsigned char *in) {
+            return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+        }
+
+        void PutVarint(std::vector<unsigned char> *out, uint64_t value) {
+            while (value >= 0x80) {
+                out->push_back(static_cast<unsigned char>(value | 0x80));
+                value >>= 7;
+            }
+            out->push_back(static_cast<unsigned char>(value));
+        }
+
+        bool GetVarint(const std::vector<unsigned char> &in, size_t *position, uint64_t *value) {
+            *value = 0;
+            for (int shift = 0; *position < in.size() && shift < 64; shift += 7) {
+                unsigned char byte = in[(*position)++];
+                *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+    }
+
+    TraceRecorder::TraceRecorder(const std::string &path) : file(path, std::ios::binary), running(false),
+                                                            next_stream_id(0) {
+        if (!file.is_open()) {
+            std::fprintf(stderr, "Can't open trace file %s\n", path.c_str());
+            return;
+        }
+
+        file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        running = true;
+        flusher = std::thread(&TraceRecorder::FlushLoop, this);
+    }
+
+    TraceRecorder::~TraceRecorder() {
+        if (!running) return;
+
+        running = false;
+        flusher.join();
+
+        //Tracers that are still alive get their remaining records written here
+        std::lock_guard<std::mutex> lock(mutex);
+        for (TraceRing *ring : rings) {
+            while (Drain(ring)) {}
+        }
+    }
+
+    bool TraceRecorder::IsOpen() const {
+        return running;
+    }
+
+    TraceRing *TraceRecorder::Register() {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.push_back(new TraceRing(next_stream_id++));
+        return rings.back();
+    }
+
+    void TraceRecorder::Unregister(TraceRing *ring) {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (Drain(ring)) {}
+
+        for (size_t i = 0; i < rings.size(); i++) {
+            if (rings[i] == ring) {
+                rings.erase(rings.begin() + i);
+                break;
+            }
+        }
+        delete ring;
+    }
+
+    void TraceRecorder::FlushLoop() {
+        while (running) {
+            bool drained_any = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (TraceRing *ring : rings) drained_any = Drain(ring) || drained_any;
+            }
+
+            if (!drained_any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool TraceRecorder::Drain(TraceRing *ring) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        if (head == tail) return false;
+
+        //Copy out of the ring first so the producer can continue while we compress
+        size_t count = static_cast<size_t>(std::min<uint64_t>(head - tail, RECORDS_PER_CHUNK));
+        std::vector<TraceRecord> records(count);
+        for (size_t i = 0; i < count; i++) {
+            records[i] = ring->records[(tail + i) & (TraceRing::CAPACITY - 1)];
+        }
+        ring->tail.store(tail + count, std::memory_order_release);
+
+        WriteChunk(ring->stream_id, records.data(), count);
+        return true;
+    }
+
+    void TraceRecorder::WriteChunk(uint32_t stream_id, const TraceRecord *records, size_t count) {
+        //Most records follow the one before: next cycle, next PC and the opcode seen last time at that PC.
+        //Only what differs is stored, which leaves little more than flags and changed values for deflate.
+        std::vector<unsigned char> raw;
+        raw.reserve(count * 4);
+        std::vector<uint16_t> opcode_at(4096, 0);
+        uint64_t previous_cycle = 0;
+        uint16_t previous_pc = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            const TraceRecord &record = records[i];
+            uint8_t flags = record.flags;
+            bool continuation = record.flags & TRACE_CONTINUATION;
+
+            if (!continuation) {
+                if (i == 0 || record.cycle != previous_cycle + 1) flags |= ENCODED_CYCLE;
+                if (record.pc != ((previous_pc + 2) & 0xFFFF)) flags |= ENCODED_PC;
+                if (opcode_at[record.pc & 0x0FFF] != record.opcode) flags |= ENCODED_OPCODE;
+            } else if (i == 0) {
+                //Drain() can split an instruction's records, the rest of them has nothing to continue from
+                flags |= ENCODED_CYCLE | ENCODED_PC | ENCODED_OPCODE;
+            }
+            raw.push_back(flags);
+
+            if (flags & ENCODED_CYCLE) PutVarint(&raw, record.cycle - previous_cycle);
+            if (flags & ENCODED_PC) PutU16(&raw, record.pc);
+            if (flags & ENCODED_OPCODE) PutU16(&raw, record.opcode);
+
+            if (record.flags & TRACE_REGISTER) {
+                raw.push_back(record.reg);
+                raw.push_back(record.reg_value);
+            }
+            if (record.flags & TRACE_MEMORY) {
+                PutU16(&raw, record.address);
+                raw.push_back(record.memory_value);
+            }
+
+            previous_cycle = record.cycle;
+            previous_pc = record.pc;
+            opcode_at[record.pc & 0x0FFF] = record.opcode;
+        }
+
+        uLongf compressed_size = compressBound(raw.size());
+        std::vector<unsigned char> compressed(compressed_size);
+        compress2(compressed.data(), &compressed_size, raw.data(), raw.size(), Z_BEST_SPEED);
+
+        unsigned char header[16];
+        PutU32(header, stream_id);
+        PutU32(header + 4, static_cast<uint32_t>(count));
+        PutU32(header + 8, static_cast<uint32_t>(raw.size()));
+        PutU32(header + 12, static_cast<uint32_t>(compressed_size));
+
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(compressed.data()), compressed_size);
+    }
+
+    Tracer::Tracer(TraceRecorder &recorder) : recorder(recorder), ring(nullptr), cycle(0), head(0), cached_tail(0) {
+        if (recorder.IsOpen()) ring = recorder.Register();
+    }
+
+    Tracer::~Tracer() {
+        if (ring != nullptr) recorder.Unregister(ring);
+    }
+
+    void Tracer::Push(const TraceRecord &record) {
+        //Block instead of dropping records when the flush thread falls behind
+        while (head - cached_tail >= TraceRing::CAPACITY) {
+            cached_tail = ring->tail.load(std::memory_order_acquire);
+            if (head - cached_tail >= TraceRing::CAPACITY) std::this_thread::yield();
+        }
+
+        ring->records[head & (TraceRing::CAPACITY - 1)] = record;
+        head++;
+    }
+
+    void Tracer::Step(Chip8 &chip8) {
+        if (ring == nullptr) {
+            chip8.EmulateCycle();
+            return;
+        }
+
+        //Read through the state instead of the getters, they are calls into Chip8.cpp and this runs every cycle
+        const Chip8State &state = chip8.GetState();
+        unsigned short pc = state.program_counter;
+        unsigned short opcode = state.memory[pc & 0x0FFF] << 8 | state.memory[(pc + 1) & 0x0FFF];
+        unsigned short index_register = state.index_register;
+        uint16_t register_writes = RegisterWritesOf(opcode);
+
+        //Copying all 16 is a single move, only the ones the opcode can write are compared afterwards
+        std::array<unsigned char, 16> before = state.v;
+
+        chip8.EmulateCycle();
+
+        TraceRecord record = {cycle, pc, opcode, 0, 0, 0, 0, 0};
+
+        for (uint16_t mask = register_writes; mask != 0; mask &= mask - 1) {
+            int i = __builtin_ctz(mask);
+            unsigned char after = state.v[i];
+            if (after == before[i]) continue;
+
+            if (record.flags & TRACE_REGISTER) {
+                Push(record);
+                record.flags = TRACE_CONTINUATION;
+            }
+            record.flags |= TRACE_REGISTER;
+            record.reg = i;
+            record.reg_value = after;
+        }
+
+        //Only Fx33 and Fx55 write memory
+        if ((opcode & 0xF000) == 0xF000) {
+            MemoryAccess access = MemoryAccessOf(opcode, index_register);
+            for (int i = 0; i < access.write_length; i++) {
+                if (record.flags & TRACE_MEMORY) {
+                    Push(record);
+                    record.flags = TRACE_CONTINUATION;
+                }
+                record.flags |= TRACE_MEMORY;
+                record.address = (access.write_address + i) & 0x0FFF;
+                record.memory_value = state.memory[record.address];
+            }
+        }
+
+        Push(record);
+        ring->head.store(head, std::memory_order_release);
+        cycle++;
+    }
+
+    uint64_t Tracer::GetCycle() const {
+        return cycle;
+    }
+
+    TraceReader::TraceReader(const std::string &path) : file(path, std::ios::binary), stream_id(0), position(0) {
+        char magic[sizeof(TRACE_MAGIC)];
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) file.close();
+    }
+
+    bool TraceReader::IsOpen() const {
+        return file.is_open();
+    }
+
+    bool TraceReader::ReadChunk() {
+        unsigned char header[16];
+        if (!file.is_open() || !file.read(reinterpret_cast<char *>(header), sizeof(header))) return false;
+
+        stream_id = GetU32(header);
+        uint32_t count = GetU32(header + 4);
+        uLongf raw_size = GetU32(header + 8);
+        uint32_t compressed_size = GetU32(header + 12);
+
+        std::vector<unsigned char> compressed(compressed_size);
+        std::vector<unsigned char> raw(raw_size);
+        if (!file.read(reinterpret_cast<char *>(compressed.data()), compressed_size)) return false;
+        if (uncompress(raw.data(), &raw_size, compressed.data(), compressed_size) != Z_OK) return false;
+
+        chunk.clear();
+        position = 0;
+        size_t offset = 0;
+        std::vector<uint16_t> opcode_at(4096, 0);
+        TraceRecord previous = {};
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (offset >= raw.size()) return false;
+            uint8_t flags = raw[offset++];
+
+            TraceRecord record = {};
+            record.flags = flags & (TRACE_REGISTER | TRACE_MEMORY | TRACE_CONTINUATION);
+            record.cycle = previous.cycle;
+            record.pc = previous.pc;
+            record.opcode = previous.opcode;
+
+            if (!(flags & TRACE_CONTINUATION)) {
+                record.cycle = previous.cycle + 1;
+                record.pc = previous.pc + 2;
+            }
+            if (flags & ENCODED_CYCLE) {
+                uint64_t delta;
+                if (!GetVarint(raw, &offset, &delta)) return false;
+                record.cycle = previous.cycle + delta;
+            }
+            if (flags & ENCODED_PC) {
+                if (offset + 2 > raw.size()) return false;
+                record.pc = raw[offset] | raw[offset + 1] << 8;
+                offset += 2;
+            }
+            if (!(flags & TRACE_CONTINUATION)) record.opcode = opcode_at[record.pc & 0x0FFF];
+            if (flags & ENCODED_OPCODE) {
+                if (offset + 2 > raw.size()) return false;
+                record.opcode = raw[offset] | raw[offset + 1] << 8;
+                offset += 2;
+            }
+
+            if (flags & TRACE_REGISTER) {
+                if (offset + 2 > raw.size()) return false;
+                record.reg = raw[offset];
+                record.reg_value = raw[offset + 1];
+                offset += 2;
+            }
+            if (flags & TRACE_MEMORY) {
+                if (offset + 3 > raw.size()) return false;
+                record.address = raw[offset] | raw[offset + 1] << 8;
+                record.memory_value = raw[offset + 2];
+                offset += 3;
+            }
+
+            opcode_at[record.pc & 0x0FFF] = record.opcode;
+            chunk.push_back(record);
+            previous = record;
+        }
+
+        return true;
+    }
+
+    bool TraceReader::Next(uint32_t *stream_id, TraceRecord *record) {
+        while (position >= chunk.size()) {
+            if (!ReadChunk()) return false;
+        }
+
+        *stream_id = TraceReader::stream_id;
+        *record = chunk[position++];
+        return true;
+    }
+
+    std::string FormatTraceRecord(uint32_t stream_id, const TraceRecord &record) {
+        char text[128];
+        int length;
+
+        if (record.flags & TRACE_CONTINUATION) {
+            length = snprintf(text, sizeof(text), "%u %12llu %27s", stream_id,
+                              static_cast<unsigned long long>(record.cycle), "");
+        } else {
+            length = snprintf(text, sizeof(text), "%u %12llu %03X %04X %-16s", stream_id,
+                              static_cast<unsigned long long>(record.cycle), record.pc, record.opcode,
+                              Disassemble(record.opcode).c_str());
+        }
+
+        if (record.flags & TRACE_REGISTER) {
+            length += snprintf(text + length, sizeof(text) - length, " V%X=%02X", record.reg, record.reg_value);
+        }
+        if (record.flags & TRACE_MEMORY) {
+            snprintf(text + length, sizeof(text) - length, " [%03X]=%02X", record.address, record.memory_value);
+        }
+
+        return text;
+    }
+}
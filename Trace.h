@@ -0,0 +1,113 @@
+#ifndef CHIP8_EMULATOR_C_TRACE_H
+#define CHIP8_EMULATOR_C_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    const uint8_t TRACE_REGISTER = 1; //reg and reg_value are valid
+    const uint8_t TRACE_MEMORY = 2; //address and memory_value are valid
+    const uint8_t TRACE_CONTINUATION = 4; //More changes of the same instruction as the record before
+
+    struct TraceRecord {
+        uint64_t cycle;
+        uint16_t pc;
+        uint16_t opcode;
+        uint16_t address;
+        uint8_t reg;
+        uint8_t reg_value;
+        uint8_t memory_value;
+        uint8_t flags;
+    };
+
+    //Single producer single consumer ring between a Tracer and the flush thread
+    struct TraceRing {
+        static const uint64_t CAPACITY = 1 << 16;
+
+        uint32_t stream_id;
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+        std::vector<TraceRecord> records;
+
+        explicit TraceRing(uint32_t stream_id) : stream_id(stream_id), head(0), tail(0), records(CAPACITY) {}
+    };
+
+    //Owns the trace file and a background thread that drains all rings into zlib compressed chunks
+    class TraceRecorder {
+
+    private:
+        std::ofstream file;
+        std::thread flusher;
+        std::mutex mutex;
+        std::vector<TraceRing *> rings;
+        std::atomic<bool> running;
+        uint32_t next_stream_id;
+
+        void FlushLoop();
+        bool Drain(TraceRing *ring);
+        void WriteChunk(uint32_t stream_id, const TraceRecord *records, size_t count);
+
+        friend class Tracer;
+        TraceRing *Register();
+        void Unregister(TraceRing *ring);
+
+    public:
+        explicit TraceRecorder(const std::string &path);
+        ~TraceRecorder();
+
+        bool IsOpen() const;
+    };
+
+    //Records one emulator, must only be used from one thread at a time and be destroyed before its recorder
+    class Tracer {
+
+    private:
+        TraceRecorder &recorder;
+        TraceRing *ring;
+        uint64_t cycle;
+        uint64_t head; //Records written so far, ring->head only gets them once per instruction
+        uint64_t cached_tail;
+
+        //Writes a record, Step() publishes all of an instruction's records at once
+        void Push(const TraceRecord &record);
+
+    public:
+        explicit Tracer(TraceRecorder &recorder);
+        ~Tracer();
+
+        //Runs one EmulateCycle and records what it changed
+        void Step(Chip8 &chip8);
+
+        uint64_t GetCycle() const;
+    };
+
+    //Offline decoder for files written by TraceRecorder
+    class TraceReader {
+
+    private:
+        std::ifstream file;
+        uint32_t stream_id;
+        std::vector<TraceRecord> chunk;
+        size_t position;
+
+        bool ReadChunk();
+
+    public:
+        explicit TraceReader(const std::string &path);
+
+        bool IsOpen() const;
+        bool Next(uint32_t *stream_id, TraceRecord *record);
+    };
+
+    std::string FormatTraceRecord(uint32_t stream_id, const TraceRecord &record);
+}
+
+#endif //CHIP8_EMULATOR_C_TRACE_H
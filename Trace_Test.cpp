@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include "Trace.h"
+
+TEST_CASE("Trace records register and memory changes and decodes them again") {
+    std::string path = "trace_test.bin";
+    {
+        Emulator::TraceRecorder recorder(path);
+        Emulator::Tracer tracer(recorder);
+        Emulator::Chip8 chip8;
+
+        chip8.WriteToMemory(0x200, 0x61); //LD V1, 0x2A
+        chip8.WriteToMemory(0x201, 0x2A);
+        chip8.WriteToMemory(0x202, 0xA3); //LD I, 0x300
+        chip8.WriteToMemory(0x203, 0x00);
+        chip8.WriteToMemory(0x204, 0xF1); //LD [I], V1
+        chip8.WriteToMemory(0x205, 0x55);
+
+        for (int i = 0; i < 3; i++) tracer.Step(chip8);
+    }
+
+    Emulator::TraceReader reader(path);
+    REQUIRE(reader.IsOpen());
+
+    uint32_t stream_id;
+    std::vector<Emulator::TraceRecord> records;
+    Emulator::TraceRecord record;
+    while (reader.Next(&stream_id, &record)) records.push_back(record);
+
+    REQUIRE(records.size() == 4);
+    REQUIRE(records[0].pc == 0x200);
+    REQUIRE(records[0].flags == Emulator::TRACE_REGISTER);
+    REQUIRE(records[0].reg == 1);
+    REQUIRE(records[0].reg_value == 0x2A);
+    REQUIRE(records[1].opcode == 0xA300);
+    REQUIRE(records[1].flags == 0);
+    REQUIRE(records[2].cycle == 2);
+    REQUIRE(records[2].address == 0x300);
+    REQUIRE(records[3].flags == (Emulator::TRACE_CONTINUATION | Emulator::TRACE_MEMORY));
+    REQUIRE(records[3].address == 0x301);
+    REQUIRE(records[3].memory_value == 0x2A);
+
+    REQUIRE(Emulator::FormatTraceRecord(0, records[0]).find("LD V1, 0x2A") != std::string::npos);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Trace decodes instructions whose records are split between chunks") {
+    std::string path = "trace_split_test.bin";
+    const int LOOPS = 3000;
+    {
+        Emulator::TraceRecorder recorder(path);
+        Emulator::Tracer tracer(recorder);
+        Emulator::Chip8 chip8;
+        //LD I, 0x300, then ADD V0, 1 / LD [I], VF / LD VF, [I] / JP 202, 19 records per pass. Chunks hold 8192
+        //records, so some of them start inside the 16 of an LD [I], VF
+        const uint8_t rom[] = {0xA3, 0x00, 0x70, 0x01, 0xFF, 0x55, 0xFF, 0x65, 0x12, 0x02};
+        chip8.LoadRom(rom);
+
+        for (int i = 0; i < 1 + 4 * LOOPS; i++) tracer.Step(chip8);
+    }
+
+    Emulator::TraceReader reader(path);
+    REQUIRE(reader.IsOpen());
+
+    const uint16_t opcodes[] = {0x7001, 0xFF55, 0xFF65, 0x1202};
+    uint32_t stream_id;
+    Emulator::TraceRecord record;
+    size_t count = 0;
+    uint64_t last_cycle = 0;
+    int bad = 0, written = 0;
+    while (reader.Next(&stream_id, &record)) {
+        count++;
+        if (record.cycle == 0) {
+            if (record.pc != 0x200 || record.opcode != 0xA300) bad++;
+            continue;
+        }
+        //Counted instead of REQUIREd one by one, there are tens of thousands of records
+        int step = static_cast<int>((record.cycle - 1) % 4);
+        bool continuation = record.flags & Emulator::TRACE_CONTINUATION;
+        if (record.pc != 0x202 + 2 * step || record.opcode != opcodes[step]) bad++;
+        if (record.cycle != (continuation ? last_cycle : last_cycle + 1)) bad++;
+        written = continuation ? written + 1 : 0;
+        if ((record.flags & Emulator::TRACE_MEMORY) && record.address != 0x300 + written) bad++;
+        last_cycle = record.cycle;
+    }
+
+    REQUIRE(count > 2 * 8192);
+    REQUIRE(count == 1 + 19 * LOOPS);
+    REQUIRE(last_cycle == 4 * LOOPS);
+    REQUIRE(bad == 0);
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,151 @@
+#include "VectorEnv.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Emulator {
+
+    namespace {
+        //The 8 pixel bytes of every framebuffer byte, leftmost pixel first in memory
+        struct UnpackTable {
+            std::array<uint64_t, 256> bytes;
+
+            UnpackTable() : bytes() {
+                for (int value = 0; value < 256; value++) {
+                    for (int pixel = 0; pixel < 8; pixel++) {
+                        uint8_t lit = (value >> (7 - pixel)) & 1;
+                        reinterpret_cast<uint8_t *>(&bytes[value])[pixel] = lit;
+                    }
+                }
+            }
+        };
+
+        const UnpackTable unpack_table;
+    }
+
+    VectorEnv::VectorEnv(size_t count, std::span<const uint8_t> rom, VectorEnvOptions options) :
+            slots(new Slot[count]), count(count), options(std::move(options)) {
+        VectorEnv::options.frame_skip = std::max(VectorEnv::options.frame_skip, 1);
+        VectorEnv::options.cycles_per_frame = std::max(VectorEnv::options.cycles_per_frame, 1);
+
+        Chip8 image(0);
+        image.LoadRom(rom);
+        initial = image.GetState();
+
+        for (size_t env = 0; env < count; env++) {
+            slots[env].chip8.SetHaltOnFault(VectorEnv::options.halt_on_fault);
+            ResetSlot(env);
+        }
+    }
+
+    double VectorEnv::Score(Chip8 &chip8) const {
+        double score = 0;
+        for (const RewardTerm &term : options.rewards) {
+            int64_t value = 0;
+            for (int i = 0; i < term.length; i++) {
+                value = value * (term.bcd ? 10 : 256) + chip8.GetMemory(term.address + i);
+            }
+            score += value * static_cast<double>(term.scale);
+        }
+        return score;
+    }
+
+    void VectorEnv::ResetSlot(size_t env) {
+        Slot &slot = slots[env];
+        slot.chip8.SetState(initial);
+        slot.chip8.SeedRandom(options.seed + (static_cast<uint64_t>(env) << 32) + slot.episode);
+        slot.chip8.SetKeyState(0);
+        slot.score = Score(slot.chip8);
+        slot.steps = 0;
+    }
+
+    void VectorEnv::Observe(size_t env, uint8_t *observation) const {
+        const Framebuffer &gfx = slots[env].chip8.GetGfx();
+        if (options.observation == OBSERVATION_PACKED) {
+            memcpy(observation, gfx.pixels.data(), Framebuffer::SIZE);
+            return;
+        }
+
+        for (int i = 0; i < Framebuffer::SIZE; i++) {
+            memcpy(observation + i * 8, &unpack_table.bytes[gfx.pixels[i]], 8);
+        }
+    }
+
+    void VectorEnv::SetInitialState(const Chip8State &state) {
+        initial = state;
+    }
+
+    bool VectorEnv::Reset(std::span<uint8_t> observations) {
+        if (observations.size() < count * ObservationSize()) return false;
+
+        for (size_t env = 0; env < count; env++) {
+            slots[env].episode++;
+            ResetSlot(env);
+            Observe(env, observations.data() + env * ObservationSize());
+        }
+        return true;
+    }
+
+    bool VectorEnv::Reset(std::span<const uint32_t> envs, std::span<uint8_t> observations) {
+        if (observations.size() < count * ObservationSize()) return false;
+        for (uint32_t env : envs) {
+            if (env >= count) return false;
+        }
+
+        for (uint32_t env : envs) {
+            slots[env].episode++;
+            ResetSlot(env);
+            Observe(env, observations.data() + env * ObservationSize());
+        }
+        return true;
+    }
+
+    bool VectorEnv::Step(std::span<const uint16_t> actions, std::span<uint8_t> observations, std::span<float> rewards,
+                         std::span<uint8_t> dones) {
+        if (actions.size() < count || rewards.size() < count || dones.size() < count ||
+            observations.size() < count * ObservationSize()) {
+            return false;
+        }
+
+        uint64_t cycles = static_cast<uint64_t>(options.frame_skip) * options.cycles_per_frame;
+        for (size_t env = 0; env < count; env++) {
+            Slot &slot = slots[env];
+            slot.chip8.SetKeyState(actions[env]);
+            slot.chip8.Run(cycles);
+            slot.steps++;
+
+            double score = options.rewards.empty() ? 0 : Score(slot.chip8);
+            float reward = static_cast<float>(score - slot.score);
+            slot.score = score;
+            if (options.reward) reward += options.reward(slot.chip8);
+            rewards[env] = reward;
+
+            uint8_t done = EPISODE_RUNNING;
+            if (slot.chip8.IsHalted() || (options.done && options.done(slot.chip8))) done = EPISODE_TERMINATED;
+            else if (options.max_steps > 0 && slot.steps >= options.max_steps) done = EPISODE_TRUNCATED;
+            dones[env] = done;
+
+            if (done != EPISODE_RUNNING) {
+                slot.episode++;
+                ResetSlot(env);
+            }
+            Observe(env, observations.data() + env * ObservationSize());
+        }
+        return true;
+    }
+
+    size_t VectorEnv::GetCount() const {
+        return count;
+    }
+
+    size_t VectorEnv::ObservationSize() const {
+        return options.observation == OBSERVATION_PACKED ? Framebuffer::SIZE : Framebuffer::WIDTH * Framebuffer::HEIGHT;
+    }
+
+    uint64_t VectorEnv::GetEpisode(size_t env) const {
+        return slots[env].episode;
+    }
+
+    Chip8 &VectorEnv::Get(size_t env) {
+        return slots[env].chip8;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef CHIP8_EMULATOR_C_VECTORENV_H
+#define CHIP8_EMULATOR_C_VECTORENV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+#include "Chip8.h"
+
+namespace Emulator {
+
+    enum ObservationFormat {
+        OBSERVATION_PACKED, //The framebuffer as is, 8 pixels per byte with the leftmost pixel in the top bit
+        OBSERVATION_BYTES //One byte per pixel, 0 or 1, row by row
+    };
+
+    //Values of the done array after a step
+    const uint8_t EPISODE_RUNNING = 0;
+    const uint8_t EPISODE_TERMINATED = 1; //The done hook returned true or the machine halted on a fault
+    const uint8_t EPISODE_TRUNCATED = 2; //The episode reached max_steps
+
+    //Score kept in RAM, the reward of a step is how much it changed times scale. Games usually store it as the
+    //decimal digits Fx33 writes, one per byte
+    struct RewardTerm {
+        uint16_t address;
+        uint8_t length = 1; //Bytes, most significant first
+        bool bcd = false; //Every byte is one decimal digit instead of 8 bits of a binary number
+        float scale = 1;
+    };
+
+    struct VectorEnvOptions {
+        int frame_skip = 4; //Frames per step, the keys of the action are held for all of them
+        int cycles_per_frame = 16;
+        ObservationFormat observation = OBSERVATION_PACKED;
+        std::vector<RewardTerm> rewards;
+        std::function<float(Chip8 &)> reward; //Added to the reward terms when set
+        std::function<bool(Chip8 &)> done; //Ends the episode when it returns true after a step
+        uint64_t max_steps = 0; //Truncates episodes after this many steps, 0 never does
+        bool halt_on_fault = false;
+        uint64_t seed = 0; //Every episode gets its own random seed derived from it, the env index and the episode
+    };
+
+    //Steps a batch of machines for reinforcement learning. An action is the key mask held during the step, the
+    //observations of all envs go into one caller provided buffer, env i at i * ObservationSize(). Finished episodes
+    //are reset right away from the cached initial state, so the observation after a done step is the first one of
+    //the next episode. Not thread safe, give every thread its own env and its own part of the buffers.
+    class VectorEnv {
+
+    private:
+        struct alignas(64) Slot {
+            Chip8 chip8;
+            double score = 0; //Value of the reward terms after the last step
+            uint64_t steps = 0;
+            uint64_t episode = 0;
+
+            Slot() : chip8(0) {}
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        size_t count;
+        VectorEnvOptions options;
+        Chip8State initial;
+
+        double Score(Chip8 &chip8) const;
+        void ResetSlot(size_t env);
+        void Observe(size_t env, uint8_t *observation) const;
+
+    public:
+        VectorEnv(size_t count, std::span<const uint8_t> rom, VectorEnvOptions options = {});
+
+        //Episodes start from state instead of the power on state, e.g. one saved past the title screen. Takes
+        //effect at the next reset
+        void SetInitialState(const Chip8State &state);
+
+        //Resets every env and writes all observations
+        bool Reset(std::span<uint8_t> observations);
+        //Resets the given envs and writes only their observations
+        bool Reset(std::span<const uint32_t> envs, std::span<uint8_t> observations);
+
+        //Runs frame_skip frames of every env with its action held. Returns false without stepping when a buffer is
+        //too small for the batch: actions, rewards and dones need GetCount() entries
+        bool Step(std::span<const uint16_t> actions, std::span<uint8_t> observations, std::span<float> rewards,
+                  std::span<uint8_t> dones);
+
+        size_t GetCount() const;
+        //Bytes per env in the observation buffer
+        size_t ObservationSize() const;
+        uint64_t GetEpisode(size_t env) const;
+        Chip8 &Get(size_t env);
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_VECTORENV_H
@@ -0,0 +1,204 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "VectorEnv.h"
+
+namespace {
+    //LD V0, 0; LD V1, K; LD F, V1; DRW V0, V0, 5; JP 0x208. Draws the digit of the pressed key in the top left corner
+    const std::vector<uint8_t> KEY_DIGIT = {0x60, 0x00, 0xF1, 0x0A, 0xF1, 0x29, 0xD0, 0x05, 0x12, 0x08};
+
+    //LD I, 0x300; loop: ADD V0, 1; LD B, V0; JP loop. Counts in V0 and keeps its decimal digits at 0x300
+    const std::vector<uint8_t> COUNTER = {0xA3, 0x00, 0x70, 0x01, 0xF0, 0x33, 0x12, 0x02};
+}
+
+TEST_CASE("Actions press keys and observations are written per env") {
+    Emulator::VectorEnvOptions options;
+    options.frame_skip = 1;
+    options.cycles_per_frame = 8;
+
+    SECTION("Packed") {
+        Emulator::VectorEnv env(3, KEY_DIGIT, options);
+        REQUIRE(env.ObservationSize() == size_t(Emulator::Framebuffer::SIZE));
+
+        std::vector<uint8_t> observations(3 * env.ObservationSize(), 0xAA);
+        REQUIRE(env.Reset(observations));
+        for (uint8_t byte : observations) REQUIRE(byte == 0);
+
+        std::vector<uint16_t> actions = {1 << 1, 1 << 7, 1 << 0xA};
+        std::vector<float> rewards(3);
+        std::vector<uint8_t> dones(3);
+        REQUIRE(env.Step(actions, observations, rewards, dones));
+
+        for (size_t i = 0; i < 3; i++) {
+            REQUIRE(env.Get(i).GetKeyState() == actions[i]);
+            REQUIRE(dones[i] == Emulator::EPISODE_RUNNING);
+            REQUIRE(rewards[i] == 0);
+
+            //The font digit is the top nibble of 5 rows
+            const uint8_t *observation = &observations[i * env.ObservationSize()];
+            int digit = i == 0 ? 1 : i == 1 ? 7 : 0xA;
+            for (int row = 0; row < 5; row++) {
+                REQUIRE(observation[row * Emulator::Framebuffer::BYTES_PER_ROW] == env.Get(i).GetMemory(digit * 5 + row));
+            }
+        }
+    }
+
+    SECTION("One byte per pixel") {
+        options.observation = Emulator::OBSERVATION_BYTES;
+        Emulator::VectorEnv env(2, KEY_DIGIT, options);
+        REQUIRE(env.ObservationSize() == Emulator::Framebuffer::WIDTH * Emulator::Framebuffer::HEIGHT);
+
+        std::vector<uint8_t> observations(2 * env.ObservationSize());
+        std::vector<uint16_t> actions = {1 << 8, 1 << 3};
+        std::vector<float> rewards(2);
+        std::vector<uint8_t> dones(2);
+        REQUIRE(env.Reset(observations));
+        REQUIRE(env.Step(actions, observations, rewards, dones));
+
+        for (size_t i = 0; i < 2; i++) {
+            const Emulator::Framebuffer &gfx = env.Get(i).GetGfx();
+            const uint8_t *observation = &observations[i * env.ObservationSize()];
+            for (int y = 0; y < Emulator::Framebuffer::HEIGHT; y++) {
+                for (int x = 0; x < Emulator::Framebuffer::WIDTH; x++) {
+                    REQUIRE(observation[y * Emulator::Framebuffer::WIDTH + x] == gfx.GetPixel(x, y));
+                }
+            }
+        }
+        REQUIRE(observations[0] == 1); //Top left pixel of the 8
+    }
+
+    SECTION("Buffers that are too small are rejected") {
+        Emulator::VectorEnv env(2, KEY_DIGIT, options);
+        std::vector<uint8_t> observations(2 * env.ObservationSize() - 1);
+        std::vector<uint16_t> actions(2);
+        std::vector<float> rewards(2);
+        std::vector<uint8_t> dones(2);
+        REQUIRE_FALSE(env.Reset(observations));
+        REQUIRE_FALSE(env.Step(actions, observations, rewards, dones));
+        REQUIRE(env.Get(0).GetProgramCounter() == 0x200);
+
+        observations.resize(2 * env.ObservationSize());
+        std::vector<uint32_t> out_of_range = {2};
+        REQUIRE_FALSE(env.Reset(out_of_range, observations));
+    }
+}
+
+TEST_CASE("Rewards follow scores in RAM and finished episodes reset") {
+    Emulator::VectorEnvOptions options;
+    options.frame_skip = 1;
+    options.cycles_per_frame = 3; //One count per step
+    options.rewards.push_back({0x300, 3, true, 0.5f});
+
+    std::vector<uint16_t> actions(2);
+    std::vector<float> rewards(2);
+    std::vector<uint8_t> dones(2);
+
+    SECTION("Rewards are score differences") {
+        Emulator::VectorEnv env(2, COUNTER, options);
+        std::vector<uint8_t> observations(2 * env.ObservationSize());
+        REQUIRE(env.Reset(observations));
+
+        for (int step = 1; step <= 20; step++) {
+            REQUIRE(env.Step(actions, observations, rewards, dones));
+            REQUIRE(rewards[0] == 0.5f);
+            REQUIRE(rewards[1] == 0.5f);
+            REQUIRE(env.Get(0).GetCpuRegister(0) == step);
+        }
+    }
+
+    SECTION("The done hook ends episodes") {
+        options.done = [](Emulator::Chip8 &chip8) { return chip8.GetCpuRegister(0) == 5; };
+        options.reward = [](Emulator::Chip8 &) { return 1.0f; };
+        Emulator::VectorEnv env(2, COUNTER, options);
+        std::vector<uint8_t> observations(2 * env.ObservationSize());
+        REQUIRE(env.Reset(observations));
+        REQUIRE(env.GetEpisode(0) == 1);
+
+        for (int step = 1; step <= 5; step++) {
+            REQUIRE(env.Step(actions, observations, rewards, dones));
+            REQUIRE(rewards[0] == 1.5f);
+            REQUIRE(dones[0] == (step == 5 ? Emulator::EPISODE_TERMINATED : Emulator::EPISODE_RUNNING));
+        }
+
+        //Reset right away, the next step is the first of the new episode
+        REQUIRE(env.GetEpisode(0) == 2);
+        REQUIRE(env.Get(0).GetCpuRegister(0) == 0);
+        REQUIRE(env.Step(actions, observations, rewards, dones));
+        REQUIRE(env.Get(0).GetCpuRegister(0) == 1);
+        REQUIRE(rewards[0] == 1.5f);
+    }
+
+    SECTION("Episodes are truncated after max_steps") {
+        options.max_steps = 3;
+        Emulator::VectorEnv env(1, COUNTER, options);
+        std::vector<uint8_t> observations(env.ObservationSize());
+        REQUIRE(env.Reset(observations));
+
+        for (int step = 1; step <= 6; step++) {
+            REQUIRE(env.Step(actions, observations, rewards, dones));
+            REQUIRE(dones[0] == (step % 3 == 0 ? Emulator::EPISODE_TRUNCATED : Emulator::EPISODE_RUNNING));
+        }
+        REQUIRE(env.GetEpisode(0) == 3);
+    }
+
+    SECTION("Selected envs reset from the initial state") {
+        Emulator::VectorEnv env(2, COUNTER, options);
+        std::vector<uint8_t> observations(2 * env.ObservationSize());
+        REQUIRE(env.Reset(observations));
+        for (int step = 0; step < 4; step++) REQUIRE(env.Step(actions, observations, rewards, dones));
+
+        //Start episodes from a machine that already counted to 100
+        Emulator::Chip8 warm(0);
+        warm.LoadRom(COUNTER);
+        warm.Run(1 + 300);
+        REQUIRE(warm.GetCpuRegister(0) == 100);
+        env.SetInitialState(warm.GetState());
+
+        std::vector<uint32_t> selected = {1};
+        REQUIRE(env.Reset(selected, observations));
+        REQUIRE(env.Get(0).GetCpuRegister(0) == 4);
+        REQUIRE(env.Get(1).GetCpuRegister(0) == 100);
+
+        //The score starts at the initial state, not at 0
+        REQUIRE(env.Step(actions, observations, rewards, dones));
+        REQUIRE(rewards[1] == 0.5f);
+    }
+}
+
+TEST_CASE("Every env and episode gets its own random seed") {
+    //RND V0, 0xFF; JP 0x202
+    const std::vector<uint8_t> random = {0xC0, 0xFF, 0x12, 0x02};
+    Emulator::VectorEnvOptions options;
+    options.frame_skip = 1;
+    options.cycles_per_frame = 1;
+    options.max_steps = 1;
+
+    auto first_numbers = [&](uint64_t seed) {
+        options.seed = seed;
+        Emulator::VectorEnv env(8, random, options);
+        std::vector<uint8_t> observations(8 * env.ObservationSize());
+        std::vector<uint16_t> actions(8);
+        std::vector<float> rewards(8);
+        std::vector<uint8_t> dones(8);
+        env.Reset(observations);
+
+        std::vector<int> numbers;
+        for (int episode = 0; episode < 4; episode++) {
+            //Every step ends the episode, so this RND is the first number of the next one
+            env.Step(actions, observations, rewards, dones);
+            for (size_t i = 0; i < 8; i++) {
+                env.Get(i).EmulateCycle();
+                numbers.push_back(env.Get(i).GetCpuRegister(0));
+            }
+        }
+        return numbers;
+    };
+
+    std::vector<int> numbers = first_numbers(1);
+    REQUIRE(numbers == first_numbers(1));
+    REQUIRE(numbers != first_numbers(2));
+
+    std::sort(numbers.begin(), numbers.end());
+    REQUIRE(std::unique(numbers.begin(), numbers.end()) - numbers.begin() > 16);
+}
@@ -0,0 +1,75 @@
+#include "VideoBackend.h"
+#include <iostream>
+
+namespace Emulator {
+
+    bool NullVideoBackend::Init() {
+        return true;
+    }
+
+    void NullVideoBackend::Present(const Framebuffer &/*framebuffer*/) {}
+
+    FrameDumpVideoBackend::FrameDumpVideoBackend(std::string path, Format format, const VideoOptions &options) :
+            path(std::move(path)), format(format), scaler(options.scale, options.palette), file(nullptr) {
+        scaler.SetScanlines(options.scanlines);
+        scaler.SetPersistence(options.persistence);
+    }
+
+    FrameDumpVideoBackend::~FrameDumpVideoBackend() {
+        if (file != nullptr && file != stdout) fclose(file);
+    }
+
+    bool FrameDumpVideoBackend::Init() {
+        file = path == "-" ? stdout : fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            std::cerr << "Can't open frame dump file " << path << std::endl;
+            return false;
+        }
+
+        if (format == Format::Ppm) {
+            char header[32];
+            int length = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", scaler.GetWidth(), scaler.GetHeight());
+            image.assign(header, header + length);
+            image.resize(length + scaler.GetWidth() * scaler.GetHeight() * 3);
+        }
+
+        return true;
+    }
+
+    void FrameDumpVideoBackend::Present(const Framebuffer &framebuffer) {
+        if (format == Format::Raw) {
+            fwrite(framebuffer.pixels.data(), 1, framebuffer.pixels.size(), file);
+            return;
+        }
+
+        size_t pixel_count = scaler.GetWidth() * scaler.GetHeight();
+        const uint32_t *pixels = scaler.Scale(framebuffer);
+        uint8_t *out = &image[image.size() - pixel_count * 3];
+
+        for (size_t i = 0; i < pixel_count; i++) {
+            *out++ = (pixels[i] >> 16) & 0xFF;
+            *out++ = (pixels[i] >> 8) & 0xFF;
+            *out++ = pixels[i] & 0xFF;
+        }
+
+        fwrite(image.data(), 1, image.size(), file);
+    }
+
+    void FrameDumpVideoBackend::SetOverlay(const std::string &text) {
+        scaler.SetOverlay(text);
+    }
+
+    std::unique_ptr<VideoBackend> CreateVideoBackend(const std::string &name, const std::string &output_path,
+                                                     const VideoOptions &options) {
+        if (name == "null") return std::unique_ptr<VideoBackend>(new NullVideoBackend());
+        if (name == "ppm") {
+            return std::unique_ptr<VideoBackend>(
+                    new FrameDumpVideoBackend(output_path, FrameDumpVideoBackend::Format::Ppm, options));
+        }
+        if (name == "raw") {
+            return std::unique_ptr<VideoBackend>(
+                    new FrameDumpVideoBackend(output_path, FrameDumpVideoBackend::Format::Raw, options));
+        }
+        return nullptr;
+    }
+}
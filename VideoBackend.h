@@ -0,0 +1,80 @@
+#ifndef CHIP8_EMULATOR_C_VIDEOBACKEND_H
+#define CHIP8_EMULATOR_C_VIDEOBACKEND_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "Chip8.h"
+#include "Framebuffer.h"
+#include "Scaler.h"
+
+namespace Emulator {
+
+    struct VideoOptions {
+        int scale;
+        Palette palette;
+        bool scanlines;
+        uint8_t persistence; //Phosphor persistence in 1/256, 0 turns it off
+    };
+
+    //Receives the emulator framebuffer once per presented frame
+    class VideoBackend {
+
+    public:
+        virtual ~VideoBackend() = default;
+
+        virtual bool Init() = 0;
+        virtual void Present(const Framebuffer &framebuffer) = 0;
+        //Text drawn over the following frames by backends that scale, see Scaler::SetOverlay
+        virtual void SetOverlay(const std::string &/*text*/) {}
+        //Window title, backends without a window ignore it
+        virtual void SetTitle(const std::string &/*title*/) {}
+
+        //Backends that own a window also deliver its input, returns true when the user wants to quit
+        virtual bool PollEvents(Chip8 &/*chip8*/) { return false; }
+        //Blocks until the next input event, used while Fx0A waits for a key
+        virtual bool WaitEvents(Chip8 &chip8) { return PollEvents(chip8); }
+
+        //Interactive backends are paced to real time, the others run as fast as possible
+        virtual bool IsInteractive() const { return false; }
+        //True while the user holds the fast forward key
+        virtual bool IsTurboHeld() const { return false; }
+    };
+
+    //Discards every frame, for benchmarks and batch runs
+    class NullVideoBackend : public VideoBackend {
+
+    public:
+        bool Init() override;
+        void Present(const Framebuffer &framebuffer) override;
+    };
+
+    //Appends every frame to a file, as binary PPM images or as the raw packed framebuffer bytes
+    class FrameDumpVideoBackend : public VideoBackend {
+
+    public:
+        enum class Format {
+            Ppm, Raw
+        };
+
+        FrameDumpVideoBackend(std::string path, Format format, const VideoOptions &options);
+        ~FrameDumpVideoBackend() override;
+
+        bool Init() override;
+        void Present(const Framebuffer &framebuffer) override;
+        void SetOverlay(const std::string &text) override;
+
+    private:
+        std::string path;
+        Format format;
+        Scaler scaler;
+        FILE *file;
+        std::vector<uint8_t> image;
+    };
+
+    //Creates the headless "null", "ppm" and "raw" backends, nullptr for unknown names
+    std::unique_ptr<VideoBackend> CreateVideoBackend(const std::string &name, const std::string &output_path,
+                                                     const VideoOptions &options);
+}
+
+#endif //CHIP8_EMULATOR_C_VIDEOBACKEND_H
@@ -0,0 +1,62 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include "VideoBackend.h"
+
+TEST_CASE("Raw frame dump writes the packed framebuffer of every frame") {
+    std::string path = "frames_test.raw";
+    Emulator::Chip8 chip8;
+    chip8.WriteToMemory(0x200, 0xD0);
+    chip8.WriteToMemory(0x201, 0x01);
+    {
+        auto backend = Emulator::CreateVideoBackend("raw", path, {1, Emulator::PALETTE_WHITE, false, 0});
+        REQUIRE(backend->Init());
+
+        backend->Present(chip8.GetGfx());
+        chip8.EmulateCycle();
+        backend->Present(chip8.GetGfx());
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> frames((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    REQUIRE(frames.size() == 2 * Emulator::Framebuffer::SIZE);
+    REQUIRE(frames[0] == 0);
+    REQUIRE(static_cast<unsigned char>(frames[Emulator::Framebuffer::SIZE]) == 0xF0);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("PPM frame dump writes scaled images") {
+    std::string path = "frames_test.ppm";
+    Emulator::Chip8 chip8;
+    chip8.WriteToMemory(0x200, 0xD0);
+    chip8.WriteToMemory(0x201, 0x01);
+    chip8.EmulateCycle();
+    {
+        auto backend = Emulator::CreateVideoBackend("ppm", path, {2, Emulator::PALETTE_WHITE, false, 0});
+        REQUIRE(backend->Init());
+        backend->Present(chip8.GetGfx());
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::string header;
+    int width, height, max_value;
+    file >> header >> width >> height >> max_value;
+    file.get();
+
+    REQUIRE(header == "P6");
+    REQUIRE(width == 128);
+    REQUIRE(height == 64);
+
+    unsigned char pixel[3];
+    file.read(reinterpret_cast<char *>(pixel), 3);
+    REQUIRE(pixel[0] == 0xFF);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Unknown video backends are rejected") {
+    REQUIRE(Emulator::CreateVideoBackend("vga", "-", {1, Emulator::PALETTE_WHITE, false, 0}) == nullptr);
+}
@@ -0,0 +1,500 @@
+#include "VideoExport.h"
+#include "BoundedQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+namespace Emulator {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        uint64_t NanosecondsSince(Clock::time_point start) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        }
+
+        //Spins a while for the short waits between frames, then sleeps until value changes, so threads that wait
+        //for a slow emulator or a slow disk don't burn a core. Whoever changes what done() looks at bumps value and
+        //notifies it afterwards
+        template<typename Done>
+        void WaitUntil(const std::atomic<uint64_t> &value, Done done) {
+            const int SPIN_LIMIT = 64;
+            for (int spins = 0;; spins++) {
+                uint64_t seen = value.load(std::memory_order_acquire);
+                if (done()) return;
+                if (spins < SPIN_LIMIT) std::this_thread::yield();
+                else value.wait(seen, std::memory_order_acquire);
+            }
+        }
+
+        void PutBigEndian32(std::vector<uint8_t> *out, uint32_t value) {
+            for (int shift = 24; shift >= 0; shift -= 8) out->push_back(static_cast<uint8_t>(value >> shift));
+        }
+
+        void PutLittleEndian16(std::vector<uint8_t> *out, uint16_t value) {
+            out->push_back(static_cast<uint8_t>(value));
+            out->push_back(static_cast<uint8_t>(value >> 8));
+        }
+
+        //Scratch for the scaled pixels, one per worker
+        thread_local std::vector<uint8_t> indices;
+
+        //One byte per output pixel, 1 for lit
+        void ScaleIndices(const Framebuffer &frame, int scale, std::vector<uint8_t> *out) {
+            int width = Framebuffer::WIDTH * scale;
+            out->resize(size_t(width) * Framebuffer::HEIGHT * scale);
+            uint8_t *pixel = out->data();
+            for (int y = 0; y < Framebuffer::HEIGHT; y++) {
+                uint8_t *row = pixel;
+                for (int x = 0; x < Framebuffer::WIDTH; x++) {
+                    uint8_t lit = frame.GetPixel(x, y);
+                    for (int i = 0; i < scale; i++) *pixel++ = lit;
+                }
+                for (int i = 1; i < scale; i++, pixel += width) std::copy(row, row + width, pixel);
+            }
+        }
+
+        //Every frame is encoded on its own by Encode(), which runs on the workers. Begin(), Write() and Finish()
+        //run on the writer thread in frame order and add what depends on the frames before
+        class FrameEncoder {
+
+        protected:
+            int scale;
+            int width;
+            int height;
+            Palette palette;
+            int frames_per_second;
+
+        public:
+            explicit FrameEncoder(const ExportOptions &options) :
+                    scale(std::min(std::max(options.scale, 1), 64)), width(Framebuffer::WIDTH * scale),
+                    height(Framebuffer::HEIGHT * scale), palette(options.palette),
+                    frames_per_second(std::max(options.frames_per_second, 1)) {}
+            virtual ~FrameEncoder() = default;
+
+            virtual void Begin(uint64_t frames, std::vector<uint8_t> *out) = 0;
+            virtual void Encode(uint64_t index, const Framebuffer &frame, std::vector<uint8_t> *out) const = 0;
+            virtual void Write(uint64_t /*index*/, const std::vector<uint8_t> &encoded, std::vector<uint8_t> *out) {
+                out->insert(out->end(), encoded.begin(), encoded.end());
+            }
+            virtual void Finish(std::vector<uint8_t> * /*out*/) {}
+        };
+
+        class Y4mEncoder : public FrameEncoder {
+
+        private:
+            uint8_t planes[3][2]; //Y, U and V of the unlit and lit color
+
+        public:
+            explicit Y4mEncoder(const ExportOptions &options) : FrameEncoder(options) {
+                //BT.601 with the limited range players expect
+                for (int lit = 0; lit < 2; lit++) {
+                    uint32_t color = lit ? palette.on : palette.off;
+                    int r = (color >> 16) & 0xFF, g = (color >> 8) & 0xFF, b = color & 0xFF;
+                    planes[0][lit] = static_cast<uint8_t>(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+                    planes[1][lit] = static_cast<uint8_t>(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+                    planes[2][lit] = static_cast<uint8_t>(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+                }
+            }
+
+            void Begin(uint64_t /*frames*/, std::vector<uint8_t> *out) override {
+                char header[64];
+                int length = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height,
+                                      frames_per_second);
+                out->insert(out->end(), header, header + length);
+            }
+
+            void Encode(uint64_t /*index*/, const Framebuffer &frame, std::vector<uint8_t> *out) const override {
+                ScaleIndices(frame, scale, &indices);
+                const char marker[] = "FRAME\n";
+                out->resize(sizeof(marker) - 1 + 3 * indices.size());
+                uint8_t *pixel = std::copy(marker, marker + sizeof(marker) - 1, out->data());
+                for (const auto &plane : planes) {
+                    for (uint8_t lit : indices) *pixel++ = plane[lit];
+                }
+            }
+        };
+
+        class GifEncoder : public FrameEncoder {
+
+        private:
+            static const int MIN_CODE_SIZE = 2; //GIF doesn't allow less even for two colors
+            static const int CLEAR = 1 << MIN_CODE_SIZE;
+            static const int MAX_CODE = 4095;
+
+            //LZW codes packed least significant bit first, split into sub-blocks of up to 255 bytes
+            struct BitWriter {
+                std::vector<uint8_t> *out;
+                std::vector<uint8_t> block;
+                uint32_t bits = 0;
+                int count = 0;
+
+                void Put(int code, int size) {
+                    bits |= uint32_t(code) << count;
+                    count += size;
+                    while (count >= 8) {
+                        Byte(static_cast<uint8_t>(bits));
+                        bits >>= 8;
+                        count -= 8;
+                    }
+                }
+
+                void Byte(uint8_t byte) {
+                    block.push_back(byte);
+                    if (block.size() == 255) Flush();
+                }
+
+                void Flush() {
+                    if (block.empty()) return;
+                    out->push_back(static_cast<uint8_t>(block.size()));
+                    out->insert(out->end(), block.begin(), block.end());
+                    block.clear();
+                }
+
+                void Finish() {
+                    if (count > 0) Byte(static_cast<uint8_t>(bits));
+                    Flush();
+                    out->push_back(0);
+                }
+            };
+
+        public:
+            explicit GifEncoder(const ExportOptions &options) : FrameEncoder(options) {}
+
+            void Begin(uint64_t /*frames*/, std::vector<uint8_t> *out) override {
+                const char signature[] = "GIF89a";
+                out->insert(out->end(), signature, signature + 6);
+                PutLittleEndian16(out, static_cast<uint16_t>(width));
+                PutLittleEndian16(out, static_cast<uint16_t>(height));
+                out->insert(out->end(), {0xF0, 0, 0}); //Global table of 2 colors
+                for (uint32_t color : {palette.off, palette.on}) {
+                    out->insert(out->end(), {static_cast<uint8_t>(color >> 16), static_cast<uint8_t>(color >> 8),
+                                             static_cast<uint8_t>(color)});
+                }
+                //Loops forever
+                const uint8_t loop[] = {0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03,
+                                        0x01, 0x00, 0x00, 0x00};
+                out->insert(out->end(), loop, loop + sizeof(loop));
+            }
+
+            void Encode(uint64_t index, const Framebuffer &frame, std::vector<uint8_t> *out) const override {
+                out->clear();
+
+                //Delays are in 1/100 s, rounding each frame's end keeps the average exact
+                uint64_t fps = frames_per_second;
+                auto delay = static_cast<uint16_t>((index + 1) * 100 / fps - index * 100 / fps);
+                out->insert(out->end(), {0x21, 0xF9, 0x04, 0x00});
+                PutLittleEndian16(out, delay);
+                out->insert(out->end(), {0x00, 0x00, 0x2C, 0, 0, 0, 0});
+                PutLittleEndian16(out, static_cast<uint16_t>(width));
+                PutLittleEndian16(out, static_cast<uint16_t>(height));
+                out->insert(out->end(), {0x00, MIN_CODE_SIZE});
+
+                ScaleIndices(frame, scale, &indices);
+
+                //Code table as a tree, children[code * 4 + symbol] is the code of that string plus the symbol
+                std::vector<int16_t> children((MAX_CODE + 1) * 4, -1);
+                BitWriter writer{out, {}, 0, 0};
+                int code_size = MIN_CODE_SIZE + 1;
+                int last_code = CLEAR + 1;
+                writer.Put(CLEAR, code_size);
+
+                int prefix = indices[0];
+                for (size_t i = 1; i < indices.size(); i++) {
+                    uint8_t symbol = indices[i];
+                    int16_t &child = children[prefix * 4 + symbol];
+                    if (child >= 0) {
+                        prefix = child;
+                        continue;
+                    }
+
+                    writer.Put(prefix, code_size);
+                    child = static_cast<int16_t>(++last_code);
+                    if (last_code >= (1 << code_size)) code_size++;
+                    if (last_code == MAX_CODE) {
+                        writer.Put(CLEAR, code_size);
+                        std::fill(children.begin(), children.end(), -1);
+                        code_size = MIN_CODE_SIZE + 1;
+                        last_code = CLEAR + 1;
+                    }
+                    prefix = symbol;
+                }
+                writer.Put(prefix, code_size);
+                writer.Put(CLEAR + 1, code_size);
+                writer.Finish();
+            }
+
+            void Finish(std::vector<uint8_t> *out) override {
+                out->push_back(0x3B);
+            }
+        };
+
+        class ApngEncoder : public FrameEncoder {
+
+        private:
+            uint32_t sequence = 0;
+
+            static void Chunk(const char *type, const std::vector<uint8_t> &data, std::vector<uint8_t> *out) {
+                PutBigEndian32(out, static_cast<uint32_t>(data.size()));
+                size_t start = out->size();
+                out->insert(out->end(), type, type + 4);
+                out->insert(out->end(), data.begin(), data.end());
+                PutBigEndian32(out, static_cast<uint32_t>(crc32(0, out->data() + start, out->size() - start)));
+            }
+
+        public:
+            explicit ApngEncoder(const ExportOptions &options) : FrameEncoder(options) {}
+
+            void Begin(uint64_t frames, std::vector<uint8_t> *out) override {
+                const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+                out->insert(out->end(), signature, signature + sizeof(signature));
+
+                std::vector<uint8_t> data;
+                PutBigEndian32(&data, width);
+                PutBigEndian32(&data, height);
+                data.insert(data.end(), {1, 3, 0, 0, 0}); //1 bit palette indices
+                Chunk("IHDR", data, out);
+
+                data.clear();
+                PutBigEndian32(&data, static_cast<uint32_t>(frames));
+                PutBigEndian32(&data, 0); //Loops forever
+                Chunk("acTL", data, out);
+
+                data.clear();
+                for (uint32_t color : {palette.off, palette.on}) {
+                    data.insert(data.end(), {static_cast<uint8_t>(color >> 16), static_cast<uint8_t>(color >> 8),
+                                             static_cast<uint8_t>(color)});
+                }
+                Chunk("PLTE", data, out);
+            }
+
+            void Encode(uint64_t /*index*/, const Framebuffer &frame, std::vector<uint8_t> *out) const override {
+                ScaleIndices(frame, scale, &indices);
+
+                //Rows of 8 pixels per byte, each after a filter type byte of 0
+                size_t row_bytes = (width + 7) / 8;
+                std::vector<uint8_t> raw(height * (row_bytes + 1), 0);
+                for (int y = 0; y < height; y++) {
+                    uint8_t *row = &raw[y * (row_bytes + 1) + 1];
+                    const uint8_t *lit = &indices[size_t(y) * width];
+                    for (int x = 0; x < width; x++) row[x >> 3] |= lit[x] << (7 - (x & 7));
+                }
+
+                uLongf length = compressBound(raw.size());
+                out->resize(length);
+                compress2(out->data(), &length, raw.data(), raw.size(), Z_DEFAULT_COMPRESSION);
+                out->resize(length);
+            }
+
+            void Write(uint64_t index, const std::vector<uint8_t> &encoded, std::vector<uint8_t> *out) override {
+                std::vector<uint8_t> control;
+                PutBigEndian32(&control, sequence++);
+                PutBigEndian32(&control, width);
+                PutBigEndian32(&control, height);
+                PutBigEndian32(&control, 0);
+                PutBigEndian32(&control, 0);
+                control.insert(control.end(), {0, 1, static_cast<uint8_t>(frames_per_second >> 8),
+                                               static_cast<uint8_t>(frames_per_second), 0, 0});
+                Chunk("fcTL", control, out);
+
+                //The first frame is the default image older viewers show
+                if (index == 0) {
+                    Chunk("IDAT", encoded, out);
+                    return;
+                }
+                std::vector<uint8_t> data;
+                PutBigEndian32(&data, sequence++);
+                data.insert(data.end(), encoded.begin(), encoded.end());
+                Chunk("fdAT", data, out);
+            }
+
+            void Finish(std::vector<uint8_t> *out) override {
+                Chunk("IEND", {}, out);
+            }
+        };
+
+        std::unique_ptr<FrameEncoder> CreateEncoder(const ExportOptions &options) {
+            switch (options.format) {
+                case ExportFormat::Y4m:
+                    return std::unique_ptr<FrameEncoder>(new Y4mEncoder(options));
+                case ExportFormat::Gif:
+                    return std::unique_ptr<FrameEncoder>(new GifEncoder(options));
+                case ExportFormat::Apng:
+                    return std::unique_ptr<FrameEncoder>(new ApngEncoder(options));
+            }
+            return nullptr;
+        }
+
+        struct RawFrame {
+            uint64_t index;
+            Framebuffer frame;
+        };
+
+        //Encoded frames on their way to the writer. A slot is free for frame i when its sequence is 2 * i and
+        //holds it when it is 2 * i + 1, the writer frees it for the frame a ring further on
+        struct alignas(64) EncodedSlot {
+            std::atomic<uint64_t> sequence;
+            std::vector<uint8_t> data;
+        };
+    }
+
+    bool ExportFormatFromPath(const std::string &path, ExportFormat *format) {
+        size_t dot = path.rfind('.');
+        if (dot == std::string::npos) return false;
+
+        std::string extension = path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == "y4m") *format = ExportFormat::Y4m;
+        else if (extension == "gif") *format = ExportFormat::Gif;
+        else if (extension == "png" || extension == "apng") *format = ExportFormat::Apng;
+        else return false;
+        return true;
+    }
+
+    bool ExportVideo(Chip8 &chip8, const InputLog *input, uint64_t frames, const std::string &path,
+                     const ExportOptions &options, ExportStats *stats) {
+        FILE *file = path == "-" ? stdout : fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        auto start = Clock::now();
+        std::unique_ptr<FrameEncoder> encoder = CreateEncoder(options);
+        int worker_count = std::max(options.workers, 1);
+        BoundedQueue<RawFrame> queue(std::max<size_t>(options.queue_frames, 1));
+        //Room for every frame that can be between the emulator and the writer, so a worker never waits for a slot
+        //that only a waiting worker could free
+        std::vector<EncodedSlot> slots(queue.GetCapacity() + worker_count);
+        for (size_t i = 0; i < slots.size(); i++) slots[i].sequence.store(2 * i, std::memory_order_relaxed);
+
+        std::atomic<bool> emulated(false);
+        std::atomic<uint64_t> encode_nanoseconds(0);
+        //Bumped after every push and once more after the last one, and after every pop, for WaitUntil()
+        std::atomic<uint64_t> pushes(0), pops(0);
+        auto bump = [](std::atomic<uint64_t> &counter) {
+            counter.fetch_add(1, std::memory_order_release);
+            counter.notify_all();
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < worker_count; i++) {
+            workers.emplace_back([&]() {
+                RawFrame raw;
+                std::vector<uint8_t> encoded;
+                uint64_t busy = 0;
+                while (true) {
+                    bool popped = false;
+                    WaitUntil(pushes, [&]() {
+                        popped = queue.TryPop(&raw);
+                        return popped || emulated.load(std::memory_order_acquire);
+                    });
+                    //The flag is set after the last push, so popping once more after seeing it misses nothing
+                    if (!popped && !queue.TryPop(&raw)) break;
+                    bump(pops);
+
+                    auto before = Clock::now();
+                    encoder->Encode(raw.index, raw.frame, &encoded);
+                    busy += NanosecondsSince(before);
+
+                    EncodedSlot &slot = slots[raw.index % slots.size()];
+                    WaitUntil(slot.sequence, [&]() {
+                        return slot.sequence.load(std::memory_order_acquire) == 2 * raw.index;
+                    });
+                    slot.data.swap(encoded);
+                    slot.sequence.store(2 * raw.index + 1, std::memory_order_release);
+                    slot.sequence.notify_all();
+                }
+                encode_nanoseconds += busy;
+            });
+        }
+
+        uint64_t write_nanoseconds = 0, bytes = 0;
+        bool written = true;
+        std::thread writer([&]() {
+            std::vector<uint8_t> out;
+            auto write = [&]() {
+                written = fwrite(out.data(), 1, out.size(), file) == out.size() && written;
+                bytes += out.size();
+                out.clear();
+            };
+
+            auto before = Clock::now();
+            encoder->Begin(frames, &out);
+            write();
+            write_nanoseconds += NanosecondsSince(before);
+
+            for (uint64_t index = 0; index < frames; index++) {
+                EncodedSlot &slot = slots[index % slots.size()];
+                WaitUntil(slot.sequence, [&]() {
+                    return slot.sequence.load(std::memory_order_acquire) == 2 * index + 1;
+                });
+
+                before = Clock::now();
+                encoder->Write(index, slot.data, &out);
+                slot.sequence.store(2 * (index + slots.size()), std::memory_order_release);
+                slot.sequence.notify_all();
+                write();
+                write_nanoseconds += NanosecondsSince(before);
+            }
+
+            before = Clock::now();
+            encoder->Finish(&out);
+            write();
+            fflush(file);
+            write_nanoseconds += NanosecondsSince(before);
+        });
+
+        //Runs up to each frame's vblank like the frontend's pipeline does, split where the recorded keys change
+        static const std::vector<InputLog::Change> no_changes;
+        const std::vector<InputLog::Change> &changes = input ? input->GetChanges() : no_changes;
+        size_t next_change = 0;
+        uint64_t cycle = 0, emulate_nanoseconds = 0, queue_full = 0;
+        uint64_t cycles_per_second = std::max(options.cycles_per_second, 1);
+        uint64_t frames_per_second = std::max(options.frames_per_second, 1);
+
+        RawFrame raw;
+        for (uint64_t index = 0; index < frames; index++) {
+            auto before = Clock::now();
+            uint64_t vblank = ((index + 1) * cycles_per_second + frames_per_second - 1) / frames_per_second;
+            while (cycle < vblank) {
+                while (next_change < changes.size() && changes[next_change].cycle <= cycle) {
+                    chip8.SetKeyState(changes[next_change++].keys);
+                }
+                uint64_t until = vblank;
+                if (next_change < changes.size()) until = std::min(until, changes[next_change].cycle);
+                chip8.Run(until - cycle);
+                cycle = until;
+            }
+            raw.index = index;
+            raw.frame = chip8.GetGfx();
+            emulate_nanoseconds += NanosecondsSince(before);
+
+            if (!queue.TryPush(raw)) {
+                queue_full++;
+                WaitUntil(pops, [&]() { return queue.TryPush(raw); });
+            }
+            bump(pushes);
+        }
+        emulated.store(true, std::memory_order_release);
+        bump(pushes);
+
+        for (auto &worker : workers) worker.join();
+        writer.join();
+        if (file != stdout) written = fclose(file) == 0 && written;
+
+        if (stats) {
+            stats->frames = frames;
+            stats->bytes = bytes;
+            stats->workers = worker_count;
+            stats->wall_nanoseconds = NanosecondsSince(start);
+            stats->emulate_nanoseconds = emulate_nanoseconds;
+            stats->encode_nanoseconds = encode_nanoseconds.load();
+            stats->write_nanoseconds = write_nanoseconds;
+            stats->queue_full = queue_full;
+        }
+        return written;
+    }
+}
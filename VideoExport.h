@@ -0,0 +1,51 @@
+#ifndef CHIP8_EMULATOR_C_VIDEOEXPORT_H
+#define CHIP8_EMULATOR_C_VIDEOEXPORT_H
+
+#include <cstdint>
+#include <string>
+#include "Chip8.h"
+#include "InputLog.h"
+#include "Scaler.h"
+
+namespace Emulator {
+
+    enum class ExportFormat {
+        Y4m, //Uncompressed YUV 4:4:4 for video encoders
+        Gif, //Looping animated GIF, frame delays rounded to 1/100 s
+        Apng //Animated PNG with a 1 bit palette
+    };
+
+    //Picks the format from the extension of path: .y4m, .gif, .png or .apng
+    bool ExportFormatFromPath(const std::string &path, ExportFormat *format);
+
+    struct ExportOptions {
+        ExportFormat format = ExportFormat::Apng;
+        int scale = 4;
+        Palette palette = PALETTE_WHITE;
+        int workers = 2; //Encoder threads
+        size_t queue_frames = 64; //Frames emulated ahead of the encoders
+        int cycles_per_second = 1000;
+        int frames_per_second = 60;
+    };
+
+    struct ExportStats {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        int workers = 0;
+        uint64_t wall_nanoseconds = 0;
+        uint64_t emulate_nanoseconds = 0; //Running the machine, not counting waits for room in the queue
+        uint64_t encode_nanoseconds = 0; //Summed over the workers
+        uint64_t write_nanoseconds = 0;
+        uint64_t queue_full = 0; //Frames that waited for room in the queue, encoding was the slower stage then
+    };
+
+    //Runs chip8 for frames frames as fast as it can and writes every frame to path, "-" writes to stdout. The keys
+    //of input are pressed at their cycles, so chip8 should be freshly loaded with the log's seed.
+    //The stages overlap: this thread emulates and passes the frames through a bounded lock-free queue to the
+    //encoder workers, which compress frames independently of each other and hand them to a writer thread that puts
+    //them into the file in order. Throughput is limited by the slowest stage, stats tells which one it was.
+    bool ExportVideo(Chip8 &chip8, const InputLog *input, uint64_t frames, const std::string &path,
+                     const ExportOptions &options, ExportStats *stats = nullptr);
+}
+
+#endif //CHIP8_EMULATOR_C_VIDEOEXPORT_H
@@ -0,0 +1,366 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "BoundedQueue.h"
+#include "FramePipeline.h"
+#include "InputLog.h"
+#include "VideoExport.h"
+
+namespace {
+    //Clears the screen and draws the font sprite of 0 one pixel further right and down on every pass
+    const std::vector<uint8_t> MOVING = {0xA0, 0x00, 0x00, 0xE0, 0xD0, 0x05, 0x70, 0x01, 0x12, 0x02};
+
+    //Moves the sprite only while key 0 is held
+    const std::vector<uint8_t> KEY_MOVES = {0xA0, 0x00, 0xE1, 0xA1, 0x70, 0x01, 0x00, 0xE0, 0xD0, 0x05, 0x12, 0x02};
+
+    std::vector<uint8_t> ReadFile(const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    uint32_t BigEndian32(const uint8_t *in) {
+        return uint32_t(in[0]) << 24 | uint32_t(in[1]) << 16 | uint32_t(in[2]) << 8 | in[3];
+    }
+
+    //The frames the frontend would present, stepping every cycle and pressing each change's keys before its cycle
+    std::vector<Emulator::Framebuffer> Reference(const std::vector<uint8_t> &rom, uint64_t frames,
+                                                 const Emulator::InputLog &input) {
+        Emulator::Chip8 chip8(input.GetSeed());
+        chip8.LoadRom(rom);
+        Emulator::FramePipeline pipeline(1000, 60);
+        std::vector<Emulator::Framebuffer> presented;
+        size_t next_change = 0;
+        for (uint64_t cycle = 0; presented.size() < frames; cycle++) {
+            const auto &changes = input.GetChanges();
+            while (next_change < changes.size() && changes[next_change].cycle <= cycle) {
+                chip8.SetKeyState(changes[next_change++].keys);
+            }
+            chip8.EmulateCycle();
+            if (pipeline.Cycle(chip8.GetGfx())) presented.push_back(pipeline.GetFrame());
+        }
+        return presented;
+    }
+
+    //One byte per scaled pixel like the encoders see them
+    std::vector<uint8_t> Scaled(const Emulator::Framebuffer &frame, int scale) {
+        std::vector<uint8_t> pixels;
+        for (int y = 0; y < Emulator::Framebuffer::HEIGHT * scale; y++) {
+            for (int x = 0; x < Emulator::Framebuffer::WIDTH * scale; x++) {
+                pixels.push_back(frame.GetPixel(x / scale, y / scale));
+            }
+        }
+        return pixels;
+    }
+
+    void Export(const std::vector<uint8_t> &rom, uint64_t frames, const Emulator::InputLog *input,
+                const Emulator::ExportOptions &options, const std::string &path) {
+        Emulator::Chip8 chip8(input ? input->GetSeed() : 0);
+        chip8.LoadRom(rom);
+        Emulator::ExportStats stats;
+        REQUIRE(Emulator::ExportVideo(chip8, input, frames, path, options, &stats));
+        REQUIRE(stats.frames == frames);
+        REQUIRE(stats.bytes == ReadFile(path).size());
+        REQUIRE(stats.workers == options.workers);
+    }
+
+    //Each frame's Y plane, lit pixels are the brighter ones
+    std::vector<std::vector<uint8_t>> DecodeY4m(const std::vector<uint8_t> &file, int scale) {
+        std::string text(file.begin(), file.end());
+        size_t header_end = text.find('\n');
+        char expected[64];
+        snprintf(expected, sizeof(expected), "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444", 64 * scale, 32 * scale);
+        REQUIRE(text.substr(0, header_end) == expected);
+
+        size_t plane = size_t(64 * scale) * 32 * scale;
+        std::vector<std::vector<uint8_t>> frames;
+        for (size_t position = header_end + 1; position < file.size(); position += 6 + 3 * plane) {
+            REQUIRE(text.substr(position, 6) == "FRAME\n");
+            std::vector<uint8_t> pixels;
+            for (size_t i = 0; i < plane; i++) pixels.push_back(file[position + 6 + i] > 128);
+            frames.push_back(pixels);
+        }
+        return frames;
+    }
+
+    //A plain GIF decoder for the subset the exporter writes: a global table and full frames
+    std::vector<std::vector<uint8_t>> DecodeGif(const std::vector<uint8_t> &file, int scale,
+                                                std::vector<int> *delays) {
+        REQUIRE(std::string(file.begin(), file.begin() + 6) == "GIF89a");
+        REQUIRE((file[6] | file[7] << 8) == 64 * scale);
+        REQUIRE((file[8] | file[9] << 8) == 32 * scale);
+        REQUIRE(file[10] == 0xF0);
+
+        std::vector<std::vector<uint8_t>> frames;
+        size_t position = 13 + 6;
+        while (file.at(position) != 0x3B) {
+            if (file[position] == 0x21) {
+                if (file[position + 1] == 0xF9) delays->push_back(file[position + 4] | file[position + 5] << 8);
+                position += 2;
+                while (file.at(position) != 0) position += file[position] + 1;
+                position++;
+                continue;
+            }
+            REQUIRE(file[position] == 0x2C);
+            int min_code_size = file.at(position + 10);
+            position += 11;
+
+            std::vector<uint8_t> data;
+            while (file.at(position) != 0) {
+                data.insert(data.end(), file.begin() + position + 1, file.begin() + position + 1 + file[position]);
+                position += file[position] + 1;
+            }
+            position++;
+
+            int clear = 1 << min_code_size, end = clear + 1;
+            std::vector<std::vector<uint8_t>> table;
+            int code_size = min_code_size + 1;
+            std::vector<uint8_t> pixels, previous;
+            size_t bit = 0;
+            while (true) {
+                int code = 0;
+                for (int i = 0; i < code_size; i++, bit++) code |= ((data.at(bit / 8) >> (bit % 8)) & 1) << i;
+
+                if (code == clear) {
+                    table.clear();
+                    for (int i = 0; i < clear + 2; i++) table.push_back({static_cast<uint8_t>(i)});
+                    code_size = min_code_size + 1;
+                    previous.clear();
+                    continue;
+                }
+                if (code == end) break;
+
+                std::vector<uint8_t> entry;
+                if (code < int(table.size())) {
+                    entry = table[code];
+                } else {
+                    REQUIRE(code == int(table.size()));
+                    entry = previous;
+                    entry.push_back(previous[0]);
+                }
+                pixels.insert(pixels.end(), entry.begin(), entry.end());
+                if (!previous.empty() && table.size() < 4096) {
+                    previous.push_back(entry[0]);
+                    table.push_back(previous);
+                    if (table.size() == (1u << code_size) && code_size < 12) code_size++;
+                }
+                previous = entry;
+            }
+            frames.push_back(pixels);
+        }
+        return frames;
+    }
+
+    //Checks the chunk structure and sequence numbers and inflates every frame
+    std::vector<std::vector<uint8_t>> DecodeApng(const std::vector<uint8_t> &file, int scale, uint32_t *frame_count) {
+        const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        REQUIRE(memcmp(file.data(), signature, 8) == 0);
+
+        int width = 64 * scale, height = 32 * scale;
+        size_t row_bytes = (width + 7) / 8;
+        std::vector<std::vector<uint8_t>> frames;
+        uint32_t sequence = 0;
+        for (size_t position = 8; position < file.size();) {
+            uint32_t length = BigEndian32(&file[position]);
+            std::string type(file.begin() + position + 4, file.begin() + position + 8);
+            const uint8_t *data = &file[position + 8];
+            REQUIRE(BigEndian32(data + length) == crc32(0, &file[position + 4], length + 4));
+            position += 12 + length;
+
+            if (type == "IHDR") {
+                REQUIRE(BigEndian32(data) == uint32_t(width));
+                REQUIRE(BigEndian32(data + 4) == uint32_t(height));
+                REQUIRE(data[8] == 1);
+                REQUIRE(data[9] == 3);
+            } else if (type == "acTL") {
+                *frame_count = BigEndian32(data);
+            } else if (type == "fcTL") {
+                REQUIRE(BigEndian32(data) == sequence++);
+            } else if (type == "IDAT" || type == "fdAT") {
+                if (type == "fdAT") {
+                    REQUIRE(BigEndian32(data) == sequence++);
+                    data += 4;
+                    length -= 4;
+                }
+                std::vector<uint8_t> raw(height * (row_bytes + 1));
+                uLongf raw_length = raw.size();
+                REQUIRE(uncompress(raw.data(), &raw_length, data, length) == Z_OK);
+                REQUIRE(raw_length == raw.size());
+
+                std::vector<uint8_t> pixels;
+                for (int y = 0; y < height; y++) {
+                    REQUIRE(raw[y * (row_bytes + 1)] == 0);
+                    for (int x = 0; x < width; x++) {
+                        pixels.push_back((raw[y * (row_bytes + 1) + 1 + x / 8] >> (7 - x % 8)) & 1);
+                    }
+                }
+                frames.push_back(pixels);
+            } else {
+                REQUIRE((type == "PLTE" || type == "IEND"));
+            }
+        }
+        return frames;
+    }
+}
+
+TEST_CASE("Bounded queue hands every value to exactly one consumer") {
+    Emulator::BoundedQueue<int> queue(3);
+    REQUIRE(queue.GetCapacity() == 4);
+    for (int i = 0; i < 4; i++) REQUIRE(queue.TryPush(i));
+    REQUIRE_FALSE(queue.TryPush(4));
+    int value;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(queue.TryPop(&value));
+        REQUIRE(value == i);
+    }
+    REQUIRE_FALSE(queue.TryPop(&value));
+
+    //Two producers and two consumers through a small queue
+    const int COUNT = 20000;
+    Emulator::BoundedQueue<int> shared(8);
+    std::vector<std::thread> threads;
+    std::vector<long long> sums(2, 0);
+    std::vector<int> popped(2, 0);
+    for (int producer = 0; producer < 2; producer++) {
+        threads.emplace_back([&shared, producer]() {
+            for (int i = 1; i <= COUNT; i++) {
+                while (!shared.TryPush(producer == 0 ? i : -i)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int consumer = 0; consumer < 2; consumer++) {
+        threads.emplace_back([&, consumer]() {
+            int received;
+            while (popped[0] + popped[1] < 2 * COUNT) {
+                if (!shared.TryPop(&received)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                sums[consumer] += received > 0 ? received : 0;
+                popped[consumer]++;
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    REQUIRE(popped[0] + popped[1] == 2 * COUNT);
+    REQUIRE(sums[0] + sums[1] == (long long) COUNT * (COUNT + 1) / 2);
+}
+
+TEST_CASE("Input log keeps only changes and round trips through a file") {
+    Emulator::InputLog log(12345678901234ULL);
+    log.Record(0, 0);
+    log.Record(10, 0x0001);
+    log.Record(11, 0x0001);
+    log.Record(20, 0x8001);
+    log.Record(20, 0xF000);
+    log.Record(30, 0);
+    REQUIRE(log.GetChanges().size() == 3);
+    REQUIRE(log.GetChanges()[1].keys == 0xF000);
+
+    const char *path = "input_log_test.txt";
+    REQUIRE(log.Save(path));
+    Emulator::InputLog loaded;
+    REQUIRE(loaded.Load(path));
+    REQUIRE(loaded.GetSeed() == 12345678901234ULL);
+    REQUIRE(loaded.GetChanges().size() == 3);
+    for (size_t i = 0; i < 3; i++) {
+        REQUIRE(loaded.GetChanges()[i].cycle == log.GetChanges()[i].cycle);
+        REQUIRE(loaded.GetChanges()[i].keys == log.GetChanges()[i].keys);
+    }
+
+    FILE *file = fopen(path, "w");
+    fputs("seed 1\n5 1\n4 2\n", file);
+    fclose(file);
+    REQUIRE_FALSE(loaded.Load(path));
+    REQUIRE(loaded.GetSeed() == 12345678901234ULL);
+    remove(path);
+}
+
+TEST_CASE("Exported videos hold the frames the frontend presents") {
+    const uint64_t FRAMES = 40;
+    Emulator::InputLog no_input;
+    std::vector<Emulator::Framebuffer> expected = Reference(MOVING, FRAMES, no_input);
+
+    for (int scale : {1, 3}) {
+        Emulator::ExportOptions options;
+        options.scale = scale;
+        options.workers = 3;
+        options.queue_frames = 4;
+        options.palette = Emulator::PALETTE_AMBER;
+
+        options.format = Emulator::ExportFormat::Y4m;
+        Export(MOVING, FRAMES, nullptr, options, "export_test.y4m");
+        auto y4m = DecodeY4m(ReadFile("export_test.y4m"), scale);
+
+        options.format = Emulator::ExportFormat::Gif;
+        Export(MOVING, FRAMES, nullptr, options, "export_test.gif");
+        std::vector<int> delays;
+        auto gif = DecodeGif(ReadFile("export_test.gif"), scale, &delays);
+
+        options.format = Emulator::ExportFormat::Apng;
+        Export(MOVING, FRAMES, nullptr, options, "export_test.png");
+        uint32_t frame_count = 0;
+        auto apng = DecodeApng(ReadFile("export_test.png"), scale, &frame_count);
+
+        REQUIRE(y4m.size() == FRAMES);
+        REQUIRE(gif.size() == FRAMES);
+        REQUIRE(apng.size() == FRAMES);
+        REQUIRE(frame_count == FRAMES);
+        for (uint64_t frame = 0; frame < FRAMES; frame++) {
+            std::vector<uint8_t> pixels = Scaled(expected[frame], scale);
+            REQUIRE(y4m[frame] == pixels);
+            REQUIRE(gif[frame] == pixels);
+            REQUIRE(apng[frame] == pixels);
+        }
+
+        //60 frames take a second in 1/100 s steps
+        REQUIRE(delays.size() == FRAMES);
+        int total = 0;
+        for (int i = 0; i < 30; i++) total += delays[i];
+        REQUIRE(total == 50);
+    }
+    remove("export_test.y4m");
+    remove("export_test.gif");
+    remove("export_test.png");
+}
+
+TEST_CASE("Exported files don't depend on the number of workers") {
+    std::vector<uint8_t> files[2];
+    for (int workers : {1, 4}) {
+        Emulator::ExportOptions options;
+        options.format = Emulator::ExportFormat::Gif;
+        options.workers = workers;
+        options.queue_frames = 2;
+        Export(MOVING, 100, nullptr, options, "export_workers.gif");
+        files[workers == 4] = ReadFile("export_workers.gif");
+    }
+    REQUIRE(files[0] == files[1]);
+    remove("export_workers.gif");
+}
+
+TEST_CASE("Export replays recorded keys at their cycles") {
+    const uint64_t FRAMES = 30;
+    Emulator::InputLog input(99);
+    input.Record(50, 0x0001);
+    input.Record(123, 0);
+    input.Record(300, 0x0001);
+    input.Record(301, 0);
+
+    Emulator::ExportOptions options;
+    options.format = Emulator::ExportFormat::Y4m;
+    options.scale = 1;
+    Export(KEY_MOVES, FRAMES, &input, options, "export_input.y4m");
+    auto frames = DecodeY4m(ReadFile("export_input.y4m"), 1);
+
+    std::vector<Emulator::Framebuffer> expected = Reference(KEY_MOVES, FRAMES, input);
+    std::vector<Emulator::Framebuffer> still = Reference(KEY_MOVES, FRAMES, Emulator::InputLog(99));
+    REQUIRE(frames.size() == FRAMES);
+    for (uint64_t frame = 0; frame < FRAMES; frame++) REQUIRE(frames[frame] == Scaled(expected[frame], 1));
+    REQUIRE(expected.back() != still.back());
+    remove("export_input.y4m");
+}
@@ -0,0 +1,59 @@
+#include "VisitedSet.h"
+#include <algorithm>
+
+namespace Emulator {
+
+    VisitedSet::VisitedSet(size_t capacity) : capacity(std::max<size_t>(capacity, 1)), size(0) {
+        size_t slots = 2;
+        while (slots < 2 * VisitedSet::capacity) slots *= 2;
+
+        table.reset(new std::atomic<uint64_t>[slots]);
+        mask = slots - 1;
+        Clear();
+    }
+
+    VisitResult VisitedSet::Insert(uint64_t hash) {
+        hash += hash == 0;
+
+        //Linear probing, a slot only ever goes from empty to a hash. Slot order comes from the high bits since the
+        //low bits of the hash are often used to pick a thread or shard
+        for (size_t probe = 0, slot = (hash >> 32 ^ hash) & mask; probe <= mask; probe++, slot = (slot + 1) & mask) {
+            uint64_t current = table[slot].load(std::memory_order_acquire);
+            if (current == hash) return VISIT_SEEN;
+            if (current != 0) continue;
+
+            //Another thread can win the slot with the same hash or take it for a different one
+            if (size.load(std::memory_order_relaxed) >= capacity) return VISIT_FULL;
+            if (table[slot].compare_exchange_strong(current, hash, std::memory_order_acq_rel)) {
+                size.fetch_add(1, std::memory_order_relaxed);
+                return VISIT_NEW;
+            }
+            if (current == hash) return VISIT_SEEN;
+        }
+        return VISIT_FULL;
+    }
+
+    bool VisitedSet::Contains(uint64_t hash) const {
+        hash += hash == 0;
+
+        for (size_t probe = 0, slot = (hash >> 32 ^ hash) & mask; probe <= mask; probe++, slot = (slot + 1) & mask) {
+            uint64_t current = table[slot].load(std::memory_order_acquire);
+            if (current == hash) return true;
+            if (current == 0) return false;
+        }
+        return false;
+    }
+
+    void VisitedSet::Clear() {
+        for (size_t slot = 0; slot <= mask; slot++) table[slot].store(0, std::memory_order_relaxed);
+        size.store(0, std::memory_order_relaxed);
+    }
+
+    size_t VisitedSet::GetSize() const {
+        return size.load(std::memory_order_relaxed);
+    }
+
+    size_t VisitedSet::GetCapacity() const {
+        return capacity;
+    }
+}
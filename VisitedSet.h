@@ -0,0 +1,43 @@
+#ifndef CHIP8_EMULATOR_C_VISITEDSET_H
+#define CHIP8_EMULATOR_C_VISITEDSET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Emulator {
+
+    enum VisitResult {
+        VISIT_NEW, //The hash wasn't in the set and was added
+        VISIT_SEEN, //Another insert added it before
+        VISIT_FULL //Not in the set and there is no room left for it
+    };
+
+    //Set of state hashes shared by the threads of a search, e.g. of Chip8::StateHash(). Open addressing over a fixed
+    //table of atomics: inserting is a compare and swap, it never blocks or allocates. The table doesn't grow, size
+    //it for the search up front. Hash 0 marks empty slots and is stored as 1.
+    class VisitedSet {
+
+    private:
+        std::unique_ptr<std::atomic<uint64_t>[]> table;
+        size_t mask;
+        size_t capacity;
+        std::atomic<size_t> size;
+
+    public:
+        //Room for capacity hashes, the table is kept at most half full
+        explicit VisitedSet(size_t capacity);
+
+        VisitResult Insert(uint64_t hash);
+        bool Contains(uint64_t hash) const;
+
+        //Not safe while other threads insert
+        void Clear();
+
+        size_t GetSize() const;
+        size_t GetCapacity() const;
+    };
+}
+
+#endif //CHIP8_EMULATOR_C_VISITEDSET_H
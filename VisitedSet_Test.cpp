@@ -0,0 +1,57 @@
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "VisitedSet.h"
+
+TEST_CASE("Visited set remembers hashes until it is full") {
+    Emulator::VisitedSet visited(100);
+    REQUIRE(visited.GetCapacity() == 100);
+
+    for (uint64_t hash = 0; hash < 100; hash++) {
+        REQUIRE_FALSE(visited.Contains(hash * 0x10000));
+        REQUIRE(visited.Insert(hash * 0x10000) == Emulator::VISIT_NEW);
+    }
+    REQUIRE(visited.GetSize() == 100);
+
+    //Colliding slots are probed, 0 is a valid hash
+    for (uint64_t hash = 0; hash < 100; hash++) {
+        REQUIRE(visited.Contains(hash * 0x10000));
+        REQUIRE(visited.Insert(hash * 0x10000) == Emulator::VISIT_SEEN);
+    }
+
+    REQUIRE(visited.Insert(12345) == Emulator::VISIT_FULL);
+    REQUIRE_FALSE(visited.Contains(12345));
+
+    visited.Clear();
+    REQUIRE(visited.GetSize() == 0);
+    REQUIRE_FALSE(visited.Contains(0));
+    REQUIRE(visited.Insert(12345) == Emulator::VISIT_NEW);
+}
+
+TEST_CASE("Every hash is new for exactly one of the inserting threads") {
+    const int THREADS = 4;
+    const uint64_t HASHES = 20000;
+    Emulator::VisitedSet visited(HASHES);
+
+    //All threads insert the same hashes, in different orders (the strides are coprime to the count)
+    const uint64_t strides[THREADS] = {1, 3, 7, 9};
+    std::atomic<uint64_t> added(0), full(0);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < THREADS; thread++) {
+        threads.emplace_back([&, thread]() {
+            for (uint64_t i = 0; i < HASHES; i++) {
+                uint64_t hash = ((i * strides[thread]) % HASHES) * 0x9E3779B97F4A7C15ULL;
+                Emulator::VisitResult result = visited.Insert(hash);
+                added += result == Emulator::VISIT_NEW;
+                full += result == Emulator::VISIT_FULL;
+            }
+        });
+    }
+    for (std::thread &thread : threads) thread.join();
+
+    REQUIRE(full == 0);
+    REQUIRE(added == HASHES);
+    REQUIRE(visited.GetSize() == HASHES);
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Conformance.h"
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <directory> [--cycles n] [--jobs n] [--update] [--pairs]" << std::endl;
+        return -1;
+    }
+
+    std::string directory = argv[1];
+    uint64_t cycles = 100000;
+    int jobs = std::max<int>(std::thread::hardware_concurrency(), 1);
+    bool update = false;
+    bool pairs = false;
+
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--cycles" && i + 1 < argc) cycles = std::stoull(argv[++i]);
+        else if (argument == "--jobs" && i + 1 < argc) jobs = std::stoi(argv[++i]);
+        else if (argument == "--update") update = true;
+        else if (argument == "--pairs") pairs = true;
+    }
+
+    std::vector<Emulator::ConformanceRom> roms = Emulator::BuiltinConformanceRoms(directory);
+    for (auto &rom : Emulator::LoadConformanceRoms(directory)) roms.push_back(rom);
+
+    //Instruction pair statistics of the corpus instead of the conformance check
+    if (pairs) {
+        auto counts = Emulator::CountOpcodePairs(roms, cycles);
+        uint64_t total = 0;
+        for (const auto &count : counts) total += count.count;
+        for (size_t i = 0; i < counts.size() && i < 20; i++) {
+            printf("%-5s %-5s %10llu %5.1f%%\n", counts[i].first.c_str(), counts[i].second.c_str(),
+                   static_cast<unsigned long long>(counts[i].count), counts[i].count * 100.0 / total);
+        }
+        return 0;
+    }
+
+    int failed = 0;
+    for (const auto &result : Emulator::RunConformance(roms, cycles, jobs, update)) {
+        const char *status = "PASS";
+        if (result.status == Emulator::ConformanceStatus::Fail) status = "FAIL";
+        else if (result.status == Emulator::ConformanceStatus::Missing) status = "MISSING";
+        else if (result.status == Emulator::ConformanceStatus::Updated) status = "UPDATED";
+
+        failed += result.status == Emulator::ConformanceStatus::Fail ||
+                  result.status == Emulator::ConformanceStatus::Missing;
+        printf("%-8s %-24s %10.1f MIPS %5.1f%% idle %s\n", status, result.name.c_str(),
+               result.instructions_per_second / 1e6, result.skipped_cycles * 100.0 / result.cycles, result.detail.c_str());
+    }
+
+    printf("%zu ROMs, %d failed\n", roms.size(), failed);
+    return failed == 0 ? 0 : 1;
+}
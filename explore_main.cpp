@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include "Explorer.h"
+#include "Instruction.h"
+
+namespace {
+    const char *FaultName(uint8_t fault) {
+        if (fault == Emulator::FAULT_MEMORY_RANGE) return "memory access past 0xFFF";
+        if (fault == Emulator::FAULT_PC_RANGE) return "instruction fetch past 0xFFF";
+        if (fault == Emulator::FAULT_STACK_OVERFLOW) return "stack overflow";
+        if (fault == Emulator::FAULT_STACK_UNDERFLOW) return "stack underflow";
+        if (fault == Emulator::FAULT_INVALID_OPCODE) return "invalid opcode";
+        return "fault";
+    }
+}
+
+//Plays a ROM with generated keys and reports the code it never reached and every fault it ran into. Exits with 2
+//when there were faults, so it can gate a ROM in a script
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <rom> [--frames n] [--seconds s] [--threads n] [--seed n]"
+                  << " [--cycles-per-frame n] [--repro prefix]" << std::endl;
+        return -1;
+    }
+
+    std::string rompath = argv[1];
+    Emulator::ExplorerOptions options;
+    options.threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    options.frames = 10000000;
+    std::string repro; //Every finding's keys go to <repro><address>-<fault>.txt for Chip8Export --input
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--frames" && i + 1 < argc) options.frames = std::stoull(argv[++i]);
+        else if (argument == "--seconds" && i + 1 < argc) options.seconds = std::stod(argv[++i]);
+        else if (argument == "--threads" && i + 1 < argc) options.threads = std::stoi(argv[++i]);
+        else if (argument == "--seed" && i + 1 < argc) options.seed = std::stoull(argv[++i]);
+        else if (argument == "--cycles-per-frame" && i + 1 < argc) options.cycles_per_frame = std::stoi(argv[++i]);
+        else if (argument == "--repro" && i + 1 < argc) repro = argv[++i];
+        else {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            return -1;
+        }
+    }
+
+    std::ifstream file(rompath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Can't read " << rompath << std::endl;
+        return -1;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Emulator::Explorer explorer(rom, options);
+    explorer.Explore();
+
+    Emulator::ExplorerStats stats = explorer.GetStats();
+    double seconds = stats.nanoseconds / 1e9;
+    printf("Explored %llu frames in %.2f s on %d threads, %.0f frames/min, %llu runs, %llu checkpoints, "
+           "%llu screens, %llu instructions\n", static_cast<unsigned long long>(stats.frames), seconds,
+           options.threads, stats.frames / std::max(seconds, 1e-9) * 60, static_cast<unsigned long long>(stats.runs),
+           static_cast<unsigned long long>(stats.checkpoints), static_cast<unsigned long long>(stats.screens),
+           static_cast<unsigned long long>(stats.executed));
+
+    std::vector<std::pair<uint16_t, uint16_t>> unreached = explorer.GetUnreached();
+    size_t unreached_bytes = 0;
+    for (const auto &range : unreached) unreached_bytes += range.second - range.first + 1;
+    printf("Unreached: %zu of %zu ROM bytes\n", unreached_bytes, std::min<size_t>(rom.size(), 4096 - 0x200));
+    for (const auto &range : unreached) {
+        unsigned short opcode = 0;
+        if (range.first + 1u < 0x200 + rom.size()) opcode = rom[range.first - 0x200] << 8 | rom[range.first - 0x1FF];
+        printf("  %03X-%03X %4d bytes, starts with %04X %s\n", range.first, range.second,
+               range.second - range.first + 1, opcode, Emulator::Disassemble(opcode).c_str());
+    }
+
+    std::vector<Emulator::ExplorerFinding> findings = explorer.GetFindings();
+    printf("Faults: %zu\n", findings.size());
+    for (const Emulator::ExplorerFinding &finding : findings) {
+        printf("  %03X %04X %-16s %s at cycle %llu", finding.address, finding.opcode,
+               Emulator::Disassemble(finding.opcode).c_str(), FaultName(finding.fault),
+               static_cast<unsigned long long>(finding.cycle));
+        if (!repro.empty()) {
+            char name[32];
+            snprintf(name, sizeof(name), "%03X-%d.txt", finding.address, finding.fault);
+            if (finding.input.Save(repro + name)) printf(", keys in %s%s", repro.c_str(), name);
+        }
+        printf("\n");
+    }
+    return findings.empty() ? 0 : 2;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "Chip8.h"
+#include "InputLog.h"
+#include "VideoExport.h"
+
+int main(int argc, char const *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <rom> <output.y4m|gif|png> [--frames n] [--input file] [--seed n]"
+                  << " [--scale n] [--palette on:off] [--workers n] [--queue frames] [--format y4m|gif|png]"
+                  << std::endl;
+        return -1;
+    }
+
+    std::string rompath = argv[1];
+    std::string outputpath = argv[2];
+    Emulator::ExportOptions options;
+    options.workers = std::max<int>(std::thread::hardware_concurrency(), 2) - 1;
+    uint64_t frames = 600;
+    uint64_t seed = 0;
+    std::string inputpath;
+    std::string format; //From the output extension by default, "-" as output writes to stdout
+
+    for (int i = 3; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--frames" && i + 1 < argc) frames = std::stoull(argv[++i]);
+        else if (argument == "--input" && i + 1 < argc) inputpath = argv[++i];
+        else if (argument == "--seed" && i + 1 < argc) seed = std::stoull(argv[++i]);
+        else if (argument == "--scale" && i + 1 < argc) options.scale = std::stoi(argv[++i]);
+        else if (argument == "--palette" && i + 1 < argc) {
+            if (!Emulator::ParsePalette(argv[++i], &options.palette)) {
+                std::cerr << "Can't parse the palette " << argv[i] << ", use white, green, amber or RRGGBB:RRGGBB"
+                          << std::endl;
+                return -1;
+            }
+        }
+        else if (argument == "--workers" && i + 1 < argc) options.workers = std::stoi(argv[++i]);
+        else if (argument == "--queue" && i + 1 < argc) options.queue_frames = std::stoul(argv[++i]);
+        else if (argument == "--format" && i + 1 < argc) format = argv[++i];
+        else {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            return -1;
+        }
+    }
+
+    if (!Emulator::ExportFormatFromPath(format.empty() ? outputpath : "." + format, &options.format)) {
+        std::cerr << "Can't tell the format of " << outputpath << ", use .y4m, .gif or .png" << std::endl;
+        return -1;
+    }
+
+    //A recording replays on the seed it was made with
+    Emulator::InputLog input;
+    if (!inputpath.empty()) {
+        if (!input.Load(inputpath)) {
+            std::cerr << "Can't read input " << inputpath << std::endl;
+            return -1;
+        }
+        seed = input.GetSeed();
+    }
+
+    Emulator::Chip8 chip8(rompath, seed);
+    Emulator::ExportStats stats;
+    if (!Emulator::ExportVideo(chip8, inputpath.empty() ? nullptr : &input, frames, outputpath, options, &stats)) {
+        std::cerr << "Can't write " << outputpath << std::endl;
+        return -1;
+    }
+
+    //Per stage rates, the stage with the lowest one limited the export
+    auto rate = [&](uint64_t nanoseconds) { return stats.frames * 1e9 / std::max<uint64_t>(nanoseconds, 1); };
+    fprintf(stderr, "Exported %llu frames, %llu bytes in %.2f s, %.0f frames/s\n",
+            static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.bytes),
+            stats.wall_nanoseconds / 1e9, rate(stats.wall_nanoseconds));
+    fprintf(stderr, "  emulate %10.0f frames/s\n", rate(stats.emulate_nanoseconds));
+    fprintf(stderr, "  encode  %10.0f frames/s per worker, %.0f with %d\n", rate(stats.encode_nanoseconds),
+            rate(stats.encode_nanoseconds) * stats.workers, stats.workers);
+    fprintf(stderr, "  write   %10.0f frames/s\n", rate(stats.write_nanoseconds));
+    fprintf(stderr, "  queue full for %llu frames\n", static_cast<unsigned long long>(stats.queue_full));
+    return 0;
+}
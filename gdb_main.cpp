@@ -0,0 +1,18 @@
+#include <iostream>
+#include "Chip8.h"
+#include "Debugger.h"
+#include "GdbStub.h"
+
+int main(int argc, char const *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <rom> <socket path>" << std::endl;
+        return -1;
+    }
+
+    Emulator::Chip8 chip8(argv[1]);
+    Emulator::Debugger debugger(chip8);
+    Emulator::GdbStub stub(debugger);
+
+    std::cout << "Waiting for gdb on " << argv[2] << std::endl;
+    return stub.Serve(argv[2]) ? 0 : -1;
+}
@@ -2,155 +2,300 @@
 #include <chrono>
 #include <ctime>
 #include "Chip8.h"
-#include <SDL2/SDL.h>
+#include "Trace.h"
+#include "VideoBackend.h"
+#include "FramePipeline.h"
+#include "FileWatcher.h"
+#include "Metrics.h"
+#include "RunAhead.h"
+#include "FrameSkip.h"
+#include "Netplay.h"
+#include "InputLog.h"
+#include "SharedDisplayWriter.h"
+#ifdef CHIP8_HAVE_SDL
+#include "SdlVideoBackend.h"
+#endif
 #include <stdio.h>
 #include <algorithm>
 #include <thread>
+#include <random>
 
-const int SCREEN_WIDTH = 64;
-const int SCREEN_HEIGHT = 32;
 int SCALE = 16;
+const int CYCLES_PER_SECOND = 1000; //The loop is paced to a cycle every millisecond
+const int FRAMES_PER_SECOND = 60;
 std::string filepath;
+std::string tracepath;
+#ifdef CHIP8_HAVE_SDL
+std::string video = "sdl";
+#else
+std::string video = "null";
+#endif
+std::string outputpath = "-";
+uint64_t max_cycles = 0; //0 runs until the backend asks to quit
+Emulator::Palette palette = Emulator::PALETTE_WHITE;
+bool scanlines = false;
+int persistence = 0;
+int blend_frames = 0;
+bool watch = false;
+std::string metricspath;
+bool overlay = false;
+int run_ahead_frames = 0;
+int turbo_speed = Emulator::FrameSkip::UNCAPPED; //While Tab is held
+std::string netplay_peer; //host:port, empty plays alone
+uint16_t netplay_port = 0;
+int input_delay = 1;
+std::string inputpath; //Key changes are recorded here for Chip8Export
+uint64_t seed = 0;
+bool seeded = false;
+std::string shm_name; //Publishes every frame into this shared memory segment, see Chip8Monitor
+
+std::unique_ptr<Emulator::VideoBackend> CreateBackend();
+
+void PrintUsage() {
+    printf("\nUsage: Chip8 <rom> [scale] [--video sdl|null|ppm|raw] [--output file] [--cycles n] [--trace file]"
+           " [--palette on:off] [--scanlines] [--persistence 0-255] [--blend frames]"
+           " [--watch] [--metrics file] [--overlay] [--run-ahead frames] [--turbo n|max] [--shm name]"
+           " [--netplay port host:port] [--input-delay n] [--seed n] [--record-input file]\n");
+}
 
-// Keypad keymap
-const uint8_t keymap[16] = {SDLK_x, SDLK_1, SDLK_2, SDLK_3, SDLK_q, SDLK_w, SDLK_e, SDLK_a, SDLK_s, SDLK_d, SDLK_y,
-                            SDLK_c,
-                            SDLK_4, SDLK_r, SDLK_f, SDLK_v,
-};
-
-//The window we'll be rendering to
-SDL_Window *gWindow = nullptr;
-SDL_Renderer *gRenderer = nullptr;
-
-bool init();
-
-void close();
-
-bool HandleEvents(SDL_Event *e, std::vector<bool> *key_pressed);
-
-void UpdateGfx(std::vector<uint32_t> *gfx, std::vector<std::vector<bool>> emulator_gfx);
+int RunNetplay(Emulator::VideoBackend &backend);
 
 int main(int argc, char const *argv[]) {
     if(argc==1) {
         printf("\nYou need to specify the file path of the ROM u wish to emulate");
+        PrintUsage();
         return -1;
-    } else if (argc > 2) {
-        SCALE = std::stoi(argv[2]);
+    }
+
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--trace" && i + 1 < argc) tracepath = argv[++i];
+        else if (argument == "--video" && i + 1 < argc) video = argv[++i];
+        else if (argument == "--output" && i + 1 < argc) outputpath = argv[++i];
+        else if (argument == "--cycles" && i + 1 < argc) max_cycles = std::stoull(argv[++i]);
+        else if (argument == "--palette" && i + 1 < argc) {
+            if (!Emulator::ParsePalette(argv[++i], &palette)) {
+                printf("Can't parse the palette %s, use white, green, amber or RRGGBB:RRGGBB\n", argv[i]);
+                return -1;
+            }
+        }
+        else if (argument == "--scanlines") scanlines = true;
+        else if (argument == "--persistence" && i + 1 < argc) persistence = std::stoi(argv[++i]);
+        else if (argument == "--blend" && i + 1 < argc) blend_frames = std::stoi(argv[++i]);
+        else if (argument == "--watch") watch = true;
+        else if (argument == "--metrics" && i + 1 < argc) metricspath = argv[++i];
+        else if (argument == "--overlay") overlay = true;
+        else if (argument == "--run-ahead" && i + 1 < argc) run_ahead_frames = std::stoi(argv[++i]);
+        else if (argument == "--turbo" && i + 1 < argc) {
+            std::string speed = argv[++i];
+            turbo_speed = speed == "max" ? Emulator::FrameSkip::UNCAPPED : std::max(std::stoi(speed), 1);
+        }
+        else if (argument == "--netplay" && i + 2 < argc) {
+            netplay_port = static_cast<uint16_t>(std::stoi(argv[++i]));
+            netplay_peer = argv[++i];
+        }
+        else if (argument == "--input-delay" && i + 1 < argc) input_delay = std::stoi(argv[++i]);
+        else if (argument == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+            seeded = true;
+        }
+        else if (argument == "--record-input" && i + 1 < argc) inputpath = argv[++i];
+        else if (argument == "--shm" && i + 1 < argc) shm_name = argv[++i];
+        else if (!argument.empty() && argument.size() <= 4 &&
+                 argument.find_first_not_of("0123456789") == std::string::npos) {
+            SCALE = std::stoi(argument);
+        }
+        else {
+            //Unknown flags and flags missing their value too, instead of trying them as the scale
+            printf("Unknown argument %s", argument.c_str());
+            PrintUsage();
+            return -1;
+        }
     }
 
     filepath = argv[1];
 
-    std::chrono::time_point<std::chrono::system_clock> beforeCycle;
-    long elapsed_millis = 0;
+    std::unique_ptr<Emulator::VideoBackend> backend = CreateBackend();
 
-    if (!init()) printf("Failed to initialize!\n");
+    if (!backend) printf("Unknown video backend %s\n", video.c_str());
+    else if (!backend->Init()) printf("Failed to initialize!\n");
+    else if (!netplay_peer.empty()) return RunNetplay(*backend);
     else {
         bool quit = false;
+        bool interactive = backend->IsInteractive();
+
+        //The seed is picked here instead of by the machine so a recording can name it
+        if (!seeded) seed = uint64_t(std::random_device()()) << 32 | std::random_device()();
+        Emulator::Chip8 chip8(filepath, seed);
+        Emulator::FramePipeline pipeline(CYCLES_PER_SECOND, FRAMES_PER_SECOND, blend_frames);
+        Emulator::RunAhead run_ahead(run_ahead_frames);
+        Emulator::FrameSkip frame_skip(CYCLES_PER_SECOND, FRAMES_PER_SECOND);
+
+        //The window title shows the speed relative to real time, updated once a second
+        auto next_title = Emulator::FrameSkip::Clock::now() + std::chrono::seconds(1);
+        auto title_since = Emulator::FrameSkip::Clock::now();
+        uint64_t title_cycle = 0;
+
+        //Reloads the ROM in place whenever it is rebuilt
+        std::unique_ptr<Emulator::FileWatcher> watcher;
+        if (watch) watcher.reset(new Emulator::FileWatcher(filepath));
+        if (watcher && !watcher->IsWatching()) printf("Can't watch %s for changes\n", filepath.c_str());
+
+        Emulator::SharedDisplayWriter shared_display;
+        if (!shm_name.empty() && !shared_display.Open(shm_name)) printf("Can't publish to %s\n", shm_name.c_str());
+
+        //Snapshots are taken once a second, for the dump file and the overlay
+        std::unique_ptr<Emulator::Metrics> metrics;
+        Emulator::Metrics::Clock::time_point next_snapshot;
+        if (!metricspath.empty() || overlay) {
+            metrics.reset(new Emulator::Metrics(CYCLES_PER_SECOND, FRAMES_PER_SECOND));
+            next_snapshot = Emulator::Metrics::Clock::now() + std::chrono::seconds(1);
+        }
+        auto take_snapshot = [&](uint64_t cycles, Emulator::Metrics::Clock::time_point now) {
+            Emulator::MetricsSnapshot snapshot = metrics->Snapshot(chip8, cycles, now);
+            if (!metricspath.empty() && !Emulator::WriteMetricsFile(snapshot, metricspath)) {
+                printf("Can't write metrics to %s\n", metricspath.c_str());
+                metricspath.clear();
+            }
+            if (overlay) backend->SetOverlay(Emulator::FormatMetricsOverlay(snapshot));
+        };
 
-        //Event handler
-        SDL_Event e;
-
-        std::vector<uint32_t> gfx(SCREEN_WIDTH * SCREEN_HEIGHT);
-
-        SDL_Texture *display_texture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
-                                                         SCREEN_WIDTH, SCREEN_HEIGHT);
+        std::unique_ptr<Emulator::InputLog> input_log;
+        if (!inputpath.empty()) input_log.reset(new Emulator::InputLog(seed));
 
-        Emulator::Chip8 chip8(filepath);
+        std::unique_ptr<Emulator::TraceRecorder> trace_recorder;
+        std::unique_ptr<Emulator::Tracer> tracer;
+        if (!tracepath.empty()) {
+            trace_recorder.reset(new Emulator::TraceRecorder(tracepath));
+            tracer.reset(new Emulator::Tracer(*trace_recorder));
+        }
 
         //While application is running
-        while (!quit) {
-            beforeCycle = std::chrono::system_clock::now();
-
+        uint64_t cycle = 0;
+        for (; !quit && (max_cycles == 0 || cycle < max_cycles); cycle++) {
             //Handle Input
-            quit = HandleEvents(&e, &chip8.key_pressed);
+            //While Fx0A waits with the delay timer stopped nothing can change until an event arrives, so block on it.
+            //The sound timer never counts down here, waiting for it would keep polling after any Fx18. A watched
+            //ROM can also change underneath, so keep polling then
+            if (interactive && !watcher && chip8.IsWaitingForKey() && chip8.GetDelayTimer() == 0) {
+                quit = backend->WaitEvents(chip8);
+            } else {
+                quit = backend->PollEvents(chip8);
+            }
+            if (input_log) input_log->Record(cycle, chip8.GetKeyState());
+            if (interactive) frame_skip.SetSpeed(backend->IsTurboHeld() ? turbo_speed : 1, Emulator::FrameSkip::Clock::now());
 
             //Handle Logic
-            chip8.EmulateCycle();
+            if (tracer) tracer->Step(chip8);
+            else chip8.EmulateCycle();
 
             //Handle Graphics
-            UpdateGfx(&gfx, chip8.GetGfx());
-
-            SDL_UpdateTexture(display_texture, nullptr, &gfx[0], SCREEN_WIDTH * sizeof(uint32_t));
-            SDL_RenderClear(gRenderer);
-            SDL_RenderCopy(gRenderer, display_texture, nullptr, nullptr);
-            SDL_RenderPresent(gRenderer);
-            SDL_UpdateWindowSurface(gWindow);
+            if (pipeline.Cycle(chip8.GetGfx())) {
+                //Every frame the machine makes, readers see what it does even while presents are skipped
+                shared_display.Publish(chip8, cycle + 1);
+                //Fast forward and a host that can't keep up skip presents, the machine still runs every cycle
+                if (!interactive || frame_skip.ShouldPresent(Emulator::FrameSkip::Clock::now())) {
+                    //Shows the frame the current keys lead to a few frames from now, timed so its cost shows up in the metrics
+                    auto before_run_ahead = metrics ? Emulator::Metrics::Clock::now() : Emulator::Metrics::Clock::time_point();
+                    const Emulator::Framebuffer &frame = run_ahead.Frame(chip8, pipeline);
+                    if (metrics && run_ahead.GetFrames() > 0) metrics->RanAhead(Emulator::Metrics::Clock::now() - before_run_ahead);
+
+                    backend->Present(frame);
+                    if (metrics) metrics->FramePresented(Emulator::Metrics::Clock::now());
+                }
+                if (metrics) {
+                    auto now = Emulator::Metrics::Clock::now();
+                    if (now >= next_snapshot) {
+                        take_snapshot(cycle + 1, now);
+                        next_snapshot = now + std::chrono::seconds(1);
+                    }
+                }
+                if (interactive) {
+                    auto now = Emulator::FrameSkip::Clock::now();
+                    if (now >= next_title) {
+                        double seconds = std::chrono::duration<double>(now - title_since).count();
+                        double percent = (cycle + 1 - title_cycle) / seconds / CYCLES_PER_SECOND * 100;
+                        char title[64];
+                        snprintf(title, sizeof(title), " - %.0f%%", percent);
+                        backend->SetTitle("Chip8 " + filepath + title);
+                        title_since = now;
+                        title_cycle = cycle + 1;
+                        next_title = now + std::chrono::seconds(1);
+                    }
+                }
+                if (watcher && watcher->Changed() && chip8.LoadRomFile(filepath)) printf("Reloaded %s\n", filepath.c_str());
+            }
 
-            elapsed_millis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now()-beforeCycle).count();
-            std::this_thread::sleep_for(std::chrono::microseconds(1000-elapsed_millis*1000));
+            if (interactive) {
+                auto requested = frame_skip.Cycle(Emulator::FrameSkip::Clock::now());
+                if (requested > Emulator::FrameSkip::Clock::duration::zero()) {
+                    auto before_sleep = metrics ? Emulator::Metrics::Clock::now() : Emulator::Metrics::Clock::time_point();
+                    std::this_thread::sleep_for(requested);
+                    if (metrics) metrics->Slept(requested, Emulator::Metrics::Clock::now() - before_sleep);
+                }
+            }
         }
 
-        SDL_DestroyTexture(display_texture);
-    }
+        if (metrics) take_snapshot(cycle, Emulator::Metrics::Clock::now());
+        if (input_log && !input_log->Save(inputpath)) printf("Can't write the input to %s\n", inputpath.c_str());
 
-    close();
+        tracer.reset();
+    }
 
     return 0;
 }
 
-bool init() {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
-        return false;
-    } else {
-        gWindow = SDL_CreateWindow("My Window", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH*SCALE,
-                                   SCREEN_HEIGHT*SCALE, SDL_WINDOW_SHOWN);
-        if (gWindow == nullptr) {
-            printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
-            return false;
-        } else {
-            gRenderer = SDL_CreateRenderer(gWindow, -1, 0);
-            SDL_RenderSetScale(gRenderer, SCALE, SCALE);
-        }
+//Plays with a peer running the same ROM, a frame at a time at the display rate. Both machines are seeded with --seed,
+//0 by default, so their random numbers agree
+int RunNetplay(Emulator::VideoBackend &backend) {
+    size_t separator = netplay_peer.rfind(':');
+    Emulator::UdpTransport transport;
+    if (separator == std::string::npos || !transport.Bind(netplay_port) ||
+        !transport.Connect(netplay_peer.substr(0, separator), std::stoi(netplay_peer.substr(separator + 1)))) {
+        printf("Can't reach netplay peer %s\n", netplay_peer.c_str());
+        return -1;
     }
 
-    return true;
-}
-
-bool HandleEvents(SDL_Event *e, std::vector<bool> *key_pressed) {
-    //Handle events on queue
-    while (SDL_PollEvent(e) != 0) {
-        //Exit if quit event is triggered
-        if (e->type == SDL_QUIT) {
-            return true;
-        }
-
-        if (e->type == SDL_KEYDOWN) {
-            for (int i = 0; i < 16; ++i) {
-                if (e->key.keysym.sym == keymap[i]) {
-                    key_pressed->at(i) = true;
-                }
-            }
+    Emulator::Chip8 chip8(filepath, seed);
+    Emulator::NetplayOptions options;
+    options.cycles_per_second = CYCLES_PER_SECOND;
+    options.input_delay = input_delay;
+    Emulator::NetplaySession session(chip8, transport, options);
+    Emulator::FrameSkip pacing(FRAMES_PER_SECOND, FRAMES_PER_SECOND);
+    Emulator::SharedDisplayWriter shared_display;
+    if (!shm_name.empty() && !shared_display.Open(shm_name)) printf("Can't publish to %s\n", shm_name.c_str());
+
+    bool quit = false;
+    uint64_t max_frames = max_cycles * FRAMES_PER_SECOND / CYCLES_PER_SECOND;
+    for (uint64_t tick = 0; !quit && (max_cycles == 0 || session.GetFrame() < max_frames); tick++) {
+        quit = backend.PollEvents(chip8);
+
+        //The side that runs ahead sits out a frame now and then, so neither keeps rolling the other back
+        if (session.GetFrameAdvantage() > 0 && tick % 8 == 0) session.Poll();
+        else if (session.AdvanceFrame(chip8.GetKeyState())) {
+            backend.Present(chip8.GetGfx());
+            shared_display.Publish(chip8, session.GetFrame() * CYCLES_PER_SECOND / FRAMES_PER_SECOND);
         }
 
-        if (e->type == SDL_KEYUP) {
-            for (int i = 0; i < 16; ++i) {
-                if (e->key.keysym.sym == keymap[i]) {
-                    key_pressed->at(i) = false;
-                }
-            }
-        }
+        std::this_thread::sleep_for(pacing.Cycle(Emulator::FrameSkip::Clock::now()));
     }
 
-    return false;
+    const Emulator::NetplayStats &stats = session.GetStats();
+    printf("Netplay: %llu frames, %llu rollbacks (%.1f per 100 frames), %llu frames resimulated in %.2f ms, "
+           "deepest %llu, %llu stalls, %llu desyncs\n", static_cast<unsigned long long>(stats.frames),
+           static_cast<unsigned long long>(stats.rollbacks),
+           stats.rollbacks * 100.0 / std::max<uint64_t>(stats.frames, 1),
+           static_cast<unsigned long long>(stats.resimulated_frames), stats.resimulate_nanoseconds / 1e6,
+           static_cast<unsigned long long>(stats.max_rollback), static_cast<unsigned long long>(stats.stalls),
+           static_cast<unsigned long long>(stats.desyncs));
+    return 0;
 }
 
-void UpdateGfx(std::vector<uint32_t> *gfx, std::vector<std::vector<bool>> emulator_gfx) {
-    for (int i = 0; i < SCREEN_HEIGHT; ++i) {
-        for (int j = 0; j < SCREEN_WIDTH; ++j) {
-            uint32_t pixel = emulator_gfx[i][j];
-            gfx->at(i * SCREEN_WIDTH + j) =
-                    (0x00FFFFFF * pixel) | 0xFF000000; //To convert the emulator gfx to a uint we can use
-        }
-    }
+std::unique_ptr<Emulator::VideoBackend> CreateBackend() {
+    Emulator::VideoOptions options = {SCALE, palette, scanlines,
+                                      static_cast<uint8_t>(std::min(std::max(persistence, 0), 255))};
+#ifdef CHIP8_HAVE_SDL
+    if (video == "sdl") return std::unique_ptr<Emulator::VideoBackend>(new Emulator::SdlVideoBackend(options));
+#endif
+    return Emulator::CreateVideoBackend(video, outputpath, options);
 }
-
-void close() {
-    SDL_DestroyWindow(gWindow);
-    gWindow = nullptr;
-
-    SDL_DestroyRenderer(gRenderer);
-    gRenderer = nullptr;
-
-    SDL_Quit();
-}
\ No newline at end of file
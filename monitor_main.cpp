@@ -0,0 +1,66 @@
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "SharedDisplay.h"
+
+//Prints what a running emulator publishes with --shm, an example of a reader that doesn't link the emulator
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <name> [--interval ms] [--count n] [--display]" << std::endl;
+        return -1;
+    }
+
+    std::string name = argv[1];
+    int interval = 1000;
+    uint64_t count = 0; //0 runs until the emulator goes away
+    bool display = false;
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--interval" && i + 1 < argc) interval = std::stoi(argv[++i]);
+        else if (argument == "--count" && i + 1 < argc) count = std::stoull(argv[++i]);
+        else if (argument == "--display") display = true;
+        else {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            return -1;
+        }
+    }
+
+    Emulator::SharedDisplayReader reader;
+    if (!reader.Open(name)) {
+        std::cerr << "Can't open shared display " << name << std::endl;
+        return -1;
+    }
+
+    uint64_t last = 0;
+    for (uint64_t printed = 0; count == 0 || printed < count;) {
+        Emulator::SharedDisplayFrame frame;
+        if (reader.GetSequence() != last && reader.Read(&frame)) {
+            last = frame.frame * 2;
+            printf("frame %llu cycle %llu pc %03X i %03X sp %X dt %02X st %02X keys %04X faults %02X%s%s\n",
+                   static_cast<unsigned long long>(frame.frame), static_cast<unsigned long long>(frame.cycle),
+                   frame.program_counter, frame.index_register, frame.stack_pointer, frame.delay_timer,
+                   frame.sound_timer, frame.keys, frame.faults, frame.halted ? " halted" : "",
+                   frame.waiting_for_key ? " waiting" : "");
+            printf("  v");
+            for (uint8_t value : frame.v) printf(" %02X", value);
+            printf("\n");
+            if (display) {
+                for (int y = 0; y < Emulator::Framebuffer::HEIGHT; y++) {
+                    std::string row;
+                    for (int x = 0; x < Emulator::Framebuffer::WIDTH; x++) row += frame.GetPixel(x, y) ? '#' : '.';
+                    printf("%s\n", row.c_str());
+                }
+            }
+            fflush(stdout);
+            printed++;
+        }
+        //A writer that quit removed the segment, the mapping stays valid but won't change anymore
+        if (kill(reader.GetWriterPid(), 0) != 0 && errno == ESRCH) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+    return 0;
+}
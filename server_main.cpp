@@ -0,0 +1,54 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "SessionServer.h"
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <socket path> [workers] [--report seconds]" << std::endl;
+        return -1;
+    }
+
+    int workers = std::max<int>(std::thread::hardware_concurrency(), 1);
+    int report_seconds = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--report" && i + 1 < argc) report_seconds = std::stoi(argv[++i]);
+        else workers = std::stoi(argument);
+    }
+
+    Emulator::SessionServer server(workers);
+
+    //Per session CPU time, printed from its own thread while the main thread accepts clients. It sleeps in short
+    //steps so it notices the stop flag soon after Serve returns and is joined before the server goes away
+    std::atomic<bool> stop(false);
+    std::thread reporter;
+    if (report_seconds > 0) {
+        reporter = std::thread([&server, &stop, report_seconds]() {
+            while (true) {
+                auto next_report = std::chrono::steady_clock::now() + std::chrono::seconds(report_seconds);
+                while (!stop && std::chrono::steady_clock::now() < next_report) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+                if (stop) return;
+
+                auto stats = server.GetStats();
+                std::cout << stats.size() << " sessions, workers used "
+                          << server.GetWorkerCpuNanoseconds() / 1000000 << " ms CPU" << std::endl;
+                for (const auto &session : stats) {
+                    std::cout << "  session " << session.id << ": " << session.cpu_nanoseconds / 1000 << " us CPU, "
+                              << session.cycles << " cycles, " << session.frames << " frames" << std::endl;
+                }
+            }
+        });
+    }
+
+    std::cout << "Serving sessions on " << argv[1] << " with " << workers << " workers" << std::endl;
+    bool served = server.Serve(argv[1]);
+
+    stop = true;
+    if (reporter.joinable()) reporter.join();
+    return served ? 0 : -1;
+}
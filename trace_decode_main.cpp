@@ -0,0 +1,23 @@
+#include <iostream>
+#include "Trace.h"
+
+int main(int argc, char const *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace file>" << std::endl;
+        return -1;
+    }
+
+    Emulator::TraceReader reader(argv[1]);
+    if (!reader.IsOpen()) {
+        std::cerr << "Can't read trace file " << argv[1] << std::endl;
+        return -1;
+    }
+
+    uint32_t stream_id;
+    Emulator::TraceRecord record;
+    while (reader.Next(&stream_id, &record)) {
+        std::cout << Emulator::FormatTraceRecord(stream_id, record) << '\n';
+    }
+
+    return 0;
+}